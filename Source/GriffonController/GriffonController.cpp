@@ -3,5 +3,6 @@
 #include "GriffonController.h"
 #include "Modules/ModuleManager.h"
 
+DEFINE_LOG_CATEGORY(LogGriffon);
+
 IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, GriffonController, "GriffonController" );
- 
\ No newline at end of file
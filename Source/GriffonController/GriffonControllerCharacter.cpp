@@ -9,13 +9,20 @@
 #include "GameFramework/SpringArmComponent.h"
 #include "EnhancedInputComponent.h"
 #include "EnhancedInputSubsystems.h"
+#include "GriffonCharacterMoveComponent.h"
+#include "GriffonDebug.h"
+#include "GriffonFlightCurves.h"
+#include "GriffonFlightSubsystem.h"
+#include "GriffonFlightTelemetry.h"
+#include "ShapeShiftInputRecording.h"
 #include "ShapeShiftManager.h"
 #include "Kismet/KismetMathLibrary.h"
 
 //////////////////////////////////////////////////////////////////////////
 // AGriffonControllerCharacter
 
-AGriffonControllerCharacter::AGriffonControllerCharacter()
+AGriffonControllerCharacter::AGriffonControllerCharacter(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer.SetDefaultSubobjectClass<UGriffonCharacterMoveComponent>(ACharacter::CharacterMovementComponentName))
 {
 	// Set size for collision capsule
 	GetCapsuleComponent()->InitCapsuleSize(42.f, 96.0f);
@@ -51,6 +58,7 @@ AGriffonControllerCharacter::AGriffonControllerCharacter()
 	// Note: The skeletal mesh and anim blueprint references on the Mesh component (inherited from Character) 
 	// are set in the derived blueprint asset named ThirdPersonCharacter (to avoid direct content references in C++)
 
+	MovementComponent = Cast<UGriffonCharacterMoveComponent>(GetCharacterMovement());
 
 	// Set the default values
 	DefaultAirControlValue = GetCharacterMovement()->AirControl;
@@ -73,6 +81,21 @@ void AGriffonControllerCharacter::BeginPlay()
 			Subsystem->AddMappingContext(DefaultMappingContext, 0);
 		}
 	}
+
+	FlightSubsystem = GetWorld()->GetSubsystem<UGriffonFlightSubsystem>();
+
+	// Without the baked asset, the raw curves are baked once for every griffon using them
+	LiftTable = FlightCurves ? &FlightCurves->GetLiftTable() : FlightSubsystem->FindOrBakeCurve(FlightVelocityLiftMultiplierCurve);
+	AngleTable = FlightCurves ? &FlightCurves->GetAngleTable() : FlightSubsystem->FindOrBakeCurve(FlightVelocityAngleMultiplierCurve);
+	InclinationTable = FlightCurves ? &FlightCurves->GetInclinationTable() : FlightSubsystem->FindOrBakeInclinationCurve(FlightVelocityAngleMultiplierCurve);
+}
+
+void AGriffonControllerCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (FlightSubsystem)
+		FlightSubsystem->UnregisterFlyer(this);
+
+	Super::EndPlay(EndPlayReason);
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -145,7 +168,8 @@ void AGriffonControllerCharacter::Tick(float DeltaSeconds)
 {
 	Super::Tick(DeltaSeconds);
 
-	if (bIsFlying)
+	// Fixed and predicted flight run in the movement component, batched flight in the flight subsystem
+	if (bIsFlying && FlightStepMode == FlightStep_Variable)
 	{
 		FlyPhysicsCompute(DeltaSeconds);
 	}
@@ -155,17 +179,18 @@ void AGriffonControllerCharacter::Tick(float DeltaSeconds)
 
 void AGriffonControllerCharacter::StartFlying()
 {
+	if (UsesFlyingMovementMode())
+	{
+		// The movement component changes the mode, on the server too
+		MovementComponent->bWantsToFly = !bIsFlying && GetCharacterMovement()->IsFalling();
+		return;
+	}
+
 	if (GetCharacterMovement()->IsFalling())
 	{
 		if (!bIsFlying)
 		{
-			bIsFlying = true;
-			
-			GetCharacterMovement()->AirControl = AirControlValue;
-			GetCharacterMovement()->BrakingFriction = BrakingFrictionValue;
-			GetCharacterMovement()->RotationRate = RotationRateValue;
-			GetCharacterMovement()->MaxAcceleration = MaxAccelerationValue;
-			GetCharacterMovement()->MaxWalkSpeed = MaxWalkSpeedValue;
+			EnterFlight();
 		} else
 		{
 			StopFlying();
@@ -174,8 +199,36 @@ void AGriffonControllerCharacter::StartFlying()
 }
 
 void AGriffonControllerCharacter::StopFlying()
+{
+	if (UsesFlyingMovementMode())
+	{
+		MovementComponent->bWantsToFly = false;
+		return;
+	}
+
+	ExitFlight();
+}
+
+void AGriffonControllerCharacter::EnterFlight()
+{
+	bIsFlying = true;
+	FlightSubsystem->RegisterFlyer(this);
+
+	FlightTimeAccumulator = 0;
+	PreviousFlightLocation = GetActorLocation();
+	PreviousFlightRotation = GetActorQuat();
+	
+	GetCharacterMovement()->AirControl = AirControlValue;
+	GetCharacterMovement()->BrakingFriction = BrakingFrictionValue;
+	GetCharacterMovement()->RotationRate = RotationRateValue;
+	GetCharacterMovement()->MaxAcceleration = MaxAccelerationValue;
+	GetCharacterMovement()->MaxWalkSpeed = MaxWalkSpeedValue;
+}
+
+void AGriffonControllerCharacter::ExitFlight()
 {
 	bIsFlying = false;
+	FlightSubsystem->UnregisterFlyer(this);
 
 	GetCharacterMovement()->AirControl = DefaultAirControlValue;
 	GetCharacterMovement()->BrakingFriction = DefaultBrakingFrictionValue;
@@ -196,112 +249,190 @@ void AGriffonControllerCharacter::StopFlapping()
 
 void AGriffonControllerCharacter::FlyPhysicsCompute(float DeltaSeconds)
 {
-	FVector ActorVelocity = GetVelocity();
-	FRotator ControlRotation = GetControlRotation();
-	FRotator ActorRotation = GetActorRotation();
-
-	// INCLINATION // 22:00
-	// Get how much the camera is aiming to the actor forward in Z
-	ControlInclination = FVector::DotProduct(UKismetMathLibrary::GetUpVector(ControlRotation),
-											UKismetMathLibrary::GetForwardVector(FRotator(0, ActorRotation.Yaw, 0))); // 1 parallel, 0 perpendicular, -1 parallel opposite
-	
-	// CALCULATE LIFT // 16:00
-	// Get how much the camera is aiming to the actor forward in Z
-	FVector VelocityCurveLiftTime = ActorVelocity; // 19:00
-	VelocityCurveLiftTime.Z = UKismetMathLibrary::FClamp(VelocityCurveLiftTime.Z, -4000, 0); // only take negative value
+	FGriffonFlightBatch& Batch = FlightSubsystem->GetBatch(this);
 
-	float ControlInclinationAngle = UKismetMathLibrary::DegAcos(ControlInclination) - 90;
-	GEngine->AddOnScreenDebugMessage(INDEX_NONE, 0, FColor::Red, FString::Printf(TEXT("ControlInclinationAngle: %f"), ControlInclinationAngle));
+	WriteFlightInputs(Batch);
+	FlightSubsystem->StepFlyer(this, DeltaSeconds);
+	ApplyFlightOutputs(Batch);
+}
 
-	
-	LiftNormalized =	FlightVelocityAngleMultiplierCurve->GetFloatValue(ControlInclinationAngle) *
-						FlightVelocityLiftMultiplierCurve->GetFloatValue(VelocityCurveLiftTime.Length());
+void AGriffonControllerCharacter::WriteFlightInputs(FGriffonFlightBatch& Batch) const
+{
+	// Not GetVelocity(), the component velocity is only updated after the move and we can run several steps before it
+	const FVector Velocity = GetCharacterMovement()->Velocity;
+	const FVector Location = GetActorLocation();
 
-	int32 roundedLiftNormalized = round(LiftNormalized);
-	
-	bCanFly = roundedLiftNormalized == 0 ? false : true;
-
-	//if (BackwardActionIsPressed) // 25:00
-	//else
-
-	// GLIDE // 28:00
-	// Add default Movement Input in the glide direction to glide
-	// and it allow to go faster when going down and slower when going up
-	float ScaleGlidingSpeed = UKismetMathLibrary::MapRangeClamped(ActorVelocity.Z,	-500, 0,
-																					1.5, 0);
-	FlySpeedGliding = FMath::FInterpTo(FlySpeedGliding, ScaleGlidingSpeed, DeltaSeconds,
-																			abs(ControlInclination) + 0.5);
-	
-	FVector GlidingDirection = UKismetMathLibrary::GetForwardVector(FRotator(0, ControlRotation.Yaw, 0)); // looking direction
-	GlidingDirection.Normalize();
-	AddMovementInput(GlidingDirection, FlySpeedGliding);
-	
-	// ADD LIFT FORCE //
-	// What make us glide better when faster
-	float LiftForce =	GetCharacterMovement()->Mass *
-						abs(GetWorld()->GetGravityZ()) *
-						LiftNormalized;
+	Batch.VelocityX[FlightSlot] = Velocity.X;
+	Batch.VelocityY[FlightSlot] = Velocity.Y;
+	Batch.VelocityZ[FlightSlot] = Velocity.Z;
+	Batch.PositionX[FlightSlot] = Location.X;
+	Batch.PositionY[FlightSlot] = Location.Y;
+	Batch.PositionZ[FlightSlot] = Location.Z;
 
-	GetCharacterMovement()->AddForce({0, 0, LiftForce});
+	// Replays run with the control rotation of the replayed move
+	const FRotator ControlRotation = bClientUpdating ? MovementComponent->ReplayControlRotation : GetControlRotation();
 
-	// VELOCITY // 39:00
-	// If can fly we add velocity UP/DOWN on Z (pretty much the flying system)
-	if (bCanFly)
+	if (Batch.bTrigFreeMath)
 	{
-		
-		FVector ActualCharacterVelocity = GetCharacterMovement()->Velocity;
+		// The actor quaternion is what the root component stores, only the control rotation is converted
+		const FQuat ControlQuat = ControlRotation.Quaternion();
+		const FQuat ActorQuat = GetActorQuat();
+
+		Batch.ControlQuatX[FlightSlot] = ControlQuat.X;
+		Batch.ControlQuatY[FlightSlot] = ControlQuat.Y;
+		Batch.ControlQuatZ[FlightSlot] = ControlQuat.Z;
+		Batch.ControlQuatW[FlightSlot] = ControlQuat.W;
+		Batch.ActorQuatX[FlightSlot] = ActorQuat.X;
+		Batch.ActorQuatY[FlightSlot] = ActorQuat.Y;
+		Batch.ActorQuatZ[FlightSlot] = ActorQuat.Z;
+		Batch.ActorQuatW[FlightSlot] = ActorQuat.W;
+	} else
+	{
+		const FRotator ActorRotation = GetActorRotation();
+
+		Batch.ControlPitch[FlightSlot] = ControlRotation.Pitch;
+		Batch.ControlYaw[FlightSlot] = ControlRotation.Yaw;
+		Batch.ControlRoll[FlightSlot] = ControlRotation.Roll;
+		Batch.ActorPitch[FlightSlot] = ActorRotation.Pitch;
+		Batch.ActorYaw[FlightSlot] = ActorRotation.Yaw;
+		Batch.ActorRoll[FlightSlot] = ActorRotation.Roll;
+	}
 
-		float TargetVelocityZ = ControlInclination *
-								GetWorld()->GetGravityZ() *
-								abs(ControlInclination) *
-								10;
-		
-		float NextVelocityZ = FMath::FInterpTo(ActualCharacterVelocity.Z, TargetVelocityZ, DeltaSeconds, 4);
+	Batch.Mass[FlightSlot] = GetCharacterMovement()->Mass;
+	Batch.FlySpeedGliding[FlightSlot] = FlySpeedGliding;
+	Batch.LiftCurves[FlightSlot] = LiftTable;
+	Batch.AngleCurves[FlightSlot] = AngleTable;
+	Batch.InclinationCurves[FlightSlot] = InclinationTable;
+}
 
-		FVector NewVelocityXY = FMath::VInterpTo(ActualCharacterVelocity, GlidingDirection * ActualCharacterVelocity.Length(), DeltaSeconds, 3);
-		
-		GetCharacterMovement()->Velocity = FVector(	NewVelocityXY.X,
-													NewVelocityXY.Y,
-													NextVelocityZ);
-	}
+void AGriffonControllerCharacter::ReadFlightState(const FGriffonFlightBatch& Batch)
+{
+	ControlInclination = Batch.ControlInclination[FlightSlot];
+	LiftNormalized = Batch.LiftNormalized[FlightSlot];
+	FlySpeedGliding = Batch.FlySpeedGliding[FlightSlot];
+	bCanFly = Batch.CanFly[FlightSlot] != 0;
+
+	// Pitch of the new velocity, the one the actor rotation goes to
+	const float VelocityX = Batch.VelocityX[FlightSlot];
+	const float VelocityY = Batch.VelocityY[FlightSlot];
+	VelocityAngle = FMath::RadiansToDegrees(FMath::Atan2(Batch.VelocityZ[FlightSlot], FMath::Sqrt(VelocityX * VelocityX + VelocityY * VelocityY)));
+
+	if (IsDebug)
+		GRIFFON_DEBUG_VALUE(Flight, "ControlInclinationAngle", UKismetMathLibrary::DegAcos(ControlInclination) - 90, FColor::Red);
+}
 
-	// ROTATION // 42:00
-	// Prevent drifting in the air
-	FRotator NewRotation;
-	NewRotation.Pitch = GetCharacterMovement()->Velocity.ToOrientationRotator().Pitch;
+void AGriffonControllerCharacter::ApplyFlightOutputs(const FGriffonFlightBatch& Batch)
+{
+	ReadFlightState(Batch);
 
-	FVector VelocityForwardVector(GetCharacterMovement()->Velocity.X, GetCharacterMovement()->Velocity.Y, 0);
-	VelocityForwardVector.Normalize();
+	// GLIDE
+	const FVector GlidingDirection(Batch.GlidingDirectionX[FlightSlot], Batch.GlidingDirectionY[FlightSlot], 0);
+	AddMovementInput(GlidingDirection, FlySpeedGliding);
 
-	float TurnInclination = FVector::DotProduct(UKismetMathLibrary::GetRightVector(GetCharacterMovement()->Velocity.ToOrientationRotator()),
-												UKismetMathLibrary::GetForwardVector(FRotator(0, ActorRotation.Yaw, 0)));
+	// LIFT FORCE
+	GetCharacterMovement()->AddForce({0, 0, Batch.LiftForce[FlightSlot]});
 
-	float TurnInclinationAngle = (UKismetMathLibrary::DegAcos(TurnInclination) - 90) * 3; // 3 constant value, just the roll feel way better, it's too small else
-	TurnInclinationAngle = UKismetMathLibrary::FClamp(TurnInclinationAngle, -110, 110);
-	
-	NewRotation.Roll = TurnInclinationAngle;
-	
-	FVector ActorRotationRightVector = UKismetMathLibrary::GetRightVector(ActorRotation);
-	NewRotation.Yaw = UKismetMathLibrary::MakeRotationFromAxes(VelocityForwardVector, ActorRotationRightVector, FVector::UpVector).Yaw;
+	// VELOCITY (unchanged by the kernel when we can't fly)
+	GetCharacterMovement()->Velocity = FVector(	Batch.VelocityX[FlightSlot],
+												Batch.VelocityY[FlightSlot],
+												Batch.VelocityZ[FlightSlot]);
 
-	SetActorRotation(FMath::RInterpTo(ActorRotation, NewRotation, DeltaSeconds, 3));
+	// ROTATION
+	FRotator3f Rotation;
+	if (Batch.bTrigFreeMath)
+	{
+		const FQuat4f Quat(Batch.ActorQuatX[FlightSlot], Batch.ActorQuatY[FlightSlot], Batch.ActorQuatZ[FlightSlot], Batch.ActorQuatW[FlightSlot]);
+		SetActorRotation(FQuat(Quat));
+		Rotation = Quat.Rotator(); // Telemetry only
+	} else
+	{
+		Rotation = FRotator3f(Batch.ActorPitch[FlightSlot], Batch.ActorYaw[FlightSlot], Batch.ActorRoll[FlightSlot]);
+		SetActorRotation(FRotator(Rotation));
+	}
+
+	// TELEMETRY
+	RecordFlightTelemetry(Rotation);
 
 	//
 	if (!GetCharacterMovement()->IsFalling())
 		StopFlying();
 }
 
+void AGriffonControllerCharacter::RecordFlightTelemetry(const FRotator3f& Rotation) const
+{
+	FGriffonFlightTelemetry::Get().Record({	GetWorld()->GetTimeSeconds(), GetUniqueID(), uint32(GFrameCounter),
+											ControlInclination, LiftNormalized, FlySpeedGliding, VelocityAngle,
+											FVector3f(GetCharacterMovement()->Velocity), Rotation});
+}
+
 void AGriffonControllerCharacter::DrawDebug()
 {
-	if (IsDebug == true && GEngine)
+	if (IsDebug == true)
 	{
-		GEngine->AddOnScreenDebugMessage(INDEX_NONE, 0, FColor::Yellow, FString::Printf(TEXT("FlySpeedGliding: %f"), FlySpeedGliding));
-		GEngine->AddOnScreenDebugMessage(INDEX_NONE, 0, FColor::Blue, FString::Printf(TEXT("Velocity: %f"), GetCharacterMovement()->Velocity.Length()));
-		GEngine->AddOnScreenDebugMessage(INDEX_NONE, 0, FColor::Red, FString::Printf(TEXT("ControlInclination: %f"), ControlInclination));
+		GRIFFON_DEBUG_VALUE(Flight, "FlySpeedGliding", FlySpeedGliding, FColor::Yellow);
+		GRIFFON_DEBUG_VALUE(Flight, "Velocity", GetCharacterMovement()->Velocity.Length(), FColor::Blue);
+		GRIFFON_DEBUG_VALUE(Flight, "ControlInclination", ControlInclination, FColor::Red);
 	}
 }
 
 void AGriffonControllerCharacter::StartShapeShifting()
 {
-	GetShapeShiftManager()->ShapeShiftToForm(SSForm_Druid);
+	ServerShapeShiftToForm(SSForm_Druid);
+}
+
+bool AGriffonControllerCharacter::CaptureInput(FShapeShiftInputFrame& OutFrame) const
+{
+	OutFrame.Move = FVector2f(GetActionValue(MoveAction).Get<FVector2D>());
+	OutFrame.ControlRotation = FRotator3f(GetControlRotation());
+	if (GetActionValue(JumpAction).Get<bool>())
+		OutFrame.Buttons |= FShapeShiftInputFrame::Button_Jump;
+	if (GetActionValue(FlyAction).Get<bool>())
+		OutFrame.Buttons |= FShapeShiftInputFrame::Button_Fly;
+
+	return true;
+}
+
+void AGriffonControllerCharacter::ReplayInput(const FShapeShiftInputFrame& Frame, const FShapeShiftInputFrame& Previous)
+{
+	// Same events as the bindings of SetupPlayerInputComponent
+	if (Frame.IsHeld(FShapeShiftInputFrame::Button_Jump))
+		Jump();
+	if (Frame.IsCompleted(Previous, FShapeShiftInputFrame::Button_Jump))
+		StopJumping();
+
+	if (!Frame.Move.IsZero())
+		Move(FInputActionValue(FVector2D(Frame.Move)));
+	else if (!Previous.Move.IsZero())
+		StopFlapping();
+
+	if (Frame.IsStarted(Previous, FShapeShiftInputFrame::Button_Fly))
+		StartFlying();
+}
+
+void AGriffonControllerCharacter::SaveMovementState(FShapeShiftMovementState& OutState) const
+{
+	Super::SaveMovementState(OutState);
+
+	// Falling for the movement component when flying from the tick
+	if (bIsFlying)
+	{
+		OutState.MovementMode = MOVE_Custom;
+		OutState.CustomMovementMode = CMOVE_Flying;
+	}
+}
+
+void AGriffonControllerCharacter::RestoreMovementState(const FShapeShiftMovementState& State)
+{
+	const bool bFlying = State.IsCustomMode(CMOVE_Flying);
+
+	// Still flying from the last time it was possessed. In the flying mode, the movement component enters the flight from falling
+	if (UsesFlyingMovementMode())
+		MovementComponent->bWantsToFly = bFlying;
+	else if (bIsFlying)
+		ExitFlight();
+
+	Super::RestoreMovementState(State);
+
+	if (bFlying && !UsesFlyingMovementMode())
+		EnterFlight();
 }
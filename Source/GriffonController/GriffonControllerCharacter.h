@@ -3,9 +3,16 @@
 #pragma once
 
 #include "InputActionValue.h"
+#include "EnumFile.h"
 #include "ShapeShiftForm.h"
 #include "GriffonControllerCharacter.generated.h"
 
+class UGriffonCharacterMoveComponent;
+class UGriffonFlightCurves;
+class UGriffonFlightSubsystem;
+struct FGriffonBakedCurve;
+struct FGriffonFlightBatch;
+
 
 UCLASS(config=Game)
 class AGriffonControllerCharacter : public AShapeShiftForm
@@ -32,8 +39,16 @@ class AGriffonControllerCharacter : public AShapeShiftForm
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Input, meta = (AllowPrivateAccess = "true"))
 	class UInputAction* FlyAction;
 
+	// Drive the inputs of the griffons
+	friend class UGriffonBenchmarkCommandlet;
+
+protected:
+	/** Custom Movement Component **/
+	UPROPERTY(Category=Character, VisibleAnywhere, BlueprintReadOnly)
+	UGriffonCharacterMoveComponent *MovementComponent;
+
 public:
-	AGriffonControllerCharacter();
+	AGriffonControllerCharacter(const FObjectInitializer& ObjectInitializer);
 	
 
 protected:
@@ -52,26 +67,71 @@ protected:
 	// To add mapping context
 	virtual void BeginPlay();
 
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 public:
 	/** Returns CameraBoom subobject **/
 	FORCEINLINE class USpringArmComponent* GetCameraBoom() const { return CameraBoom; }
 	/** Returns FollowCamera subobject **/
 	FORCEINLINE class UCameraComponent* GetFollowCamera() const { return FollowCamera; }
+	/** Returns CustomMovementComponent subobject **/
+	UFUNCTION(BlueprintPure)
+	FORCEINLINE UGriffonCharacterMoveComponent* GetCustomCharacterMovement() const { return MovementComponent; }
 
     void Tick(float DeltaSeconds) override;
 
 	void StartFlying();
 	void StopFlying();
 
+	/** Flight values of the movement component, by StartFlying/StopFlying or by the Flying movement mode when predicted */
+	void EnterFlight();
+	void ExitFlight();
+
 	void StopFlapping();
 	
 	UPROPERTY(BlueprintReadOnly)
 	bool bIsFlying = false;
+	/** Variable runs the flight once per frame, Fixed makes it independent of the frame rate, Predicted is the one for multiplayer */
+	UPROPERTY(EditAnywhere)
+	TEnumAsByte<EFlightStepMode> FlightStepMode = FlightStep_Variable;
+	/** Fixed and Predicted fly in the Flying custom mode of the movement component */
+	bool UsesFlyingMovementMode() const { return FlightStepMode == FlightStep_Fixed || FlightStepMode == FlightStep_Predicted; }
 	bool bCanFly = true;
 	UPROPERTY(BlueprintReadOnly)
 	bool bIsFlapping = false;
 	
 	void FlyPhysicsCompute(float DeltaSeconds);
+
+	// FLIGHT BATCH
+	// The flight math is done by the flight kernel, the griffon only fill and read its slot
+	void WriteFlightInputs(FGriffonFlightBatch& Batch) const;
+	void ApplyFlightOutputs(const FGriffonFlightBatch& Batch);
+	/** Only the values kept by the griffon, the movement component applies the rest when predicted */
+	void ReadFlightState(const FGriffonFlightBatch& Batch);
+	/** One telemetry sample of the step, from the tick or the movement component */
+	void RecordFlightTelemetry(const FRotator3f& Rotation) const;
+
+	/** Slot in the flight batch while flying */
+	int32 FlightSlot = INDEX_NONE;
+	/** The slot is in the flock batch, set when it took off in FlightStep_Batched */
+	bool bFlockFlightSlot = false;
+	UPROPERTY()
+	UGriffonFlightSubsystem *FlightSubsystem;
+	const FGriffonBakedCurve *LiftTable = nullptr;
+	const FGriffonBakedCurve *AngleTable = nullptr;
+	const FGriffonBakedCurve *InclinationTable = nullptr;
+
+	// FIXED STEP
+	// Stepped by the movement component, the mesh is displayed between the two last steps
+	UPROPERTY(EditAnywhere, meta=(ClampMin="0.002", ClampMax="0.1"))
+	float FlightFixedStep = 1.f / 60;
+	/** Time above this number of steps in one frame is dropped */
+	UPROPERTY(EditAnywhere, meta=(ClampMin="1", ClampMax="16"))
+	int32 MaxFlightSubsteps = 8;
+	float FlightTimeAccumulator = 0;
+	/** Transform of the step before the last one, the actor is at the last one */
+	FVector PreviousFlightLocation;
+	FQuat PreviousFlightRotation;
 	
 	// FLY VALUE
 	UPROPERTY(EditAnywhere)
@@ -95,6 +155,9 @@ public:
 	UCurveFloat *FlightVelocityLiftMultiplierCurve;
 	UPROPERTY(EditAnywhere)
 	UCurveFloat *FlightVelocityAngleMultiplierCurve;
+	/** Baked version of the two curves above, used instead of them when set */
+	UPROPERTY(EditAnywhere)
+	UGriffonFlightCurves *FlightCurves;
 
 	UPROPERTY(BlueprintReadOnly)
 	float ControlInclination;
@@ -110,6 +173,7 @@ public:
 	// DEBUG
 	void DrawDebug();
 	
+	/** Display this griffon values when griffon.Debug.Flight is on */
 	UPROPERTY(EditAnywhere)
 	bool IsDebug = true;
 
@@ -117,5 +181,17 @@ public:
 	/// SHAPESHIFT
 
 	virtual void StartShapeShifting() override;
+
+	///////////////////////////////
+	/// INPUT RECORDING
+
+	virtual bool CaptureInput(FShapeShiftInputFrame& OutFrame) const override;
+	virtual void ReplayInput(const FShapeShiftInputFrame& Frame, const FShapeShiftInputFrame& Previous) override;
+
+	///////////////////////////////
+	/// HANDOFF
+
+	virtual void SaveMovementState(FShapeShiftMovementState& OutState) const override;
+	virtual void RestoreMovementState(const FShapeShiftMovementState& State) override;
 };
 
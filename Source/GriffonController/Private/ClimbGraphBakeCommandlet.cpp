@@ -0,0 +1,274 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClimbGraphBakeCommandlet.h"
+#include "ClimbSurfaceGraph.h"
+#include "GriffonController.h"
+#include "Components/PrimitiveComponent.h"
+#include "Engine/Engine.h"
+#include "Engine/Level.h"
+#include "Engine/World.h"
+#include "Misc/PackageName.h"
+#include "UObject/Package.h"
+#include "UObject/SavePackage.h"
+
+namespace
+{
+	/** Faces kept along one ray, past this the component is a sponge */
+	constexpr int32 MaxFacesPerRay = 16;
+
+	/** Default walkable floor angle of the movement component (44.77 degrees) */
+	constexpr float WalkableFloorZ = 0.71f;
+
+	const FVector RayDirections[] = {FVector::ForwardVector, FVector::BackwardVector, FVector::RightVector, FVector::LeftVector};
+
+	bool IsBakedComponent(const UPrimitiveComponent *Component)
+	{
+		return Component->IsRegistered() && Component->Mobility != EComponentMobility::Movable
+			&& Component->IsCollisionEnabled() && Component->GetCollisionResponseToChannel(ECC_WorldStatic) == ECR_Block;
+	}
+
+	UWorld* LoadBakeWorld(const FString& MapPackageName)
+	{
+		UPackage *Package = LoadPackage(nullptr, *MapPackageName, LOAD_None);
+		UWorld *World = Package ? UWorld::FindWorldInPackage(Package) : nullptr;
+		if (World == nullptr)
+			return nullptr;
+
+		World->AddToRoot();
+		World->WorldType = EWorldType::Editor;
+
+		// Collision only
+		if (!World->bIsWorldInitialized)
+		{
+			World->InitWorld(UWorld::InitializationValues()
+				.InitializeScenes(false)
+				.AllowAudioPlayback(false)
+				.RequiresHitProxies(false)
+				.CreatePhysicsScene(true)
+				.CreateNavigation(false)
+				.CreateAISystem(false)
+				.ShouldSimulatePhysics(false)
+				.EnableTraceCollision(true)
+				.SetTransactional(false)
+				.CreateFXSystem(false));
+		}
+
+		FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Editor);
+		WorldContext.SetCurrentWorld(World);
+
+		World->UpdateWorldComponents(true, false);
+
+		return World;
+	}
+
+	void UnloadBakeWorld(UWorld *World)
+	{
+		GEngine->DestroyWorldContext(World);
+		World->DestroyWorld(false);
+		World->RemoveFromRoot();
+
+		CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+	}
+}
+
+UClimbGraphBakeCommandlet::UClimbGraphBakeCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = true;
+	LogToConsole = true;
+}
+
+int32 UClimbGraphBakeCommandlet::Main(const FString& Params)
+{
+	FString MapsParam;
+
+	constexpr bool bStopOnSeparator = false;
+	FParse::Value(*Params, TEXT("Maps="), MapsParam, bStopOnSeparator);
+	FParse::Value(*Params, TEXT("Spacing="), Spacing);
+	FParse::Value(*Params, TEXT("MaxWallNormalZ="), MaxWallNormalZ);
+	FParse::Value(*Params, TEXT("CapsuleRadius="), CapsuleRadius);
+	FParse::Value(*Params, TEXT("CapsuleHalfHeight="), CapsuleHalfHeight);
+
+	TArray<FString> Maps;
+	MapsParam.ParseIntoArray(Maps, TEXT(","));
+
+	if (Maps.IsEmpty() || Spacing <= 0)
+	{
+		UE_LOG(LogGriffon, Error, TEXT("ClimbGraphBake: no maps or invalid spacing"));
+		return 1;
+	}
+
+	int32 NumFailed = 0;
+	for (const FString& Map : Maps)
+	{
+		NumFailed += !BakeMap(Map);
+	}
+
+	return NumFailed == 0 ? 0 : 1;
+}
+
+bool UClimbGraphBakeCommandlet::BakeMap(const FString& MapPackageName)
+{
+	UWorld *World = LoadBakeWorld(MapPackageName);
+	if (World == nullptr)
+	{
+		UE_LOG(LogGriffon, Error, TEXT("ClimbGraphBake: can't load %s"), *MapPackageName);
+		return false;
+	}
+
+	const double StartTime = FPlatformTime::Seconds();
+
+	// WALLS
+	FBox Bounds(ForceInit);
+	TArray<FClimbGraphPatch> Patches;
+	TSet<FIntVector> Taken;
+
+	for (const AActor *Actor : World->PersistentLevel->Actors)
+	{
+		if (Actor == nullptr)
+			continue;
+
+		TInlineComponentArray<UPrimitiveComponent *> Components(Actor);
+		for (const UPrimitiveComponent *Component : Components)
+		{
+			if (!IsBakedComponent(Component))
+				continue;
+
+			Bounds += Component->Bounds.GetBox();
+			FindPatches(Component, Patches, Taken);
+		}
+	}
+
+	// LEDGES
+	TArray<FClimbGraphLedge> Ledges;
+	FindLedges(World, Patches, Ledges);
+
+	const FString GraphPackageName = UClimbSurfaceGraph::GetGraphPackageName(MapPackageName);
+	UPackage *GraphPackage = CreatePackage(*GraphPackageName);
+	GraphPackage->FullyLoad();
+
+	const FString GraphName = FPackageName::GetShortName(GraphPackageName);
+	UClimbSurfaceGraph *Graph = FindObject<UClimbSurfaceGraph>(GraphPackage, *GraphName);
+	if (Graph == nullptr)
+		Graph = NewObject<UClimbSurfaceGraph>(GraphPackage, *GraphName, RF_Public | RF_Standalone);
+
+	Graph->Build(Bounds, Spacing, MoveTemp(Patches), MoveTemp(Ledges));
+
+	UE_LOG(LogGriffon, Display, TEXT("ClimbGraphBake: %s, %d patches and %d ledges in %.1fs"),
+		*MapPackageName, Graph->GetNumPatches(), Graph->GetNumLedges(), FPlatformTime::Seconds() - StartTime);
+
+	const bool bSaved = SaveGraph(Graph);
+	UnloadBakeWorld(World);
+
+	return bSaved;
+}
+
+void UClimbGraphBakeCommandlet::FindPatches(const UPrimitiveComponent *Component,
+	TArray<FClimbGraphPatch>& OutPatches, TSet<FIntVector>& Taken) const
+{
+	FCollisionQueryParams Params(SCENE_QUERY_STAT(ClimbGraphBake), true);
+	const FBox Box = Component->Bounds.GetBox().ExpandBy(1);
+
+	for (const FVector& Direction : RayDirections)
+	{
+		// Rays cross the whole box, from the side facing Direction
+		const FVector Across(FMath::Abs(Direction.Y), FMath::Abs(Direction.X), 0);
+		const float AcrossMin = FVector::DotProduct(Box.Min, Across);
+		const float AcrossMax = FVector::DotProduct(Box.Max, Across);
+		const FVector Entry = Direction.X + Direction.Y > 0 ? Box.Min : Box.Max;
+		const float Depth = FVector::DotProduct(Box.GetSize(), Direction.GetAbs());
+
+		for (float A = AcrossMin; A <= AcrossMax; A += Spacing)
+			for (float Z = Box.Min.Z; Z <= Box.Max.Z; Z += Spacing)
+			{
+				FVector Start = Entry * Direction.GetAbs() + Across * A + FVector(0, 0, Z);
+				const FVector End = Start + Direction * Depth;
+
+				// Every face met on the way, not only the outer one
+				for (int32 Face = 0; Face < MaxFacesPerRay; Face++)
+				{
+					FHitResult Hit;
+					if (!Component->LineTraceComponent(Hit, Start, End, Params))
+						break;
+
+					if (Hit.bStartPenetrating)
+					{
+						Start += Direction * Spacing;
+						continue;
+					}
+
+					Start = Hit.ImpactPoint + Direction;
+
+					const FVector Normal = Hit.ImpactNormal;
+					if (FVector::DotProduct(Normal, Direction) >= 0 || FMath::Abs(Normal.Z) > MaxWallNormalZ)
+						continue;
+
+					// Moved along the normal, the two sides of a thin wall are two patches
+					const FIntVector Key(FMath::FloorToInt((Hit.ImpactPoint.X + Normal.X * Spacing / 2) / Spacing),
+						FMath::FloorToInt((Hit.ImpactPoint.Y + Normal.Y * Spacing / 2) / Spacing),
+						FMath::FloorToInt((Hit.ImpactPoint.Z + Normal.Z * Spacing / 2) / Spacing));
+
+					bool bAlreadyTaken = false;
+					Taken.Add(Key, &bAlreadyTaken);
+					if (!bAlreadyTaken)
+						OutPatches.Add({FVector3f(Hit.ImpactPoint), FVector3f(Normal)});
+				}
+			}
+	}
+}
+
+void UClimbGraphBakeCommandlet::FindLedges(UWorld *World, const TArray<FClimbGraphPatch>& Patches,
+	TArray<FClimbGraphLedge>& OutLedges) const
+{
+	FCollisionQueryParams Params(SCENE_QUERY_STAT(ClimbGraphBake), true);
+	const FCollisionShape Capsule = FCollisionShape::MakeCapsule(CapsuleRadius, CapsuleHalfHeight);
+
+	TSet<FIntVector> Taken;
+
+	for (const FClimbGraphPatch& Patch : Patches)
+	{
+		const FVector Position(Patch.Position);
+		const FVector Behind = Position - FVector(Patch.Normal).GetSafeNormal2D() * CapsuleRadius;
+
+		// Down behind the wall, from the height the werewolf can pull up to. Inside a thick wall only back faces, no hit
+		FHitResult Hit;
+		if (!World->LineTraceSingleByChannel(Hit, Behind + FVector(0, 0, CapsuleHalfHeight * 2), Behind + FVector(0, 0, 1),
+			ECC_WorldStatic, Params))
+			continue;
+
+		if (Hit.bStartPenetrating || Hit.ImpactNormal.Z < WalkableFloorZ)
+			continue;
+
+		const FIntVector Key(FMath::FloorToInt(Hit.ImpactPoint.X / Spacing), FMath::FloorToInt(Hit.ImpactPoint.Y / Spacing),
+			FMath::FloorToInt(Hit.ImpactPoint.Z / Spacing));
+		if (Taken.Contains(Key))
+			continue;
+
+		const FVector CapsuleCenter = Hit.ImpactPoint + FVector(0, 0, CapsuleHalfHeight + 2);
+		if (World->OverlapBlockingTestByChannel(CapsuleCenter, FQuat::Identity, ECC_WorldStatic, Capsule, Params))
+			continue;
+
+		Taken.Add(Key);
+		OutLedges.Add({FVector3f(Position.X, Position.Y, Hit.ImpactPoint.Z), Patch.Normal, FVector3f(Hit.ImpactPoint)});
+	}
+}
+
+bool UClimbGraphBakeCommandlet::SaveGraph(UClimbSurfaceGraph *Graph) const
+{
+	UPackage *Package = Graph->GetOutermost();
+	const FString Filename = FPackageName::LongPackageNameToFilename(Package->GetName(), FPackageName::GetAssetPackageExtension());
+
+	FSavePackageArgs SaveArgs;
+	SaveArgs.TopLevelFlags = RF_Public | RF_Standalone;
+	SaveArgs.Error = GError;
+
+	if (!UPackage::SavePackage(Package, Graph, *Filename, SaveArgs))
+	{
+		UE_LOG(LogGriffon, Error, TEXT("ClimbGraphBake: can't save %s"), *Filename);
+		return false;
+	}
+
+	return true;
+}
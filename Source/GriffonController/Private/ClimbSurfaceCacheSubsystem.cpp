@@ -0,0 +1,160 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClimbSurfaceCacheSubsystem.h"
+#include "GriffonStats.h"
+#include "Components/PrimitiveComponent.h"
+#include "Engine/World.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Surface Cache Hits"), STAT_ClimbSurfaceCacheHits, STATGROUP_Griffon);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Surface Cache Misses"), STAT_ClimbSurfaceCacheMisses, STATGROUP_Griffon);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Surface Cache Hit Rate %"), STAT_ClimbSurfaceCacheHitRate, STATGROUP_Griffon);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Surface Cache Entries"), STAT_ClimbSurfaceCacheEntries, STATGROUP_Griffon);
+
+void UClimbSurfaceCacheSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	LevelAddedHandle = FWorldDelegates::LevelAddedToWorld.AddUObject(this, &UClimbSurfaceCacheSubsystem::OnLevelChanged);
+	LevelRemovedHandle = FWorldDelegates::LevelRemovedFromWorld.AddUObject(this, &UClimbSurfaceCacheSubsystem::OnLevelChanged);
+
+	Entries.Reserve(ReservedEntries);
+}
+
+void UClimbSurfaceCacheSubsystem::Deinitialize()
+{
+	FWorldDelegates::LevelAddedToWorld.Remove(LevelAddedHandle);
+	FWorldDelegates::LevelRemovedFromWorld.Remove(LevelRemovedHandle);
+
+	Flush();
+
+	Super::Deinitialize();
+}
+
+UClimbSurfaceCacheSubsystem::FKey UClimbSurfaceCacheSubsystem::MakeKey(const FVector& Location, const FVector& Forward)
+{
+	const FIntVector Cell(FMath::FloorToInt(Location.X / CellSize), FMath::FloorToInt(Location.Y / CellSize), FMath::FloorToInt(Location.Z / CellSize));
+
+	// Forward is a unit vector, each component goes from -FacingSteps to FacingSteps
+	const uint32 FacingX = FMath::RoundToInt(Forward.X * FacingSteps) + FacingSteps;
+	const uint32 FacingY = FMath::RoundToInt(Forward.Y * FacingSteps) + FacingSteps;
+	const uint32 FacingZ = FMath::RoundToInt(Forward.Z * FacingSteps) + FacingSteps;
+
+	return {Cell, FacingX | FacingY << 8 | FacingZ << 16};
+}
+
+bool UClimbSurfaceCacheSubsystem::FindSurface(const FVector& Location, const FVector& Forward, FVector& OutPosition, FVector& OutNormal)
+{
+	const FKey Key = MakeKey(Location, Forward);
+
+	bool bHit = false;
+	if (const FEntry *Entry = Entries.Find(Key))
+	{
+		bHit = true;
+		for (const TWeakObjectPtr<const UPrimitiveComponent>& Component : Entry->Components)
+			bHit &= Component.IsValid();
+
+		if (bHit)
+		{
+			OutPosition = Entry->Position;
+			OutNormal = Entry->Normal;
+		} else
+		{
+			// Destroyed without moving
+			RemoveEntry(Key);
+		}
+	}
+
+	NumLookups++;
+	NumHits += bHit;
+
+	INC_DWORD_STAT(bHit ? STAT_ClimbSurfaceCacheHits : STAT_ClimbSurfaceCacheMisses);
+	SET_FLOAT_STAT(STAT_ClimbSurfaceCacheHitRate, 100.f * NumHits / NumLookups);
+
+	return bHit;
+}
+
+void UClimbSurfaceCacheSubsystem::AddSurface(const FVector& Location, const FVector& Forward, const FVector& Position,
+	const FVector& Normal, TArrayView<const UPrimitiveComponent * const> Components)
+{
+	if (Entries.Num() >= MaxEntries)
+		Flush();
+
+	const FKey Key = MakeKey(Location, Forward);
+	if (Entries.Contains(Key))
+		return;
+
+	FEntry& Entry = Entries.Add(Key);
+	Entry.Position = Position;
+	Entry.Normal = Normal;
+
+	for (const UPrimitiveComponent *Component : Components)
+	{
+		if (Entry.Components.Contains(Component))
+			continue;
+
+		Entry.Components.Add(Component);
+
+		// Bound once per component, the next misses on it don't allocate
+		FBoundComponent& Bound = BoundComponents.FindOrAdd(Component);
+		if (!Bound.Component.IsValid())
+		{
+			// Only the game thread moves them, the handle is removed when it moves
+			UPrimitiveComponent *MutableComponent = const_cast<UPrimitiveComponent *>(Component);
+			Bound.Component = MutableComponent;
+			Bound.TransformUpdatedHandle = MutableComponent->TransformUpdated.AddUObject(this, &UClimbSurfaceCacheSubsystem::OnComponentMoved);
+		}
+	}
+
+	SET_DWORD_STAT(STAT_ClimbSurfaceCacheEntries, Entries.Num());
+}
+
+void UClimbSurfaceCacheSubsystem::RemoveEntry(const FKey& Key)
+{
+	Entries.Remove(Key);
+
+	SET_DWORD_STAT(STAT_ClimbSurfaceCacheEntries, Entries.Num());
+}
+
+void UClimbSurfaceCacheSubsystem::OnComponentMoved(USceneComponent *Component, EUpdateTransformFlags UpdateTransformFlags,
+	ETeleportType Teleport)
+{
+	const UPrimitiveComponent *Primitive = CastChecked<UPrimitiveComponent>(Component);
+
+	FBoundComponent Bound;
+	if (!BoundComponents.RemoveAndCopyValue(Primitive, Bound))
+		return;
+
+	Component->TransformUpdated.Remove(Bound.TransformUpdatedHandle);
+
+	// Climbed geometry moving is rare, a key list per component would allocate on every miss instead
+	for (TMap<FKey, FEntry>::TIterator It = Entries.CreateIterator(); It; ++It)
+	{
+		if (It.Value().Components.Contains(Primitive))
+			It.RemoveCurrent();
+	}
+
+	SET_DWORD_STAT(STAT_ClimbSurfaceCacheEntries, Entries.Num());
+}
+
+void UClimbSurfaceCacheSubsystem::OnLevelChanged(ULevel *Level, UWorld *World)
+{
+	// Streamed geometry can be in front of or instead of any wall
+	if (World == GetWorld())
+		Flush();
+}
+
+void UClimbSurfaceCacheSubsystem::Flush()
+{
+	for (const TPair<TObjectKey<UPrimitiveComponent>, FBoundComponent>& Pair : BoundComponents)
+	{
+		if (UPrimitiveComponent *Component = Pair.Value.Component.Get())
+			Component->TransformUpdated.Remove(Pair.Value.TransformUpdatedHandle);
+	}
+
+	// Reset keeps the memory for the next misses
+	Entries.Reset();
+	BoundComponents.Reset();
+
+	SET_DWORD_STAT(STAT_ClimbSurfaceCacheEntries, 0);
+}
@@ -0,0 +1,177 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClimbSurfaceGraph.h"
+#include "GriffonController.h"
+#include "Algo/BinarySearch.h"
+
+namespace
+{
+	const TCHAR *GraphSuffix = TEXT("_ClimbGraph");
+
+	FORCEINLINE bool CellLess(const FIntVector& A, const FIntVector& B)
+	{
+		if (A.Z != B.Z)
+			return A.Z < B.Z;
+		if (A.Y != B.Y)
+			return A.Y < B.Y;
+		return A.X < B.X;
+	}
+}
+
+void UClimbSurfaceGraph::Serialize(FArchive& Ar)
+{
+	Super::Serialize(Ar);
+
+	int32 SavedVersion = Version;
+	Ar << SavedVersion;
+
+	if (Ar.IsLoading() && SavedVersion != Version)
+	{
+		// Not read, the graph is empty until baked again. The bounds came with the properties, without them the traces decide
+		UE_LOG(LogGriffon, Warning, TEXT("%s was baked with version %d, bake it again"), *GetPathName(), SavedVersion);
+		Bounds = FBox(ForceInit);
+		Spacing = 0;
+		Cells.Reset();
+		Patches.Reset();
+		Ledges.Reset();
+		return;
+	}
+
+	// Plain structs, read in one go
+	Cells.BulkSerialize(Ar);
+	Patches.BulkSerialize(Ar);
+	Ledges.BulkSerialize(Ar);
+}
+
+void UClimbSurfaceGraph::Build(const FBox& InBounds, float InSpacing, TArray<FClimbGraphPatch>&& InPatches,
+	TArray<FClimbGraphLedge>&& InLedges)
+{
+	Bounds = InBounds;
+	Spacing = InSpacing;
+
+	// Grouped by cell
+	InPatches.Sort([](const FClimbGraphPatch& A, const FClimbGraphPatch& B)
+	{
+		return CellLess(GetCellCoord(FVector(A.Position)), GetCellCoord(FVector(B.Position)));
+	});
+	InLedges.Sort([](const FClimbGraphLedge& A, const FClimbGraphLedge& B)
+	{
+		return CellLess(GetCellCoord(FVector(A.Position)), GetCellCoord(FVector(B.Position)));
+	});
+
+	Patches = MoveTemp(InPatches);
+	Ledges = MoveTemp(InLedges);
+	Cells.Reset();
+
+	// Merge the two sorted lists into the cells
+	int32 Patch = 0;
+	int32 Ledge = 0;
+
+	while (Patch < Patches.Num() || Ledge < Ledges.Num())
+	{
+		const bool bHasPatch = Patch < Patches.Num();
+		const bool bHasLedge = Ledge < Ledges.Num();
+		const FIntVector PatchCoord = bHasPatch ? GetCellCoord(FVector(Patches[Patch].Position)) : FIntVector::ZeroValue;
+		const FIntVector LedgeCoord = bHasLedge ? GetCellCoord(FVector(Ledges[Ledge].Position)) : FIntVector::ZeroValue;
+
+		FClimbGraphCell& Cell = Cells.AddDefaulted_GetRef();
+		Cell.Coord = !bHasLedge || (bHasPatch && CellLess(PatchCoord, LedgeCoord)) ? PatchCoord : LedgeCoord;
+		Cell.FirstPatch = Patch;
+		Cell.FirstLedge = Ledge;
+
+		while (Patch < Patches.Num() && GetCellCoord(FVector(Patches[Patch].Position)) == Cell.Coord)
+			Patch++;
+		while (Ledge < Ledges.Num() && GetCellCoord(FVector(Ledges[Ledge].Position)) == Cell.Coord)
+			Ledge++;
+
+		Cell.NumPatches = Patch - Cell.FirstPatch;
+		Cell.NumLedges = Ledge - Cell.FirstLedge;
+	}
+
+	Cells.Shrink();
+}
+
+FIntVector UClimbSurfaceGraph::GetCellCoord(const FVector& Location)
+{
+	return FIntVector(FMath::FloorToInt(Location.X / CellSize), FMath::FloorToInt(Location.Y / CellSize), FMath::FloorToInt(Location.Z / CellSize));
+}
+
+FString UClimbSurfaceGraph::GetGraphPackageName(const FString& MapPackageName)
+{
+	return MapPackageName + GraphSuffix;
+}
+
+const FClimbGraphCell* UClimbSurfaceGraph::FindCell(const FIntVector& Coord) const
+{
+	const int32 Index = Algo::LowerBoundBy(Cells, Coord, &FClimbGraphCell::Coord, CellLess);
+
+	return Cells.IsValidIndex(Index) && Cells[Index].Coord == Coord ? &Cells[Index] : nullptr;
+}
+
+template <typename FunctorType>
+void UClimbSurfaceGraph::ForEachCell(const FVector& Location, float Radius, FunctorType&& Visit) const
+{
+	const FIntVector Min = GetCellCoord(Location - FVector(Radius));
+	const FIntVector Max = GetCellCoord(Location + FVector(Radius));
+
+	for (int32 Z = Min.Z; Z <= Max.Z; Z++)
+		for (int32 Y = Min.Y; Y <= Max.Y; Y++)
+			for (int32 X = Min.X; X <= Max.X; X++)
+			{
+				if (const FClimbGraphCell *Cell = FindCell(FIntVector(X, Y, Z)))
+					Visit(*Cell);
+			}
+}
+
+const FClimbGraphPatch* UClimbSurfaceGraph::FindPatch(const FVector& Location, const FVector& Forward, float Radius,
+	float MinFacing) const
+{
+	const FVector3f Location3f(Location);
+	const FVector3f Forward3f(Forward);
+
+	const FClimbGraphPatch *Closest = nullptr;
+	float ClosestDistSquared = FMath::Square(Radius);
+
+	ForEachCell(Location, Radius, [&](const FClimbGraphCell& Cell)
+	{
+		for (const FClimbGraphPatch& Patch : MakeArrayView(Patches.GetData() + Cell.FirstPatch, Cell.NumPatches))
+		{
+			const float DistSquared = FVector3f::DistSquared(Location3f, Patch.Position);
+			if (DistSquared < ClosestDistSquared && FVector3f::DotProduct(Forward3f, -Patch.Normal) >= MinFacing)
+			{
+				Closest = &Patch;
+				ClosestDistSquared = DistSquared;
+			}
+		}
+	});
+
+	return Closest;
+}
+
+const FClimbGraphLedge* UClimbSurfaceGraph::FindLedge(const FVector& Location, const FVector& Forward, float Radius,
+	float MinFacing, float MinHeight, float MaxHeight) const
+{
+	const FVector3f Location3f(Location);
+	const FVector3f Forward3f(Forward);
+
+	const FClimbGraphLedge *Closest = nullptr;
+	float ClosestDistSquared = FMath::Square(Radius);
+
+	ForEachCell(Location, Radius, [&](const FClimbGraphCell& Cell)
+	{
+		for (const FClimbGraphLedge& Ledge : MakeArrayView(Ledges.GetData() + Cell.FirstLedge, Cell.NumLedges))
+		{
+			const float DistSquared = FVector3f::DistSquared(Location3f, Ledge.Position);
+			const float Height = Ledge.Position.Z - Location3f.Z;
+			if (DistSquared < ClosestDistSquared && Height >= MinHeight && Height <= MaxHeight
+				&& FVector3f::DotProduct(Forward3f, -Ledge.Normal) >= MinFacing)
+			{
+				Closest = &Ledge;
+				ClosestDistSquared = DistSquared;
+			}
+		}
+	});
+
+	return Closest;
+}
@@ -0,0 +1,127 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClimbSurfaceGraphSubsystem.h"
+#include "ClimbSurfaceGraph.h"
+#include "Engine/Level.h"
+#include "Engine/World.h"
+#include "Misc/PackageName.h"
+#include "UObject/Package.h"
+
+void UClimbSurfaceGraphSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	LevelAddedHandle = FWorldDelegates::LevelAddedToWorld.AddUObject(this, &UClimbSurfaceGraphSubsystem::OnLevelAdded);
+	LevelRemovedHandle = FWorldDelegates::LevelRemovedFromWorld.AddUObject(this, &UClimbSurfaceGraphSubsystem::OnLevelRemoved);
+}
+
+void UClimbSurfaceGraphSubsystem::Deinitialize()
+{
+	FWorldDelegates::LevelAddedToWorld.Remove(LevelAddedHandle);
+	FWorldDelegates::LevelRemovedFromWorld.Remove(LevelRemovedHandle);
+
+	Graphs.Reset();
+
+	Super::Deinitialize();
+}
+
+void UClimbSurfaceGraphSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	// Levels already there, the streamed ones come with OnLevelAdded
+	for (ULevel *Level : InWorld.GetLevels())
+	{
+		if (Level->bIsVisible)
+			LoadGraph(Level);
+	}
+}
+
+void UClimbSurfaceGraphSubsystem::LoadGraph(ULevel *Level)
+{
+	if (Graphs.Contains(Level))
+		return;
+
+	// The PIE copies keep the graph of the map they come from
+	const FString MapPackageName = UWorld::RemovePIEPrefix(Level->GetOutermost()->GetName());
+	const FString GraphPackageName = UClimbSurfaceGraph::GetGraphPackageName(MapPackageName);
+
+	if (!FPackageName::DoesPackageExist(GraphPackageName))
+		return;
+
+	// Null until loaded, the level is known to be waiting for it
+	Graphs.Add(Level, nullptr);
+
+	const FString GraphName = FPackageName::GetShortName(GraphPackageName);
+	TWeakObjectPtr<ULevel> WeakLevel = Level;
+
+	LoadPackageAsync(GraphPackageName, FLoadPackageAsyncDelegate::CreateWeakLambda(this,
+		[this, WeakLevel, GraphName](const FName& PackageName, UPackage *Package, EAsyncLoadingResult::Type Result)
+		{
+			ULevel *Level = WeakLevel.Get();
+			if (Result != EAsyncLoadingResult::Succeeded || Level == nullptr || !Graphs.Contains(Level))
+				return;
+
+			Graphs[Level] = FindObject<UClimbSurfaceGraph>(Package, *GraphName);
+		}));
+}
+
+void UClimbSurfaceGraphSubsystem::OnLevelAdded(ULevel *Level, UWorld *World)
+{
+	if (World == GetWorld() && World->HasBegunPlay())
+		LoadGraph(Level);
+}
+
+void UClimbSurfaceGraphSubsystem::OnLevelRemoved(ULevel *Level, UWorld *World)
+{
+	// Null when the whole world goes
+	if (World != GetWorld())
+		return;
+
+	if (Level == nullptr)
+		Graphs.Reset();
+	else
+		Graphs.Remove(Level);
+}
+
+bool UClimbSurfaceGraphSubsystem::IsCovering(const FVector& Location) const
+{
+	for (const TPair<ULevel *, UClimbSurfaceGraph *>& Pair : Graphs)
+	{
+		if (Pair.Value != nullptr && Pair.Value->IsCovering(Location))
+			return true;
+	}
+
+	return false;
+}
+
+const FClimbGraphPatch* UClimbSurfaceGraphSubsystem::FindPatch(const FVector& Location, const FVector& Forward, float Radius,
+	float MinFacing) const
+{
+	for (const TPair<ULevel *, UClimbSurfaceGraph *>& Pair : Graphs)
+	{
+		if (Pair.Value == nullptr)
+			continue;
+
+		if (const FClimbGraphPatch *Patch = Pair.Value->FindPatch(Location, Forward, Radius, MinFacing))
+			return Patch;
+	}
+
+	return nullptr;
+}
+
+const FClimbGraphLedge* UClimbSurfaceGraphSubsystem::FindLedge(const FVector& Location, const FVector& Forward, float Radius,
+	float MinFacing, float MinHeight, float MaxHeight) const
+{
+	for (const TPair<ULevel *, UClimbSurfaceGraph *>& Pair : Graphs)
+	{
+		if (Pair.Value == nullptr)
+			continue;
+
+		if (const FClimbGraphLedge *Ledge = Pair.Value->FindLedge(Location, Forward, Radius, MinFacing, MinHeight, MaxHeight))
+			return Ledge;
+	}
+
+	return nullptr;
+}
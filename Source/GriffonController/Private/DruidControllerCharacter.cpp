@@ -10,9 +10,11 @@
 #include "GameFramework/SpringArmComponent.h"
 #include "EnhancedInputComponent.h"
 #include "EnhancedInputSubsystems.h"
+#include "Engine/AssetManager.h"
 #include "Kismet/KismetMathLibrary.h"
-#include "NiagaraFunctionLibrary.h"
 #include "NiagaraComponent.h"
+#include "GriffonController.h"
+#include "GriffonEffectSubsystem.h"
 #include "ShapeShiftManager.h"
 
 // Sets default values
@@ -73,6 +75,34 @@ void ADruidControllerCharacter::BeginPlay()
 	}
 
 	AnimInstance = GetMesh()->GetAnimInstance();
+
+	// Ready before the first cast, a pool miss spawns the whole system
+	UGriffonEffectSubsystem *Effects = GetWorld()->GetSubsystem<UGriffonEffectSubsystem>();
+	Effects->Prewarm(NS_ShapeShiftCharging, 1);
+	Effects->Prewarm(NS_ShapeShiftCast, 1);
+
+	// Streamed now, built once a local player possesses the druid
+	if (!W_ShapeShiftMenu.IsNull())
+	{
+		ShapeShiftMenuHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(W_ShapeShiftMenu.ToSoftObjectPath(),
+			FStreamableDelegate::CreateUObject(this, &ADruidControllerCharacter::CreateShapeShiftMenu));
+	}
+}
+
+void ADruidControllerCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	// Flushed from the pool, the viewport keeps the widgets
+	if (ShapeShiftMenuInstance)
+		ShapeShiftMenuInstance->RemoveFromParent();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void ADruidControllerCharacter::PawnClientRestart()
+{
+	Super::PawnClientRestart();
+
+	CreateShapeShiftMenu();
 }
 
 void ADruidControllerCharacter::SetupPlayerInputComponent(class UInputComponent* PlayerInputComponent)
@@ -92,6 +122,8 @@ void ADruidControllerCharacter::SetupPlayerInputComponent(class UInputComponent*
 
 		//ShapeShift
 		EnhancedInputComponent->BindAction(ShapeShiftAction, ETriggerEvent::Started, this, &ADruidControllerCharacter::StartShapeShifting);
+		EnhancedInputComponent->BindAction(ShapeShiftAction, ETriggerEvent::Completed, this, &ADruidControllerCharacter::ConfirmShapeShiftForm);
+		EnhancedInputComponent->BindAction(ShapeShiftSelectAction, ETriggerEvent::Triggered, this, &ADruidControllerCharacter::SelectShapeShiftForm);
 	}
 }
 
@@ -125,6 +157,9 @@ void ADruidControllerCharacter::Look(const FInputActionValue& Value)
 	// input is a Vector2D
 	FVector2D LookAxisVector = Value.Get<FVector2D>();
 
+	// Same stick as the radial menu
+	if (bChargeShapeShift && ShapeShiftMenuMode == SSMenu_Radial)
+		return;
 	if (Controller != nullptr)
 	{
 		// add yaw and pitch input to controller
@@ -153,9 +188,11 @@ void ADruidControllerCharacter::StartShapeShifting()
 		{
 			FVector Location = GetActorLocation();
 			Location.Z -= GetCapsuleComponent()->GetScaledCapsuleHalfHeight();
-			NS_ShapeShiftChargingInstance = UNiagaraFunctionLibrary::SpawnSystemAtLocation(GetWorld(), NS_ShapeShiftCharging, Location, GetActorRotation());
+			NS_ShapeShiftChargingInstance = GetWorld()->GetSubsystem<UGriffonEffectSubsystem>()->Play(NS_ShapeShiftCharging, Location, GetActorRotation());
 		}
 
+		// Streams while the menu is open
+		GetShapeShiftManager()->PreloadCandidateForms();
 		ShowShapeShiftMenu();
 	}
 }
@@ -165,10 +202,25 @@ void ADruidControllerCharacter::ShapeShift(EShapeShiftForm form)
 	ShapeToFormInto = form;
 	
 	bChargeShapeShift = false;
+
+	// Prepared during the cast, streamed if it was not a candidate
+	ServerPrepareForm(form);
 	
 	AnimInstance->Montage_Play(CastShapeShiftMontage);
 }
 
+void ADruidControllerCharacter::CancelShapeShifting()
+{
+	bChargeShapeShift = false;
+	bCanMove = true;
+
+	if (NS_ShapeShiftChargingInstance)
+	{
+		GetWorld()->GetSubsystem<UGriffonEffectSubsystem>()->Release(NS_ShapeShiftChargingInstance);
+		NS_ShapeShiftChargingInstance = nullptr;
+	}
+}
+
 bool ADruidControllerCharacter::IsChargingShapeShift() const
 {
 	return bChargeShapeShift;
@@ -178,31 +230,73 @@ void ADruidControllerCharacter::EndShapeShiftCastNotify()
 {
 	bCanMove = true;
 
+	UGriffonEffectSubsystem *Effects = GetWorld()->GetSubsystem<UGriffonEffectSubsystem>();
 	if (NS_ShapeShiftCast)
 	{
-		UNiagaraFunctionLibrary::SpawnSystemAtLocation(GetWorld(), NS_ShapeShiftCast, GetActorLocation(), GetActorRotation());
+		Effects->Play(NS_ShapeShiftCast, GetActorLocation(), GetActorRotation());
 	}
 	if (NS_ShapeShiftChargingInstance)
 	{
-		NS_ShapeShiftChargingInstance->DestroyInstance();
+		Effects->Release(NS_ShapeShiftChargingInstance);
+		NS_ShapeShiftChargingInstance = nullptr;
 	}
 
-	GetShapeShiftManager()->ShapeShiftToForm(ShapeToFormInto);
+	// Both effects of this cast, charging included
+	double EffectSeconds;
+	int32 EffectObjects;
+	Effects->ConsumePlayCost(EffectSeconds, EffectObjects);
+	UE_LOG(LogGriffon, Verbose, TEXT("ShapeShift cast effects: %.3fms, %d objects created"), EffectSeconds * 1000, EffectObjects);
+
+	// The cast plays on the owning client, the server possesses the form
+	ServerShapeShiftToForm(ShapeToFormInto);
 }
 
 void ADruidControllerCharacter::ShowShapeShiftMenu()
 {
-	if (W_ShapeShiftMenu) // Check if the Asset is assigned in the blueprint.
-	{
-		// Create the widget and store it.
-		if (ShapeShiftMenuInstance == nullptr)
-			ShapeShiftMenuInstance = CreateWidget<UShapeShiftMenu>(Cast<APlayerController>(GetController()), W_ShapeShiftMenu);
+	// Already built unless the class was still streaming
+	CreateShapeShiftMenu();
+
+	if (ShapeShiftMenuInstance)
+		ShapeShiftMenuInstance->Show(ShapeShiftMenuMode);
+}
 
-		//let add it to the view port
-		if (ShapeShiftMenuInstance)
-			ShapeShiftMenuInstance->AddToViewport();
+void ADruidControllerCharacter::CreateShapeShiftMenu()
+{
+	// Check if the Asset is assigned in the blueprint and loaded, and the player is local
+	UClass *MenuClass = W_ShapeShiftMenu.Get();
+	APlayerController *PlayerController = Cast<APlayerController>(GetController());
+	if (MenuClass == nullptr || PlayerController == nullptr || !PlayerController->IsLocalController())
+		return;
+
+	if (ShapeShiftMenuInstance)
+	{
+		// Pooled druid possessed by another player
+		if (ShapeShiftMenuInstance->GetOwningPlayer() != PlayerController)
+			ShapeShiftMenuInstance->SetOwningPlayer(PlayerController);
+		return;
 	}
 
+	const double StartTime = FPlatformTime::Seconds();
+
+	// Constructed hidden in the viewport and laid out, showing it is then only a visibility change
+	ShapeShiftMenuInstance = CreateWidget<UShapeShiftMenu>(PlayerController, MenuClass);
 	if (ShapeShiftMenuInstance)
-		ShapeShiftMenuInstance->Show();
+	{
+		ShapeShiftMenuInstance->AddToViewport();
+		ShapeShiftMenuInstance->ForceLayoutPrepass();
+	}
+
+	UE_LOG(LogGriffon, Verbose, TEXT("ShapeShift menu created in %.3fms"), (FPlatformTime::Seconds() - StartTime) * 1000);
+}
+
+void ADruidControllerCharacter::SelectShapeShiftForm(const FInputActionValue& Value)
+{
+	if (bChargeShapeShift && ShapeShiftMenuInstance)
+		ShapeShiftMenuInstance->SelectDirection(Value.Get<FVector2D>());
+}
+
+void ADruidControllerCharacter::ConfirmShapeShiftForm()
+{
+	if (bChargeShapeShift && ShapeShiftMenuInstance)
+		ShapeShiftMenuInstance->ConfirmSelection();
 }
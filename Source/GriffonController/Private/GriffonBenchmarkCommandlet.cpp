@@ -0,0 +1,1186 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GriffonBenchmarkCommandlet.h"
+#include "ClimbSurfaceCacheSubsystem.h"
+#include "GriffonController.h"
+#include "GriffonControllerCharacter.h"
+#include "GriffonFlightCurves.h"
+#include "GriffonFlightKernel.h"
+#include "GriffonWaterBody.h"
+#include "GriffonWaterSubsystem.h"
+#include "SeaCreatureCharacterMoveComponent.h"
+#include "SeaCreatureControllerCharacter.h"
+#include "ShapeShiftForm.h"
+#include "ShapeShiftInputRecording.h"
+#include "ShapeShiftMenu.h"
+#include "WerewolfCharacterMoveComponent.h"
+#include "WerewolfControllerCharacter.h"
+#include "Components/BoxComponent.h"
+#include "Curves/CurveFloat.h"
+#include "Dom/JsonObject.h"
+#include "Engine/Engine.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/StaticMeshActor.h"
+#include "Engine/World.h"
+#include "Framework/Application/SlateApplication.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "GameFramework/Controller.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/WorldSettings.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/FileHelper.h"
+#include "Math/RandomStream.h"
+#include "Misc/Paths.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+#include "UObject/Package.h"
+#include <atomic>
+
+namespace
+{
+	constexpr float FrameDeltaSeconds = 1.f / 60;
+
+	/** Forward everything to the real allocator, counting the allocations */
+	class FCountingMalloc final : public FMalloc
+	{
+	public:
+		explicit FCountingMalloc(FMalloc *InInner) : Inner(InInner) {}
+
+		virtual void* Malloc(SIZE_T Count, uint32 Alignment) override
+		{
+			NumAllocations.fetch_add(1, std::memory_order_relaxed);
+			return Inner->Malloc(Count, Alignment);
+		}
+
+		virtual void* TryMalloc(SIZE_T Count, uint32 Alignment) override
+		{
+			NumAllocations.fetch_add(1, std::memory_order_relaxed);
+			return Inner->TryMalloc(Count, Alignment);
+		}
+
+		virtual void* Realloc(void *Original, SIZE_T Count, uint32 Alignment) override
+		{
+			NumAllocations.fetch_add(1, std::memory_order_relaxed);
+			return Inner->Realloc(Original, Count, Alignment);
+		}
+
+		virtual void* TryRealloc(void *Original, SIZE_T Count, uint32 Alignment) override
+		{
+			NumAllocations.fetch_add(1, std::memory_order_relaxed);
+			return Inner->TryRealloc(Original, Count, Alignment);
+		}
+
+		virtual void Free(void *Original) override { Inner->Free(Original); }
+		virtual SIZE_T QuantizeSize(SIZE_T Count, uint32 Alignment) override { return Inner->QuantizeSize(Count, Alignment); }
+		virtual bool GetAllocationSize(void *Original, SIZE_T& SizeOut) override { return Inner->GetAllocationSize(Original, SizeOut); }
+		virtual void Trim(bool bTrimThreadCaches) override { Inner->Trim(bTrimThreadCaches); }
+		virtual void SetupTLSCachesOnCurrentThread() override { Inner->SetupTLSCachesOnCurrentThread(); }
+		virtual void ClearAndDisableTLSCachesOnCurrentThread() override { Inner->ClearAndDisableTLSCachesOnCurrentThread(); }
+		virtual bool IsInternallyThreadSafe() const override { return Inner->IsInternallyThreadSafe(); }
+		virtual bool ValidateHeap() override { return Inner->ValidateHeap(); }
+		virtual const TCHAR* GetDescriptiveName() override { return TEXT("GriffonBenchmarkCounting"); }
+
+		FMalloc *Inner;
+		std::atomic<uint64> NumAllocations{0};
+	};
+
+	/** Count the allocations done by every thread while in scope */
+	struct FScopedAllocationCounter
+	{
+		FScopedAllocationCounter() : Counting(GMalloc) { GMalloc = &Counting; }
+		~FScopedAllocationCounter() { GMalloc = Counting.Inner; }
+
+		uint64 Num() const { return Counting.NumAllocations.load(std::memory_order_relaxed); }
+
+		FCountingMalloc Counting;
+	};
+
+	/**
+	 * UWorld::BeginPlay only starts the play through the game mode, there is none without a game instance.
+	 * The world settings begin play as the game state would, the actors spawned after get their BeginPlay too.
+	 */
+	void StartBenchmarkPlay(UWorld *World)
+	{
+		World->InitializeActorsForPlay(FURL());
+		World->BeginPlay();
+
+		if (!World->HasBegunPlay())
+		{
+			AWorldSettings *WorldSettings = World->GetWorldSettings();
+			WorldSettings->NotifyBeginPlay();
+			WorldSettings->NotifyMatchStarted();
+		}
+	}
+
+	UWorld* CreateBenchmarkWorld()
+	{
+		UWorld *World = UWorld::CreateWorld(EWorldType::Game, false, TEXT("GriffonBenchmark"));
+
+		FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+		WorldContext.SetCurrentWorld(World);
+
+		StartBenchmarkPlay(World);
+
+		return World;
+	}
+
+	void DestroyBenchmarkWorld(UWorld *World)
+	{
+		GEngine->DestroyWorldContext(World);
+		World->DestroyWorld(false);
+		World->RemoveFromRoot();
+
+		CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+	}
+
+	/** Map of a replay, played as a standalone game without players */
+	UWorld* LoadReplayWorld(const FString& MapName)
+	{
+		UPackage *Package = LoadPackage(nullptr, *MapName, LOAD_None);
+		UWorld *World = Package ? UWorld::FindWorldInPackage(Package) : nullptr;
+		if (World == nullptr)
+			return nullptr;
+
+		World->AddToRoot();
+		World->WorldType = EWorldType::Game;
+
+		FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+		WorldContext.SetCurrentWorld(World);
+
+		if (!World->bIsWorldInitialized)
+			World->InitWorld();
+		World->UpdateWorldComponents(true, false);
+
+		StartBenchmarkPlay(World);
+
+		return World;
+	}
+
+	double Percentile(TArray<double> Values, double Percent)
+	{
+		if (Values.IsEmpty())
+			return 0;
+
+		Values.Sort();
+		return Values[FMath::Clamp(FMath::FloorToInt((Values.Num() - 1) * Percent), 0, Values.Num() - 1)];
+	}
+
+	///////////////////
+	/// FLIGHT MATH
+	// Trig free flight kernel against the rotator one, directly on batches without any world
+
+	constexpr float InclinationTolerance = 1e-3f;
+	constexpr float LiftTolerance = 0.05f; // The inclination table is less precise close to the vertical
+	constexpr float VelocityTolerance = 1; // cm/s
+	constexpr float GlidingDirectionTolerance = 1e-3f;
+	constexpr float RotationToleranceDegrees = 0.5f;
+
+	struct FFlightMathTables
+	{
+		FGriffonBakedCurve Lift;
+		FGriffonBakedCurve Angle;
+		FGriffonBakedCurve Inclination;
+	};
+
+	UCurveFloat* MakeCurve(std::initializer_list<FVector2f> Keys)
+	{
+		UCurveFloat *Curve = NewObject<UCurveFloat>(GetTransientPackage());
+		for (const FVector2f& Key : Keys)
+			Curve->FloatCurve.AddKey(Key.X, Key.Y);
+
+		return Curve;
+	}
+
+	// Representative shapes when no asset is given
+	UCurveFloat* MakeLiftCurve() { return MakeCurve({{0, 0}, {1500, 1}, {4000, 1.2f}}); }
+	// Flat close to the vertical, as the inclination table needs
+	UCurveFloat* MakeAngleCurve() { return MakeCurve({{-90, 0}, {-80, 0}, {-20, 1}, {0, 1}, {45, 0.5f}, {80, 0}, {90, 0}}); }
+
+	void BakeFlightMathTables(FFlightMathTables& Tables, const UGriffonFlightCurves *FlightCurves)
+	{
+		const UCurveFloat *LiftCurve = FlightCurves ? FlightCurves->LiftMultiplierCurve : MakeLiftCurve();
+		const UCurveFloat *AngleCurve = FlightCurves ? FlightCurves->AngleMultiplierCurve : MakeAngleCurve();
+
+		Tables.Lift.Bake(LiftCurve);
+		Tables.Angle.Bake(AngleCurve);
+		Tables.Inclination.BakeInclination(AngleCurve);
+	}
+
+	/** Bake error of the three tables of the asset, or of one made of the representative curves */
+	TSharedRef<FJsonObject> CheckFlightCurves(UGriffonFlightCurves *FlightCurves, bool& bOutPassed)
+	{
+		UGriffonFlightCurves *Curves = FlightCurves;
+		if (Curves == nullptr)
+		{
+			Curves = NewObject<UGriffonFlightCurves>(GetTransientPackage());
+			Curves->LiftMultiplierCurve = MakeLiftCurve();
+			Curves->AngleMultiplierCurve = MakeAngleCurve();
+		}
+
+		bOutPassed = Curves->Bake();
+
+		TSharedRef<FJsonObject> Result = MakeShared<FJsonObject>();
+		Result->SetStringField(TEXT("Asset"), FlightCurves ? FlightCurves->GetPathName() : TEXT("Representative"));
+		Result->SetNumberField(TEXT("LiftError"), Curves->GetLiftTable().ComputeMaxError(Curves->LiftMultiplierCurve));
+		Result->SetNumberField(TEXT("AngleError"), Curves->GetAngleTable().ComputeMaxError(Curves->AngleMultiplierCurve));
+		Result->SetNumberField(TEXT("InclinationError"), Curves->GetInclinationTable().ComputeMaxInclinationError(Curves->AngleMultiplierCurve));
+		Result->SetNumberField(TEXT("MaxAllowedError"), Curves->MaxAllowedBakeError);
+		Result->SetBoolField(TEXT("Passed"), bOutPassed);
+
+		UE_LOG(LogGriffon, Display, TEXT("Flight curves: lift %f, angle %f, inclination %f error, %f allowed"),
+			Result->GetNumberField(TEXT("LiftError")), Result->GetNumberField(TEXT("AngleError")),
+			Result->GetNumberField(TEXT("InclinationError")), Curves->MaxAllowedBakeError);
+
+		return Result;
+	}
+
+	/**
+	 * Random flight states with both the rotator and the quaternion inputs.
+	 * The actor rotation is close to the one the flight converges to, RInterpTo and the normalized lerp
+	 * only match for small rotations.
+	 */
+	FGriffonFlightBatch MakeFlightBatch(int32 NumGriffons, const FFlightMathTables& Tables, int32 Seed)
+	{
+		FGriffonFlightBatch Batch;
+		Batch.GravityZ = -980;
+
+		FRandomStream Random(Seed);
+
+		for (int32 i = 0; i < NumGriffons; i++)
+		{
+			const int32 Slot = Batch.AddSlot();
+
+			const FVector Velocity = Random.GetUnitVector() * Random.FRandRange(0, 3000);
+			const FRotator VelocityRotation = Velocity.ToOrientationRotator();
+			const FRotator ControlRotation(Random.FRandRange(-80, 80), Random.FRandRange(-180, 180), 0);
+			const float TurnAngle = Random.FRandRange(-10, 10);
+			const FRotator ActorRotation(	FMath::Clamp(VelocityRotation.Pitch + Random.FRandRange(-10, 10), -89.f, 89.f),
+											VelocityRotation.Yaw + TurnAngle,
+											TurnAngle * -3 + Random.FRandRange(-10, 10));
+			const FQuat ControlQuat = ControlRotation.Quaternion();
+			const FQuat ActorQuat = ActorRotation.Quaternion();
+
+			Batch.VelocityX[Slot] = Velocity.X;
+			Batch.VelocityY[Slot] = Velocity.Y;
+			Batch.VelocityZ[Slot] = Velocity.Z;
+			Batch.ControlPitch[Slot] = ControlRotation.Pitch;
+			Batch.ControlYaw[Slot] = ControlRotation.Yaw;
+			Batch.ControlRoll[Slot] = ControlRotation.Roll;
+			Batch.ActorPitch[Slot] = ActorRotation.Pitch;
+			Batch.ActorYaw[Slot] = ActorRotation.Yaw;
+			Batch.ActorRoll[Slot] = ActorRotation.Roll;
+			Batch.ControlQuatX[Slot] = ControlQuat.X;
+			Batch.ControlQuatY[Slot] = ControlQuat.Y;
+			Batch.ControlQuatZ[Slot] = ControlQuat.Z;
+			Batch.ControlQuatW[Slot] = ControlQuat.W;
+			Batch.ActorQuatX[Slot] = ActorQuat.X;
+			Batch.ActorQuatY[Slot] = ActorQuat.Y;
+			Batch.ActorQuatZ[Slot] = ActorQuat.Z;
+			Batch.ActorQuatW[Slot] = ActorQuat.W;
+			Batch.Mass[Slot] = 100;
+			Batch.FlySpeedGliding[Slot] = Random.FRandRange(0, 1.5f);
+			Batch.LiftCurves[Slot] = &Tables.Lift;
+			Batch.AngleCurves[Slot] = &Tables.Angle;
+			Batch.InclinationCurves[Slot] = &Tables.Inclination;
+		}
+
+		return Batch;
+	}
+
+	/** One step of both maths on the same states, bOutPassed is false when a difference is above its tolerance */
+	TSharedRef<FJsonObject> CompareFlightMath(const FFlightMathTables& Tables, int32 NumSamples, bool& bOutPassed)
+	{
+		FGriffonFlightBatch Rotators = MakeFlightBatch(NumSamples, Tables, 1);
+		FGriffonFlightBatch TrigFree = Rotators;
+		TrigFree.bTrigFreeMath = true;
+
+		GriffonFlightKernel::Step(Rotators, 0, Rotators.NumGroups(), FrameDeltaSeconds);
+		GriffonFlightKernel::Step(TrigFree, 0, TrigFree.NumGroups(), FrameDeltaSeconds);
+
+		float MaxInclinationError = 0;
+		float MaxLiftError = 0;
+		float MaxVelocityError = 0;
+		float MaxGlidingDirectionError = 0;
+		float MaxRotationError = 0;
+		int32 NumSkipped = 0;
+
+		for (int32 i = 0; i < NumSamples; i++)
+		{
+			MaxInclinationError = FMath::Max(MaxInclinationError, FMath::Abs(Rotators.ControlInclination[i] - TrigFree.ControlInclination[i]));
+			MaxLiftError = FMath::Max(MaxLiftError, FMath::Abs(Rotators.LiftNormalized[i] - TrigFree.LiftNormalized[i]));
+
+			const FVector2f RotatorsDirection(Rotators.GlidingDirectionX[i], Rotators.GlidingDirectionY[i]);
+			const FVector2f TrigFreeDirection(TrigFree.GlidingDirectionX[i], TrigFree.GlidingDirectionY[i]);
+			MaxGlidingDirectionError = FMath::Max(MaxGlidingDirectionError, FVector2f::Distance(RotatorsDirection, TrigFreeDirection));
+
+			const FQuat RotatorsRotation = FRotator(Rotators.ActorPitch[i], Rotators.ActorYaw[i], Rotators.ActorRoll[i]).Quaternion();
+			const FQuat TrigFreeRotation(TrigFree.ActorQuatX[i], TrigFree.ActorQuatY[i], TrigFree.ActorQuatZ[i], TrigFree.ActorQuatW[i]);
+			MaxRotationError = FMath::Max(MaxRotationError, float(FMath::RadiansToDegrees(RotatorsRotation.AngularDistance(TrigFreeRotation))));
+
+			// Right on the can fly limit the lift error can flip it, the velocity is not comparable
+			if (FMath::Abs(FMath::Abs(Rotators.LiftNormalized[i]) - 0.5f) < LiftTolerance)
+			{
+				NumSkipped++;
+				continue;
+			}
+
+			const FVector3f RotatorsVelocity(Rotators.VelocityX[i], Rotators.VelocityY[i], Rotators.VelocityZ[i]);
+			const FVector3f TrigFreeVelocity(TrigFree.VelocityX[i], TrigFree.VelocityY[i], TrigFree.VelocityZ[i]);
+			MaxVelocityError = FMath::Max(MaxVelocityError, FVector3f::Distance(RotatorsVelocity, TrigFreeVelocity));
+		}
+
+		bOutPassed = MaxInclinationError <= InclinationTolerance
+			&& MaxLiftError <= LiftTolerance
+			&& MaxVelocityError <= VelocityTolerance
+			&& MaxGlidingDirectionError <= GlidingDirectionTolerance
+			&& MaxRotationError <= RotationToleranceDegrees;
+
+		TSharedRef<FJsonObject> Result = MakeShared<FJsonObject>();
+		Result->SetNumberField(TEXT("Samples"), NumSamples);
+		Result->SetNumberField(TEXT("SkippedVelocitySamples"), NumSkipped);
+		Result->SetNumberField(TEXT("MaxControlInclinationError"), MaxInclinationError);
+		Result->SetNumberField(TEXT("MaxLiftError"), MaxLiftError);
+		Result->SetNumberField(TEXT("MaxVelocityError"), MaxVelocityError);
+		Result->SetNumberField(TEXT("MaxGlidingDirectionError"), MaxGlidingDirectionError);
+		Result->SetNumberField(TEXT("MaxRotationErrorDegrees"), MaxRotationError);
+		Result->SetBoolField(TEXT("Passed"), bOutPassed);
+
+		UE_LOG(LogGriffon, Display, TEXT("Flight math differential on %d states: inclination %g, lift %g, velocity %g, gliding direction %g, rotation %g deg -> %s"),
+			NumSamples, MaxInclinationError, MaxLiftError, MaxVelocityError, MaxGlidingDirectionError, MaxRotationError,
+			bOutPassed ? TEXT("passed") : TEXT("FAILED"));
+
+		return Result;
+	}
+
+	/** Time of the kernel alone per griffon, single threaded */
+	TSharedRef<FJsonObject> RunFlightMath(const FFlightMathTables& Tables, int32 NumGriffons)
+	{
+		NumGriffons = FMath::Max(1, NumGriffons);
+		const int32 NumIterations = FMath::Max(1, 1000000 / NumGriffons);
+
+		auto MeasureStep = [&Tables, NumGriffons, NumIterations](bool bTrigFree)
+		{
+			FGriffonFlightBatch Batch = MakeFlightBatch(NumGriffons, Tables, 2);
+			Batch.bTrigFreeMath = bTrigFree;
+
+			const double StartTime = FPlatformTime::Seconds();
+			for (int32 Iteration = 0; Iteration < NumIterations; Iteration++)
+				GriffonFlightKernel::Step(Batch, 0, Batch.NumGroups(), FrameDeltaSeconds);
+
+			return (FPlatformTime::Seconds() - StartTime) * 1e9 / (double(NumIterations) * NumGriffons);
+		};
+
+		const double RotatorsNs = MeasureStep(false);
+		const double TrigFreeNs = MeasureStep(true);
+
+		TSharedRef<FJsonObject> Result = MakeShared<FJsonObject>();
+		Result->SetNumberField(TEXT("Griffons"), NumGriffons);
+		Result->SetNumberField(TEXT("RotatorsNsPerGriffon"), RotatorsNs);
+		Result->SetNumberField(TEXT("TrigFreeNsPerGriffon"), TrigFreeNs);
+		Result->SetNumberField(TEXT("Speedup"), TrigFreeNs > 0 ? RotatorsNs / TrigFreeNs : 0);
+
+		UE_LOG(LogGriffon, Display, TEXT("Flight math %d griffons: rotators %.2f ns, trig free %.2f ns per griffon (x%.2f)"),
+			NumGriffons, RotatorsNs, TrigFreeNs, TrigFreeNs > 0 ? RotatorsNs / TrigFreeNs : 0);
+
+		return Result;
+	}
+
+	///////////////////
+	/// LEDGE
+	/** 2 x 10 x 3 m, front at X = 200, top at Z = 300 */
+	void SpawnBenchmarkWall(UWorld *World, UStaticMesh *Cube)
+	{
+		const FTransform WallTransform(FQuat::Identity, FVector(300, 0, 150), FVector(2, 10, 3));
+		AStaticMeshActor *Wall = World->SpawnActorDeferred<AStaticMeshActor>(AStaticMeshActor::StaticClass(), WallTransform);
+		Wall->GetStaticMeshComponent()->SetStaticMesh(Cube);
+		Wall->FinishSpawning(WallTransform);
+	}
+
+	// Ledge check of a werewolf right under the top of a wall, computed on every call then reused
+
+	TSharedRef<FJsonObject> RunLedgeCheck(int32 NumCalls)
+	{
+		TSharedRef<FJsonObject> Result = MakeShared<FJsonObject>();
+
+		UStaticMesh *Cube = LoadObject<UStaticMesh>(nullptr, TEXT("/Engine/BasicShapes/Cube.Cube"));
+		if (Cube == nullptr)
+		{
+			UE_LOG(LogGriffon, Warning, TEXT("Ledge check skipped, no cube mesh"));
+			return Result;
+		}
+
+		UWorld *World = CreateBenchmarkWorld();
+		SpawnBenchmarkWall(World, Cube);
+
+		// Eyes over the top, capsule against the front
+		const FTransform WerewolfTransform(FVector(140, 0, 260));
+		AWerewolfControllerCharacter *Werewolf = World->SpawnActor<AWerewolfControllerCharacter>(AWerewolfControllerCharacter::StaticClass(), WerewolfTransform);
+		UWerewolfCharacterMoveComponent *Movement = Werewolf->GetCustomCharacterMovement();
+		Movement->IsDebug = false;
+
+		FVector MantleTarget;
+		const bool bFound = Movement->FindLedgeMantleTarget(MantleTarget);
+
+		double StartTime = FPlatformTime::Seconds();
+		for (int32 Call = 0; Call < NumCalls; Call++)
+		{
+			Movement->InvalidateLedgeCheck();
+			Movement->CheckLedge();
+		}
+		const double ComputedNs = (FPlatformTime::Seconds() - StartTime) * 1e9 / NumCalls;
+
+		StartTime = FPlatformTime::Seconds();
+		for (int32 Call = 0; Call < NumCalls; Call++)
+			Movement->CheckLedge();
+		const double ReusedNs = (FPlatformTime::Seconds() - StartTime) * 1e9 / NumCalls;
+
+		Result->SetNumberField(TEXT("Calls"), NumCalls);
+		Result->SetBoolField(TEXT("MantleTargetFound"), bFound);
+		Result->SetNumberField(TEXT("ComputedNsPerCall"), ComputedNs);
+		Result->SetNumberField(TEXT("ReusedNsPerCall"), ReusedNs);
+
+		UE_LOG(LogGriffon, Display, TEXT("Ledge check: %.1f ns computed, %.1f ns reused, mantle target %s"),
+			ComputedNs, ReusedNs, bFound ? *MantleTarget.ToString() : TEXT("NOT FOUND"));
+
+		DestroyBenchmarkWorld(World);
+
+		return Result;
+	}
+
+	// Werewolf climbing left and right on the wall at full LOD. Once the first back and forth warmed the arrays and
+	// the surface cache, its movement tick must not allocate
+	TSharedRef<FJsonObject> RunClimbTick(int32 NumFrames, bool& bOutPassed)
+	{
+		constexpr int32 FramesPerSide = 60;
+		// Measured after the back and forth, climbing away from the cells cached during the warm up
+		constexpr int32 MissFrames = FramesPerSide * 2;
+
+		TSharedRef<FJsonObject> Result = MakeShared<FJsonObject>();
+		bOutPassed = false;
+
+		UStaticMesh *Cube = LoadObject<UStaticMesh>(nullptr, TEXT("/Engine/BasicShapes/Cube.Cube"));
+		if (Cube == nullptr)
+		{
+			// Not run is not a pass, the allocations are what this check gates on
+			UE_LOG(LogGriffon, Error, TEXT("Climb tick not run, no cube mesh"));
+			Result->SetBoolField(TEXT("Skipped"), true);
+			return Result;
+		}
+
+		IConsoleVariable *ClimbLOD = IConsoleManager::Get().FindConsoleVariable(TEXT("griffon.Climb.LOD"));
+		const int32 PreviousClimbLOD = ClimbLOD->GetInt();
+		ClimbLOD->Set(ClimbLOD_Full);
+
+		UWorld *World = CreateBenchmarkWorld();
+		SpawnBenchmarkWall(World, Cube);
+
+		// Against the front, well under the top
+		const FTransform WerewolfTransform(FVector(140, 0, 120));
+		AWerewolfControllerCharacter *Werewolf = World->SpawnActor<AWerewolfControllerCharacter>(AWerewolfControllerCharacter::StaticClass(), WerewolfTransform);
+		UWerewolfCharacterMoveComponent *Movement = Werewolf->GetCustomCharacterMovement();
+		Movement->IsDebug = false;
+		Movement->bRunPhysicsWithNoController = true;
+
+		Movement->TryClimbing();
+
+		UClimbSurfaceCacheSubsystem *SurfaceCache = World->GetSubsystem<UClimbSurfaceCacheSubsystem>();
+		int32 NumCacheMisses = 0;
+
+		uint64 NumAllocations = 0;
+		int32 NumAllocatingFrames = 0;
+		int32 NumFramesNotClimbing = 0;
+		TArray<double> FrameTimes;
+		FrameTimes.Reserve(NumFrames + MissFrames);
+
+		const int32 WarmFrame = FramesPerSide * 2;
+		const int32 MissFrame = WarmFrame + NumFrames;
+
+		for (int32 Frame = 0; Frame < MissFrame + MissFrames; Frame++)
+		{
+			const bool bWarm = Frame >= WarmFrame;
+			const float Side = Frame >= MissFrame || (Frame / FramesPerSide) % 2 == 1 ? -1.f : 1.f;
+			Werewolf->AddMovementInput(FVector::RightVector, Side);
+
+			// The component is ticked alone, the wall broadphase and the climbing intent still need the time to pass
+			World->TimeSeconds += FrameDeltaSeconds;
+			World->RealTimeSeconds += FrameDeltaSeconds;
+
+			const int32 NumEntries = SurfaceCache->GetNumEntries();
+
+			FScopedAllocationCounter Allocations;
+			const double StartTime = FPlatformTime::Seconds();
+
+			Movement->TickComponent(FrameDeltaSeconds, LEVELTICK_All, &Movement->PrimaryComponentTick);
+
+			if (bWarm)
+			{
+				FrameTimes.Add(FPlatformTime::Seconds() - StartTime);
+				NumAllocations += Allocations.Num();
+				NumAllocatingFrames += Allocations.Num() > 0 ? 1 : 0;
+				NumFramesNotClimbing += Movement->IsClimbing() ? 0 : 1;
+				NumCacheMisses += SurfaceCache->GetNumEntries() > NumEntries ? 1 : 0;
+			}
+		}
+
+		const bool bClimbing = NumFramesNotClimbing == 0;
+		bOutPassed = bClimbing && NumAllocations == 0 && NumCacheMisses > 0;
+
+		Result->SetNumberField(TEXT("Frames"), NumFrames + MissFrames);
+		Result->SetBoolField(TEXT("Climbing"), bClimbing);
+		Result->SetNumberField(TEXT("FramesNotClimbing"), NumFramesNotClimbing);
+		Result->SetNumberField(TEXT("CacheMisses"), NumCacheMisses);
+		Result->SetNumberField(TEXT("Allocations"), NumAllocations);
+		Result->SetNumberField(TEXT("AllocatingFrames"), NumAllocatingFrames);
+		Result->SetNumberField(TEXT("TickP50Us"), Percentile(FrameTimes, 0.5) * 1e6);
+		Result->SetNumberField(TEXT("TickP99Us"), Percentile(FrameTimes, 0.99) * 1e6);
+
+		UE_LOG(LogGriffon, Display, TEXT("Climb tick: %d of %d frames not climbing, %d surface cache misses, %llu allocations in %d frames"),
+			NumFramesNotClimbing, NumFrames + MissFrames, NumCacheMisses, NumAllocations, NumAllocatingFrames);
+
+		DestroyBenchmarkWorld(World);
+		ClimbLOD->Set(PreviousClimbLOD);
+
+		return Result;
+	}
+
+	///////////////////
+	/// SWIM
+	// Sea creatures swimming in circles in one large body of water, the whole world is ticked
+
+	TSharedRef<FJsonObject> RunSwim(int32 NumSwimmers, int32 NumFrames, bool& bOutPassed)
+	{
+		UWorld *World = CreateBenchmarkWorld();
+
+		// 400 x 400 m, 20 m deep, surface at 0
+		const FTransform WaterTransform(FVector(0, 0, -1000));
+		AGriffonWaterBody *Water = World->SpawnActorDeferred<AGriffonWaterBody>(AGriffonWaterBody::StaticClass(), WaterTransform);
+		Water->GetWaterBox()->SetBoxExtent(FVector(20000, 20000, 1000));
+		Water->FinishSpawning(WaterTransform);
+
+		// Under the surface, far enough to never collide
+		TArray<ASeaCreatureControllerCharacter *> Swimmers;
+		const int32 GridSize = FMath::CeilToInt(FMath::Sqrt(float(NumSwimmers)));
+		const float Spacing = FMath::Min(1000.f, 38000.f / FMath::Max(1, GridSize));
+
+		for (int32 i = 0; i < NumSwimmers; i++)
+		{
+			const FTransform Transform(FVector((i % GridSize - GridSize / 2) * Spacing, (i / GridSize - GridSize / 2) * Spacing, -500));
+			ASeaCreatureControllerCharacter *Swimmer = World->SpawnActor<ASeaCreatureControllerCharacter>(ASeaCreatureControllerCharacter::StaticClass(), Transform);
+			Swimmer->GetCustomCharacterMovement()->bRunPhysicsWithNoController = true;
+			Swimmers.Add(Swimmer);
+		}
+
+		TArray<double> FrameTimes;
+		FrameTimes.Reserve(NumFrames);
+
+		for (int32 Frame = 0; Frame < NumFrames; Frame++)
+		{
+			for (int32 i = 0; i < Swimmers.Num(); i++)
+			{
+				const float Angle = Frame * 0.02f + i;
+				Swimmers[i]->AddMovementInput(FVector(FMath::Cos(Angle), FMath::Sin(Angle), FMath::Sin(Angle * 0.5f) * 0.3f));
+			}
+
+			const double StartTime = FPlatformTime::Seconds();
+			World->Tick(LEVELTICK_All, FrameDeltaSeconds);
+			FrameTimes.Add(FPlatformTime::Seconds() - StartTime);
+		}
+
+		int32 NumSwimming = 0;
+		for (const ASeaCreatureControllerCharacter *Swimmer : Swimmers)
+			NumSwimming += Swimmer->GetCustomCharacterMovement()->IsCreatureSwimming() ? 1 : 0;
+
+		const int32 NumTiles = World->GetSubsystem<UGriffonWaterSubsystem>()->GetNumTiles();
+
+		// A swimmer out of the water or no height field, the frames measured something else
+		bOutPassed = NumSwimming == NumSwimmers && (NumSwimmers == 0 || NumTiles > 0);
+
+		const double FrameP50 = Percentile(FrameTimes, 0.5);
+
+		TSharedRef<FJsonObject> Result = MakeShared<FJsonObject>();
+		Result->SetNumberField(TEXT("Swimmers"), NumSwimmers);
+		Result->SetNumberField(TEXT("StillSwimming"), NumSwimming);
+		Result->SetNumberField(TEXT("WaterTiles"), NumTiles);
+		Result->SetNumberField(TEXT("FrameP50Ms"), FrameP50 * 1000);
+		Result->SetNumberField(TEXT("FrameP99Ms"), Percentile(FrameTimes, 0.99) * 1000);
+		Result->SetNumberField(TEXT("SwimmerP50Us"), NumSwimmers > 0 ? FrameP50 * 1e6 / NumSwimmers : 0);
+
+		UE_LOG(LogGriffon, Display, TEXT("Swim %d sea creatures: %d swimming, frame p50 %.3f ms p99 %.3f ms, %.2f us per swimmer, %d water tiles"),
+			NumSwimmers, NumSwimming, Result->GetNumberField(TEXT("FrameP50Ms")), Result->GetNumberField(TEXT("FrameP99Ms")),
+			Result->GetNumberField(TEXT("SwimmerP50Us")), NumTiles);
+
+		DestroyBenchmarkWorld(World);
+
+		return Result;
+	}
+
+	///////////////////
+	/// MENU
+	// First open of the shapeshift menu, created on the spot as the druid used to, then precreated as it does now.
+	// Without Slate, in some -nullrhi runs, the widgets can't be built and the menu is skipped
+
+	TSharedRef<FJsonObject> RunMenuOpen(const FString& MenuClassPath)
+	{
+		TSharedRef<FJsonObject> Result = MakeShared<FJsonObject>();
+
+		if (!FSlateApplication::IsInitialized())
+		{
+			UE_LOG(LogGriffon, Warning, TEXT("Menu open skipped, no Slate"));
+			return Result;
+		}
+
+		double StartTime = FPlatformTime::Seconds();
+		UClass *MenuClass = MenuClassPath.IsEmpty() ? UShapeShiftMenu::StaticClass() : LoadClass<UShapeShiftMenu>(nullptr, *MenuClassPath);
+		const double LoadMs = (FPlatformTime::Seconds() - StartTime) * 1000;
+		if (MenuClass == nullptr)
+		{
+			UE_LOG(LogGriffon, Warning, TEXT("Menu open skipped, can't load %s"), *MenuClassPath);
+			return Result;
+		}
+
+		UWorld *World = CreateBenchmarkWorld();
+
+		// Radial, there is no player to show the cursor to
+		StartTime = FPlatformTime::Seconds();
+		UShapeShiftMenu *ColdMenu = CreateWidget<UShapeShiftMenu>(World, MenuClass);
+		ColdMenu->TakeWidget();
+		ColdMenu->Show(SSMenu_Radial);
+		ColdMenu->ForceLayoutPrepass();
+		const double ColdMs = (FPlatformTime::Seconds() - StartTime) * 1000;
+
+		StartTime = FPlatformTime::Seconds();
+		UShapeShiftMenu *Menu = CreateWidget<UShapeShiftMenu>(World, MenuClass);
+		Menu->TakeWidget();
+		Menu->ForceLayoutPrepass();
+		const double PrecreateMs = (FPlatformTime::Seconds() - StartTime) * 1000;
+
+		StartTime = FPlatformTime::Seconds();
+		Menu->Show(SSMenu_Radial);
+		Menu->ForceLayoutPrepass();
+		const double PrecreatedMs = (FPlatformTime::Seconds() - StartTime) * 1000;
+
+		Result->SetStringField(TEXT("MenuClass"), MenuClass->GetPathName());
+		Result->SetNumberField(TEXT("LoadMs"), LoadMs);
+		Result->SetNumberField(TEXT("ColdOpenMs"), ColdMs);
+		Result->SetNumberField(TEXT("PrecreateMs"), PrecreateMs);
+		Result->SetNumberField(TEXT("PrecreatedOpenMs"), PrecreatedMs);
+
+		UE_LOG(LogGriffon, Display, TEXT("Menu open: %.3fms created on the spot, %.3fms precreated (%.3fms ahead), %.1fms load"),
+			ColdMs, PrecreatedMs, PrecreateMs, LoadMs);
+
+		DestroyBenchmarkWorld(World);
+
+		return Result;
+	}
+}
+
+UGriffonBenchmarkCommandlet::UGriffonBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UGriffonBenchmarkCommandlet::Main(const FString& Params)
+{
+	FString OutputPath = FPaths::ProjectSavedDir() / TEXT("Benchmarks") / TEXT("GriffonBenchmark.json");
+	FString CountsParam = TEXT("1,100,1000");
+	FString ModeParam = TEXT("Variable");
+	FString GriffonClassParam, FlightCurvesParam, MenuClassParam;
+	int32 NumFrames = 600;
+
+	constexpr bool bStopOnSeparator = false;
+	FParse::Value(*Params, TEXT("Output="), OutputPath);
+	FParse::Value(*Params, TEXT("Counts="), CountsParam, bStopOnSeparator);
+	FParse::Value(*Params, TEXT("Mode="), ModeParam);
+	FParse::Value(*Params, TEXT("GriffonClass="), GriffonClassParam);
+	FParse::Value(*Params, TEXT("FlightCurves="), FlightCurvesParam);
+	FParse::Value(*Params, TEXT("MenuClass="), MenuClassParam);
+	FParse::Value(*Params, TEXT("Frames="), NumFrames);
+	const bool bTrigFree = FParse::Param(*Params, TEXT("TrigFree"));
+
+	FString ReplayParam;
+	if (FParse::Value(*Params, TEXT("Replay="), ReplayParam))
+		return RunReplay(ReplayParam, Params, OutputPath);
+
+	if (bTrigFree)
+		IConsoleManager::Get().FindConsoleVariable(TEXT("griffon.Flight.TrigFree"))->Set(1);
+
+	GriffonClass = GriffonClassParam.IsEmpty() ? AGriffonControllerCharacter::StaticClass() : LoadClass<AGriffonControllerCharacter>(nullptr, *GriffonClassParam);
+	FlightCurves = FlightCurvesParam.IsEmpty() ? nullptr : LoadObject<UGriffonFlightCurves>(nullptr, *FlightCurvesParam);
+
+	const int64 ModeValue = StaticEnum<EFlightStepMode>()->GetValueByNameString(TEXT("FlightStep_") + ModeParam);
+	if (GriffonClass == nullptr || ModeValue == INDEX_NONE)
+	{
+		UE_LOG(LogGriffon, Error, TEXT("GriffonBenchmark: invalid griffon class or mode"));
+		return 1;
+	}
+
+	TArray<FString> Counts;
+	CountsParam.ParseIntoArray(Counts, TEXT(","));
+
+	TSharedRef<FJsonObject> Root = MakeShared<FJsonObject>();
+
+	// FLIGHT
+	bool bFlightPassed = true;
+	TArray<TSharedPtr<FJsonValue>> FlightRuns;
+	for (const FString& Count : Counts)
+	{
+		bool bRunPassed = false;
+		FlightRuns.Add(MakeShared<FJsonValueObject>(RunFlight(FCString::Atoi(*Count), NumFrames, EFlightStepMode(ModeValue), bRunPassed)));
+		bFlightPassed &= bRunPassed;
+	}
+	Root->SetArrayField(TEXT("Flight"), FlightRuns);
+	Root->SetBoolField(TEXT("TrigFree"), bTrigFree);
+
+	// FIXED STEP
+	bool bFixedStepPassed = false;
+	Root->SetObjectField(TEXT("FixedStep"), RunFixedStepDivergence(bFixedStepPassed));
+
+	// FLIGHT MATH
+	FFlightMathTables FlightMathTables;
+	BakeFlightMathTables(FlightMathTables, FlightCurves);
+
+	bool bFlightMathPassed = false;
+	bool bFlightCurvesPassed = false;
+	TSharedRef<FJsonObject> FlightMath = MakeShared<FJsonObject>();
+	FlightMath->SetObjectField(TEXT("Curves"), CheckFlightCurves(FlightCurves, bFlightCurvesPassed));
+	FlightMath->SetObjectField(TEXT("Differential"), CompareFlightMath(FlightMathTables, 100000, bFlightMathPassed));
+
+	TArray<TSharedPtr<FJsonValue>> FlightMathRuns;
+	for (const FString& Count : Counts)
+	{
+		FlightMathRuns.Add(MakeShared<FJsonValueObject>(RunFlightMath(FlightMathTables, FCString::Atoi(*Count))));
+	}
+	FlightMath->SetArrayField(TEXT("Speed"), FlightMathRuns);
+	Root->SetObjectField(TEXT("FlightMath"), FlightMath);
+
+	// LEDGE
+	Root->SetObjectField(TEXT("Ledge"), RunLedgeCheck(100000));
+
+	// CLIMB TICK
+	bool bClimbTickPassed = false;
+	Root->SetObjectField(TEXT("ClimbTick"), RunClimbTick(NumFrames, bClimbTickPassed));
+
+	// SWIM
+	bool bSwimPassed = true;
+	TArray<TSharedPtr<FJsonValue>> SwimRuns;
+	for (const FString& Count : Counts)
+	{
+		bool bRunPassed = false;
+		SwimRuns.Add(MakeShared<FJsonValueObject>(RunSwim(FCString::Atoi(*Count), NumFrames, bRunPassed)));
+		bSwimPassed &= bRunPassed;
+	}
+	Root->SetArrayField(TEXT("Swim"), SwimRuns);
+
+	// MENU
+	Root->SetObjectField(TEXT("Menu"), RunMenuOpen(MenuClassParam));
+
+	FString Json;
+	FJsonSerializer::Serialize(Root, TJsonWriterFactory<>::Create(&Json));
+
+	if (!FFileHelper::SaveStringToFile(Json, *OutputPath))
+	{
+		UE_LOG(LogGriffon, Error, TEXT("GriffonBenchmark: can't write %s"), *OutputPath);
+		return 1;
+	}
+
+	UE_LOG(LogGriffon, Display, TEXT("GriffonBenchmark: results written to %s"), *OutputPath);
+
+	if (!bFlightPassed)
+	{
+		UE_LOG(LogGriffon, Error, TEXT("GriffonBenchmark: no griffon was still flying at the end of a flight run"));
+		return 1;
+	}
+
+	if (!bFixedStepPassed)
+	{
+		UE_LOG(LogGriffon, Error, TEXT("GriffonBenchmark: the fixed step flight depends on the frame rate"));
+		return 1;
+	}
+
+	if (!bFlightCurvesPassed)
+	{
+		UE_LOG(LogGriffon, Error, TEXT("GriffonBenchmark: the baked flight curves are further from the curves than allowed"));
+		return 1;
+	}
+
+	if (!bFlightMathPassed)
+	{
+		UE_LOG(LogGriffon, Error, TEXT("GriffonBenchmark: the trig free flight math differs from the rotator one"));
+		return 1;
+	}
+
+	if (!bClimbTickPassed)
+	{
+		UE_LOG(LogGriffon, Error, TEXT("GriffonBenchmark: the werewolf climbing tick allocates or doesn't climb"));
+		return 1;
+	}
+
+	if (!bSwimPassed)
+	{
+		UE_LOG(LogGriffon, Error, TEXT("GriffonBenchmark: a sea creature stopped swimming or the water has no tiles"));
+		return 1;
+	}
+
+	return 0;
+}
+
+///////////////////
+/// FLIGHT
+
+TSharedRef<FJsonObject> UGriffonBenchmarkCommandlet::RunFlight(int32 NumGriffons, int32 NumFrames, EFlightStepMode Mode, bool& bOutPassed)
+{
+	UWorld *World = CreateBenchmarkWorld();
+	const TArray<AGriffonControllerCharacter *> Griffons = SpawnFlyingGriffons(World, NumGriffons, Mode);
+
+	// FRAMES
+	TArray<double> FrameTimes;
+	FrameTimes.Reserve(NumFrames);
+	uint64 NumAllocations = 0;
+
+	for (int32 Frame = 0; Frame < NumFrames; Frame++)
+	{
+		DriveGriffons(Griffons, Frame);
+
+		FScopedAllocationCounter Allocations;
+		const double StartTime = FPlatformTime::Seconds();
+
+		World->Tick(LEVELTICK_All, FrameDeltaSeconds);
+
+		FrameTimes.Add(FPlatformTime::Seconds() - StartTime);
+		NumAllocations += Allocations.Num();
+	}
+
+	int32 NumStillFlying = 0;
+	for (const AGriffonControllerCharacter *Griffon : Griffons)
+		NumStillFlying += Griffon->bIsFlying ? 1 : 0;
+
+	// Nobody flying, the frames measured nothing
+	bOutPassed = NumGriffons == 0 || NumStillFlying > 0;
+
+	// FLY PHYSICS COMPUTE
+	// Same number of calls for every count so small counts are not just noise
+	const int32 NumIterations = FMath::Max(1, 100000 / FMath::Max(1, NumGriffons));
+	int32 NumCalls = 0;
+	const double StartTime = FPlatformTime::Seconds();
+
+	for (int32 Iteration = 0; Iteration < NumIterations; Iteration++)
+	{
+		for (AGriffonControllerCharacter *Griffon : Griffons)
+		{
+			if (Griffon->bIsFlying)
+			{
+				Griffon->FlyPhysicsCompute(FrameDeltaSeconds);
+				NumCalls++;
+			}
+		}
+	}
+
+	const double ComputeTime = FPlatformTime::Seconds() - StartTime;
+
+	TSharedRef<FJsonObject> Result = MakeShared<FJsonObject>();
+	Result->SetNumberField(TEXT("Griffons"), NumGriffons);
+	Result->SetStringField(TEXT("Mode"), StaticEnum<EFlightStepMode>()->GetNameStringByValue(Mode));
+	Result->SetNumberField(TEXT("StillFlying"), NumStillFlying);
+	Result->SetNumberField(TEXT("FlyPhysicsComputeNs"), NumCalls > 0 ? ComputeTime * 1e9 / NumCalls : 0);
+	Result->SetNumberField(TEXT("FrameP50Ms"), Percentile(FrameTimes, 0.5) * 1000);
+	Result->SetNumberField(TEXT("FrameP99Ms"), Percentile(FrameTimes, 0.99) * 1000);
+	Result->SetNumberField(TEXT("AllocationsPerTick"), NumFrames > 0 ? double(NumAllocations) / NumFrames : 0);
+
+	UE_LOG(LogGriffon, Display, TEXT("Flight %d griffons: %.1f ns per FlyPhysicsCompute, frame p50 %.3f ms p99 %.3f ms, %.1f allocations per tick"),
+		NumGriffons, Result->GetNumberField(TEXT("FlyPhysicsComputeNs")), Result->GetNumberField(TEXT("FrameP50Ms")),
+		Result->GetNumberField(TEXT("FrameP99Ms")), Result->GetNumberField(TEXT("AllocationsPerTick")));
+
+	DestroyBenchmarkWorld(World);
+
+	return Result;
+}
+
+TArray<AGriffonControllerCharacter *> UGriffonBenchmarkCommandlet::SpawnFlyingGriffons(UWorld *World, int32 NumGriffons, EFlightStepMode Mode) const
+{
+	TArray<AGriffonControllerCharacter *> Griffons;
+
+	// High enough in an empty world to never land, far enough to never collide
+	const int32 GridSize = FMath::CeilToInt(FMath::Sqrt(float(NumGriffons)));
+	constexpr float Spacing = 1000;
+	constexpr float Height = 100000;
+
+	for (int32 i = 0; i < NumGriffons; i++)
+	{
+		const FTransform Transform(FVector((i % GridSize) * Spacing, (i / GridSize) * Spacing, Height));
+
+		AGriffonControllerCharacter *Griffon = World->SpawnActorDeferred<AGriffonControllerCharacter>(GriffonClass, Transform);
+		if (FlightCurves)
+			Griffon->FlightCurves = FlightCurves;
+		Griffon->FlightStepMode = Mode;
+		Griffon->IsDebug = false;
+		Griffon->FinishSpawning(Transform);
+		Griffon->SpawnDefaultController();
+
+		Griffons.Add(Griffon);
+	}
+
+	// Let them start falling, flying is only possible in the air
+	World->Tick(LEVELTICK_All, FrameDeltaSeconds);
+
+	for (AGriffonControllerCharacter *Griffon : Griffons)
+		Griffon->StartFlying();
+
+	return Griffons;
+}
+
+void UGriffonBenchmarkCommandlet::DriveGriffons(const TArray<AGriffonControllerCharacter *>& Griffons, int32 Frame) const
+{
+	const FVector2D MoveInput(0, 1); // Flap forward
+	const FVector2D LookInput(FMath::Sin(Frame * 0.05f) * 0.5f, FMath::Sin(Frame * 0.02f) * 0.3f);
+
+	for (int32 i = 0; i < Griffons.Num(); i++)
+	{
+		AGriffonControllerCharacter *Griffon = Griffons[i];
+
+		Griffon->Move(FInputActionValue(MoveInput));
+		Griffon->Look(FInputActionValue(LookInput));
+
+		// Look only reach player controllers, turn the AI controller with the same script
+		if (AController *Controller = Griffon->GetController())
+		{
+			const FRotator Rotation(-15 + FMath::Sin(Frame * 0.02f + i) * 20, Frame * 0.3f + i * 7, 0);
+			Controller->SetControlRotation(Rotation);
+		}
+	}
+}
+
+///////////////////
+/// FIXED STEP
+
+TSharedRef<FJsonObject> UGriffonBenchmarkCommandlet::RunFixedStepDivergence(bool& bOutPassed)
+{
+	constexpr float FrameRates[] = {30, 60, 144};
+	constexpr float ReferenceFrameRate = 60;
+	// Only float rounding is allowed between the frame rates
+	constexpr float MaxLocationDivergence = 1; // cm
+	constexpr float MaxVelocityDivergence = 1; // cm/s
+
+	bOutPassed = true;
+	TSharedRef<FJsonObject> Result = MakeShared<FJsonObject>();
+
+	for (const EFlightStepMode Mode : {FlightStep_Fixed, FlightStep_Variable})
+	{
+		FVector ReferenceLocation, ReferenceVelocity;
+		bool bReferenceFlying = false;
+		SimulateFlight(Mode, ReferenceFrameRate, ReferenceLocation, ReferenceVelocity, bReferenceFlying);
+
+		float MaxLocationError = 0, MaxVelocityError = 0;
+		bool bAllFlying = bReferenceFlying;
+
+		for (const float FrameRate : FrameRates)
+		{
+			FVector Location, Velocity;
+			bool bFlying = false;
+			SimulateFlight(Mode, FrameRate, Location, Velocity, bFlying);
+
+			bAllFlying &= bFlying;
+			MaxLocationError = FMath::Max(MaxLocationError, float(FVector::Dist(Location, ReferenceLocation)));
+			MaxVelocityError = FMath::Max(MaxVelocityError, float(FVector::Dist(Velocity, ReferenceVelocity)));
+		}
+
+		const FString ModeName = StaticEnum<EFlightStepMode>()->GetNameStringByValue(Mode);
+		TSharedRef<FJsonObject> ModeResult = MakeShared<FJsonObject>();
+		ModeResult->SetBoolField(TEXT("StillFlying"), bAllFlying);
+		ModeResult->SetNumberField(TEXT("MaxLocationError"), MaxLocationError);
+		ModeResult->SetNumberField(TEXT("MaxVelocityError"), MaxVelocityError);
+		Result->SetObjectField(ModeName, ModeResult);
+
+		UE_LOG(LogGriffon, Display, TEXT("%s flight at 30/60/144 fps: %.3f cm, %.3f cm/s from 60 fps"), *ModeName, MaxLocationError, MaxVelocityError);
+
+		// Variable is only reported, to see what the fixed step saves
+		if (Mode == FlightStep_Fixed)
+			bOutPassed = bAllFlying && MaxLocationError <= MaxLocationDivergence && MaxVelocityError <= MaxVelocityDivergence;
+	}
+
+	return Result;
+}
+
+void UGriffonBenchmarkCommandlet::SimulateFlight(EFlightStepMode Mode, float FrameRate, FVector& OutLocation, FVector& OutVelocity, bool& bOutFlying)
+{
+	constexpr float Duration = 2;
+
+	UWorld *World = CreateBenchmarkWorld();
+	AGriffonControllerCharacter *Griffon = SpawnFlyingGriffons(World, 1, Mode)[0];
+
+	// Same input every frame, only the frame rate changes
+	const int32 NumFrames = FMath::RoundToInt(Duration * FrameRate);
+	for (int32 Frame = 0; Frame < NumFrames; Frame++)
+	{
+		Griffon->Move(FInputActionValue(FVector2D(0, 1)));
+		if (AController *Controller = Griffon->GetController())
+			Controller->SetControlRotation(FRotator(-10, 30, 0));
+
+		World->Tick(LEVELTICK_All, 1 / FrameRate);
+	}
+
+	// Fixed only displays the mesh between two steps, the actor is at the simulated location
+	bOutFlying = Griffon->bIsFlying;
+	OutLocation = Griffon->GetActorLocation();
+	OutVelocity = Griffon->GetCharacterMovement()->Velocity;
+
+	DestroyBenchmarkWorld(World);
+}
+
+///////////////////
+/// REPLAY
+
+int32 UGriffonBenchmarkCommandlet::RunReplay(const FString& ReplayFilename, const FString& Params, const FString& OutputPath) const
+{
+	FString GoldenFilename = FPaths::ChangeExtension(ReplayFilename, TEXT("gsrt"));
+	float MaxLocationError = 0.1f;
+	float MaxRotationError = 0.1f;
+	float MaxCostRatio = 0;
+
+	FParse::Value(*Params, TEXT("Golden="), GoldenFilename);
+	FParse::Value(*Params, TEXT("MaxLocationError="), MaxLocationError);
+	FParse::Value(*Params, TEXT("MaxRotationError="), MaxRotationError);
+	FParse::Value(*Params, TEXT("MaxCostRatio="), MaxCostRatio);
+	const bool bWriteGolden = FParse::Param(*Params, TEXT("WriteGolden"));
+
+	FShapeShiftInputRecording Recording;
+	if (!Recording.Load(ReplayFilename))
+	{
+		UE_LOG(LogGriffon, Error, TEXT("GriffonBenchmark: can't load the replay %s"), *ReplayFilename);
+		return 1;
+	}
+
+	UClass *FormClass = LoadClass<AShapeShiftForm>(nullptr, *Recording.FormClass);
+	UWorld *World = FormClass ? LoadReplayWorld(Recording.MapName) : nullptr;
+	if (World == nullptr)
+	{
+		UE_LOG(LogGriffon, Error, TEXT("GriffonBenchmark: can't load %s or %s"), *Recording.FormClass, *Recording.MapName);
+		return 1;
+	}
+
+	// A player controls the recorded form, the replayed one climbs the same way
+	IConsoleVariable *ClimbLOD = IConsoleManager::Get().FindConsoleVariable(TEXT("griffon.Climb.LOD"));
+	const int32 PreviousClimbLOD = ClimbLOD->GetInt();
+	ClimbLOD->Set(ClimbLOD_Full);
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	AShapeShiftForm *Form = World->SpawnActor<AShapeShiftForm>(FormClass, Recording.StartTransform, SpawnParameters);
+	APlayerController *Controller = World->SpawnActor<APlayerController>();
+	Controller->Possess(Form);
+
+	// Flying or climbing when the recording started, as a shapeshift hands it over
+	Form->RestoreMovementState(Recording.StartMovementState);
+
+	// FRAMES
+	FShapeShiftReplayTrack Track;
+	Track.Samples.Reserve(Recording.Frames.Num());
+	FShapeShiftInputFrame Previous;
+
+	for (const FShapeShiftInputFrame& Frame : Recording.Frames)
+	{
+		const double StartTime = FPlatformTime::Seconds();
+
+		Controller->SetControlRotation(FRotator(Frame.ControlRotation));
+		Form->ReplayInput(Frame, Previous);
+		World->Tick(LEVELTICK_All, Recording.FixedStep);
+
+		const float FrameMs = (FPlatformTime::Seconds() - StartTime) * 1000;
+		Track.Samples.Add({FVector3f(Form->GetActorLocation()), FQuat4f(Form->GetActorQuat()), FrameMs});
+		Previous = Frame;
+	}
+
+	DestroyBenchmarkWorld(World);
+	ClimbLOD->Set(PreviousClimbLOD);
+
+	TSharedRef<FJsonObject> Root = MakeShared<FJsonObject>();
+	Root->SetStringField(TEXT("Replay"), ReplayFilename);
+	Root->SetNumberField(TEXT("Frames"), Track.Samples.Num());
+
+	TArray<double> FrameTimes;
+	for (const FShapeShiftReplayTrack::FSample& Sample : Track.Samples)
+		FrameTimes.Add(Sample.FrameMs);
+	const double FrameP50 = Percentile(FrameTimes, 0.5);
+	Root->SetNumberField(TEXT("FrameP50Ms"), FrameP50);
+	Root->SetNumberField(TEXT("FrameP99Ms"), Percentile(FrameTimes, 0.99));
+
+	// GOLDEN
+	bool bPassed = true;
+
+	if (bWriteGolden)
+	{
+		bPassed = Track.Save(GoldenFilename);
+		UE_LOG(LogGriffon, Display, TEXT("Replay: golden track written to %s"), *GoldenFilename);
+	} else
+	{
+		FShapeShiftReplayTrack Golden;
+		if (!Golden.Load(GoldenFilename) || Golden.Samples.Num() != Track.Samples.Num())
+		{
+			UE_LOG(LogGriffon, Error, TEXT("Replay: no golden track of %d frames in %s, write one with -WriteGolden"),
+				Track.Samples.Num(), *GoldenFilename);
+			bPassed = false;
+		} else
+		{
+			float WorstLocationError = 0;
+			float WorstRotationError = 0;
+			int32 FirstDivergingFrame = INDEX_NONE;
+			TArray<double> GoldenFrameTimes;
+
+			for (int32 Index = 0; Index < Track.Samples.Num(); Index++)
+			{
+				const FShapeShiftReplayTrack::FSample& Sample = Track.Samples[Index];
+				const FShapeShiftReplayTrack::FSample& GoldenSample = Golden.Samples[Index];
+
+				const float LocationError = FVector3f::Dist(Sample.Location, GoldenSample.Location);
+				const float RotationError = FMath::RadiansToDegrees(Sample.Rotation.AngularDistance(GoldenSample.Rotation));
+
+				WorstLocationError = FMath::Max(WorstLocationError, LocationError);
+				WorstRotationError = FMath::Max(WorstRotationError, RotationError);
+				if (FirstDivergingFrame == INDEX_NONE && (LocationError > MaxLocationError || RotationError > MaxRotationError))
+					FirstDivergingFrame = Index;
+
+				GoldenFrameTimes.Add(GoldenSample.FrameMs);
+			}
+
+			const double GoldenFrameP50 = Percentile(GoldenFrameTimes, 0.5);
+			const double CostRatio = GoldenFrameP50 > 0 ? FrameP50 / GoldenFrameP50 : 1;
+
+			Root->SetNumberField(TEXT("MaxLocationError"), WorstLocationError);
+			Root->SetNumberField(TEXT("MaxRotationErrorDegrees"), WorstRotationError);
+			Root->SetNumberField(TEXT("FirstDivergingFrame"), FirstDivergingFrame);
+			Root->SetNumberField(TEXT("GoldenFrameP50Ms"), GoldenFrameP50);
+			Root->SetNumberField(TEXT("CostRatio"), CostRatio);
+
+			UE_LOG(LogGriffon, Display, TEXT("Replay: %.3f cm, %.3f degrees from the golden track, %.2fx its frame cost"),
+				WorstLocationError, WorstRotationError, CostRatio);
+
+			if (FirstDivergingFrame != INDEX_NONE)
+			{
+				UE_LOG(LogGriffon, Error, TEXT("Replay: diverges from the golden track at frame %d"), FirstDivergingFrame);
+				bPassed = false;
+			}
+
+			if (MaxCostRatio > 0 && CostRatio > MaxCostRatio)
+			{
+				UE_LOG(LogGriffon, Error, TEXT("Replay: frames cost %.2fx the golden ones, more than %.2fx"), CostRatio, MaxCostRatio);
+				bPassed = false;
+			}
+		}
+	}
+
+	Root->SetBoolField(TEXT("Passed"), bPassed);
+
+	FString Json;
+	FJsonSerializer::Serialize(Root, TJsonWriterFactory<>::Create(&Json));
+
+	if (!FFileHelper::SaveStringToFile(Json, *OutputPath))
+	{
+		UE_LOG(LogGriffon, Error, TEXT("GriffonBenchmark: can't write %s"), *OutputPath);
+		return 1;
+	}
+
+	return bPassed ? 0 : 1;
+}
@@ -0,0 +1,387 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "GriffonCharacterMoveComponent.h"
+
+#include "GriffonControllerCharacter.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "GriffonFlightKernel.h"
+#include "GriffonFlightSubsystem.h"
+
+///////////////////
+/// SAVED MOVE
+
+void FSavedMove_Griffon::Clear()
+{
+	Super::Clear();
+
+	bSavedWantsToFly = false;
+	bSavedFlapping = false;
+}
+
+uint8 FSavedMove_Griffon::GetCompressedFlags() const
+{
+	uint8 Flags = Super::GetCompressedFlags();
+
+	if (bSavedWantsToFly)
+		Flags |= FLAG_WantsToFly;
+	if (bSavedFlapping)
+		Flags |= FLAG_Flapping;
+
+	return Flags;
+}
+
+void FSavedMove_Griffon::SetMoveFor(ACharacter *Character, float InDeltaTime, FVector const& NewAccel,
+	FNetworkPredictionData_Client_Character& ClientData)
+{
+	Super::SetMoveFor(Character, InDeltaTime, NewAccel, ClientData);
+
+	const AGriffonControllerCharacter *Griffon = CastChecked<AGriffonControllerCharacter>(Character);
+	bSavedWantsToFly = Griffon->GetCustomCharacterMovement()->bWantsToFly;
+	bSavedFlapping = Griffon->bIsFlapping;
+}
+
+void FSavedMove_Griffon::PrepMoveFor(ACharacter *Character)
+{
+	Super::PrepMoveFor(Character);
+
+	CastChecked<AGriffonControllerCharacter>(Character)->GetCustomCharacterMovement()->ReplayControlRotation = SavedControlRotation;
+}
+
+FSavedMovePtr FNetworkPredictionData_Client_Griffon::AllocateNewMove()
+{
+	return FSavedMovePtr(new FSavedMove_Griffon());
+}
+
+///////////////////
+/// MOVE RESPONSE
+
+void FGriffonMoveResponseDataContainer::ServerFillResponseData(const UCharacterMovementComponent& CharacterMovement,
+	const FClientAdjustment& PendingAdjustment)
+{
+	Super::ServerFillResponseData(CharacterMovement, PendingAdjustment);
+
+	const AGriffonControllerCharacter *Griffon = CastChecked<AGriffonControllerCharacter>(CharacterMovement.GetCharacterOwner());
+	QuantizedFlySpeedGliding = UGriffonCharacterMoveComponent::QuantizeFlySpeedGliding(Griffon->FlySpeedGliding);
+
+	bHasFlightRotation = Griffon->GetCustomCharacterMovement()->IsGriffonFlying();
+	if (bHasFlightRotation)
+		FlightRotation = Griffon->GetActorRotation();
+}
+
+bool FGriffonMoveResponseDataContainer::Serialize(UCharacterMovementComponent& CharacterMovement, FArchive& Ar,
+	UPackageMap *PackageMap)
+{
+	if (!Super::Serialize(CharacterMovement, Ar, PackageMap))
+		return false;
+
+	// Acks don't need them
+	if (IsCorrection())
+	{
+		Ar << QuantizedFlySpeedGliding;
+
+		Ar.SerializeBits(&bHasFlightRotation, 1);
+		if (bHasFlightRotation)
+			FlightRotation.SerializeCompressedShort(Ar);
+	}
+
+	return !Ar.IsError();
+}
+
+///////////////////
+/// COMPONENT
+
+UGriffonCharacterMoveComponent::UGriffonCharacterMoveComponent()
+{
+	SetMoveResponseDataContainer(GriffonMoveResponseData);
+}
+
+AGriffonControllerCharacter* UGriffonCharacterMoveComponent::GetGriffonOwner() const
+{
+	return CastChecked<AGriffonControllerCharacter>(CharacterOwner);
+}
+
+///////////////////
+/// FLYING
+
+bool UGriffonCharacterMoveComponent::IsGriffonFlying() const
+{
+	return MovementMode == EMovementMode::MOVE_Custom && CustomMovementMode == ECustomMovementMode::CMOVE_Flying;
+}
+
+uint16 UGriffonCharacterMoveComponent::QuantizeFlySpeedGliding(float FlySpeedGliding)
+{
+	return uint16(FMath::RoundToInt(FMath::Clamp(FlySpeedGliding / MaxFlySpeedGliding, 0.f, 1.f) * MAX_uint16));
+}
+
+float UGriffonCharacterMoveComponent::DequantizeFlySpeedGliding(uint16 Quantized)
+{
+	return Quantized * (MaxFlySpeedGliding / MAX_uint16);
+}
+
+void UGriffonCharacterMoveComponent::UpdateCharacterStateBeforeMovement(float DeltaSeconds)
+{
+	// Same on the client and on the server, bWantsToFly coming from the flags there
+	if (bWantsToFly && IsFalling())
+	{
+		SetMovementMode(EMovementMode::MOVE_Custom, ECustomMovementMode::CMOVE_Flying);
+	} else if (!bWantsToFly && IsGriffonFlying())
+	{
+		SetMovementMode(EMovementMode::MOVE_Falling);
+	}
+
+	Super::UpdateCharacterStateBeforeMovement(DeltaSeconds);
+}
+
+void UGriffonCharacterMoveComponent::OnMovementModeChanged(EMovementMode PreviousMovementMode, uint8 PreviousCustomMode)
+{
+	Super::OnMovementModeChanged(PreviousMovementMode, PreviousCustomMode);
+
+	const bool bWasFlying = PreviousMovementMode == MOVE_Custom && PreviousCustomMode == CMOVE_Flying;
+
+	if (!bWasFlying && IsGriffonFlying())
+	{
+		GetGriffonOwner()->EnterFlight();
+	} else if (bWasFlying && !IsGriffonFlying())
+	{
+		// Landed or stopped
+		bWantsToFly = false;
+		GetGriffonOwner()->ExitFlight();
+
+		// Back on the capsule
+		if (GetGriffonOwner()->FlightStepMode == FlightStep_Fixed)
+			SetFlightMeshOffset(UpdatedComponent->GetComponentLocation(), UpdatedComponent->GetComponentQuat());
+	}
+}
+
+///////////////////
+/// FLYING PHYSICS
+
+void UGriffonCharacterMoveComponent::PhysCustom(float deltaTime, int32 Iterations)
+{
+	if (CustomMovementMode == ECustomMovementMode::CMOVE_Flying)
+	{
+		PhysFlying(deltaTime, Iterations);
+	}
+
+	Super::PhysCustom(deltaTime, Iterations);
+}
+
+void UGriffonCharacterMoveComponent::PhysicsRotation(float DeltaTime)
+{
+	if (IsGriffonFlying())
+		return;
+
+	Super::PhysicsRotation(DeltaTime);
+}
+
+void UGriffonCharacterMoveComponent::PhysFlying(float deltaTime, int32 Iterations)
+{
+	if (deltaTime < MIN_TICK_TIME)
+	{
+		return;
+	}
+
+	AGriffonControllerCharacter *Griffon = GetGriffonOwner();
+	if (Griffon->FlightSlot == INDEX_NONE)
+	{
+		StopFlying(deltaTime, Iterations);
+		return;
+	}
+
+	if (Griffon->FlightStepMode == FlightStep_Fixed)
+		PhysFlyingFixed(deltaTime, Iterations);
+	else
+		PhysFlyingStep(deltaTime, Iterations);
+}
+
+void UGriffonCharacterMoveComponent::PhysFlyingFixed(float deltaTime, int32 Iterations)
+{
+	AGriffonControllerCharacter *Griffon = GetGriffonOwner();
+
+	Griffon->FlightTimeAccumulator += deltaTime;
+
+	// Frame deltas summing to a step must give it, not miss it by a rounding
+	int32 Substeps = FMath::FloorToInt(Griffon->FlightTimeAccumulator / Griffon->FlightFixedStep + KINDA_SMALL_NUMBER);
+	if (Substeps > Griffon->MaxFlightSubsteps)
+	{
+		// Too long frame, drop the time instead of exploding the velocity
+		Substeps = Griffon->MaxFlightSubsteps;
+		Griffon->FlightTimeAccumulator = Substeps * Griffon->FlightFixedStep;
+	}
+
+	// Every step adds the glide to the same player input
+	const FVector InputAcceleration = Acceleration;
+
+	for (int32 i = 0; i < Substeps; i++)
+	{
+		Griffon->PreviousFlightLocation = UpdatedComponent->GetComponentLocation();
+		Griffon->PreviousFlightRotation = UpdatedComponent->GetComponentQuat();
+		Griffon->FlightTimeAccumulator -= Griffon->FlightFixedStep;
+
+		Acceleration = InputAcceleration;
+		PhysFlyingStep(Griffon->FlightFixedStep, Iterations);
+
+		if (!IsGriffonFlying()) // Landed during the step
+			return;
+	}
+
+	Acceleration = InputAcceleration;
+
+	// Display between the two last steps. Only the mesh, the capsule stays on the last step for collisions and the moves
+	const float Alpha = FMath::Clamp(Griffon->FlightTimeAccumulator / Griffon->FlightFixedStep, 0.f, 1.f);
+	const FVector DisplayLocation = FMath::Lerp(Griffon->PreviousFlightLocation, UpdatedComponent->GetComponentLocation(), Alpha);
+	const FQuat DisplayRotation = FQuat::Slerp(Griffon->PreviousFlightRotation, UpdatedComponent->GetComponentQuat(), Alpha);
+	SetFlightMeshOffset(DisplayLocation, DisplayRotation);
+}
+
+void UGriffonCharacterMoveComponent::SetFlightMeshOffset(const FVector& DisplayLocation, const FQuat& DisplayRotation)
+{
+	USkeletalMeshComponent *Mesh = CharacterOwner->GetMesh();
+	if (Mesh == nullptr)
+		return;
+
+	// As the network smoothing, relative to the capsule on top of the base offset
+	const FTransform& Simulated = UpdatedComponent->GetComponentTransform();
+	const FVector MeshLocation = DisplayLocation + DisplayRotation.RotateVector(CharacterOwner->GetBaseTranslationOffset());
+	const FQuat MeshRotation = DisplayRotation * CharacterOwner->GetBaseRotationOffset();
+
+	Mesh->SetRelativeLocationAndRotation(Simulated.InverseTransformPositionNoScale(MeshLocation), Simulated.GetRotation().Inverse() * MeshRotation);
+}
+
+void UGriffonCharacterMoveComponent::PhysFlyingStep(float deltaTime, int32 Iterations)
+{
+	AGriffonControllerCharacter *Griffon = GetGriffonOwner();
+
+	RestorePreAdditiveRootMotionVelocity();
+
+	// FLIGHT MATH
+	FGriffonFlightBatch& Batch = Griffon->FlightSubsystem->GetBatch(Griffon);
+	const int32 Slot = Griffon->FlightSlot;
+
+	Griffon->WriteFlightInputs(Batch);
+	Griffon->FlightSubsystem->StepFlyer(Griffon, deltaTime);
+	Griffon->ReadFlightState(Batch);
+
+	// Corrections send it quantized, the client and the server keep the quantized value
+	Griffon->FlySpeedGliding = DequantizeFlySpeedGliding(QuantizeFlySpeedGliding(Griffon->FlySpeedGliding));
+
+	const FQuat FlightRotation = Batch.bTrigFreeMath
+		? FQuat(Batch.ActorQuatX[Slot], Batch.ActorQuatY[Slot], Batch.ActorQuatZ[Slot], Batch.ActorQuatW[Slot])
+		: FRotator(Batch.ActorPitch[Slot], Batch.ActorYaw[Slot], Batch.ActorRoll[Slot]).Quaternion();
+
+	// VELOCITY (unchanged by the kernel when we can't fly)
+	Velocity = FVector(Batch.VelocityX[Slot], Batch.VelocityY[Slot], Batch.VelocityZ[Slot]);
+
+	if (!HasAnimRootMotion() && !CurrentRootMotion.HasOverrideVelocity())
+	{
+		// GLIDE
+		// Added to the player input, as the AddMovementInput of the other step modes
+		const float MaxAcceleration = GetMaxAcceleration();
+		if (MaxAcceleration > 0)
+		{
+			const FVector GlidingDirection(Batch.GlidingDirectionX[Slot], Batch.GlidingDirectionY[Slot], 0);
+			const FVector Input = Acceleration / MaxAcceleration + GlidingDirection * Griffon->FlySpeedGliding;
+			Acceleration = Input.GetClampedToMaxSize(1) * MaxAcceleration;
+		}
+
+		// Air control on the horizontal velocity, as when falling
+		const float VelocityZ = Velocity.Z;
+		const FVector InputAcceleration = Acceleration;
+		Velocity.Z = 0;
+		Acceleration = GetFallingLateralAcceleration(deltaTime);
+
+		constexpr bool bFluid = false;
+		CalcVelocity(deltaTime, FallingLateralFriction, bFluid, GetMaxBrakingDeceleration());
+
+		Acceleration = InputAcceleration;
+		Velocity.Z = VelocityZ;
+
+		// LIFT FORCE
+		// Integrated here with the gravity, AddForce is not part of the saved moves
+		Velocity.Z += (GetGravityZ() + Batch.LiftForce[Slot] / Mass) * deltaTime;
+	}
+
+	ApplyRootMotionToVelocity(deltaTime);
+
+	// MOVE
+	Iterations++;
+	const FVector OldLocation = UpdatedComponent->GetComponentLocation();
+	const FVector Adjusted = Velocity * deltaTime;
+
+	FHitResult Hit(1.f);
+	SafeMoveUpdatedComponent(Adjusted, FlightRotation, true, Hit);
+
+	if (Hit.Time < 1.f)
+	{
+		if (IsValidLandingSpot(UpdatedComponent->GetComponentLocation(), Hit))
+		{
+			// Walking again ends the flight in OnMovementModeChanged
+			ProcessLanded(Hit, deltaTime * (1.f - Hit.Time), Iterations);
+			return;
+		}
+
+		HandleImpact(Hit, deltaTime, Adjusted);
+		SlideAlongSurface(Adjusted, (1.f - Hit.Time), Hit.Normal, Hit, true);
+	}
+
+	if (!HasAnimRootMotion() && !CurrentRootMotion.HasOverrideVelocity())
+	{
+		Velocity = (UpdatedComponent->GetComponentLocation() - OldLocation) / deltaTime;
+	}
+
+	// TELEMETRY
+	// Not again for the moves replayed after a correction
+	if (!CharacterOwner->bClientUpdating)
+		Griffon->RecordFlightTelemetry(FRotator3f(FlightRotation.Rotator()));
+}
+
+void UGriffonCharacterMoveComponent::StopFlying(float deltaTime, int32 Iterations)
+{
+	bWantsToFly = false;
+	SetMovementMode(EMovementMode::MOVE_Falling);
+	StartNewPhysics(deltaTime, Iterations);
+}
+
+float UGriffonCharacterMoveComponent::GetMaxSpeed() const
+{
+	// The griffon raises MaxWalkSpeed while flying
+	return IsGriffonFlying() ? MaxWalkSpeed : Super::GetMaxSpeed();
+}
+
+///////////////////
+/// NETWORK
+
+FNetworkPredictionData_Client* UGriffonCharacterMoveComponent::GetPredictionData_Client() const
+{
+	if (ClientPredictionData == nullptr)
+	{
+		UGriffonCharacterMoveComponent *MutableThis = const_cast<UGriffonCharacterMoveComponent *>(this);
+		MutableThis->ClientPredictionData = new FNetworkPredictionData_Client_Griffon(*this);
+	}
+
+	return ClientPredictionData;
+}
+
+void UGriffonCharacterMoveComponent::UpdateFromCompressedFlags(uint8 Flags)
+{
+	Super::UpdateFromCompressedFlags(Flags);
+
+	bWantsToFly = (Flags & FSavedMove_Griffon::FLAG_WantsToFly) != 0;
+	GetGriffonOwner()->bIsFlapping = (Flags & FSavedMove_Griffon::FLAG_Flapping) != 0;
+}
+
+void UGriffonCharacterMoveComponent::ClientHandleMoveResponse(const FCharacterMoveResponseDataContainer& MoveResponse)
+{
+	// Before the adjustment, the moves are replayed from it
+	if (MoveResponse.IsCorrection())
+	{
+		const FGriffonMoveResponseDataContainer& GriffonResponse = static_cast<const FGriffonMoveResponseDataContainer&>(MoveResponse);
+		GetGriffonOwner()->FlySpeedGliding = DequantizeFlySpeedGliding(GriffonResponse.QuantizedFlySpeedGliding);
+
+		// The adjustment only moves the location, the rotation is kept for the replays
+		if (GriffonResponse.bHasFlightRotation)
+			UpdatedComponent->SetWorldRotation(GriffonResponse.FlightRotation);
+	}
+
+	Super::ClientHandleMoveResponse(MoveResponse);
+}
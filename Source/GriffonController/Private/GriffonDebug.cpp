@@ -0,0 +1,76 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GriffonDebug.h"
+
+#if GRIFFON_DEBUG
+
+#include "Engine/Engine.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/CoreDelegates.h"
+
+namespace
+{
+	TAutoConsoleVariable<int32> CVarDebugFlight(
+		TEXT("griffon.Debug.Flight"), 0,
+		TEXT("Display the flight values of the griffons with IsDebug set."),
+		ECVF_Cheat);
+
+	TAutoConsoleVariable<int32> CVarDebugClimb(
+		TEXT("griffon.Debug.Climb"), 0,
+		TEXT("Draw the wall detection and climbing traces of the werewolves with IsDebug set."),
+		ECVF_Cheat);
+
+	struct FDebugValue
+	{
+		const TCHAR *Label;
+		float Value;
+		FColor Color;
+	};
+
+	constexpr int32 MaxValuesPerFrame = 256;
+
+	TArray<FDebugValue> FrameValues;
+	bool bFlushRegistered = false;
+
+	void FlushFrameValues()
+	{
+		if (GEngine)
+		{
+			for (const FDebugValue& DebugValue : FrameValues)
+				GEngine->AddOnScreenDebugMessage(INDEX_NONE, 0, DebugValue.Color, FString::Printf(TEXT("%s: %f"), DebugValue.Label, DebugValue.Value));
+		}
+
+		FrameValues.Reset();
+	}
+}
+
+bool GriffonDebug::IsEnabled(EGriffonDebugChannel Channel)
+{
+	switch (Channel)
+	{
+	case EGriffonDebugChannel::Flight:
+		return CVarDebugFlight.GetValueOnGameThread() != 0;
+	case EGriffonDebugChannel::Climb:
+		return CVarDebugClimb.GetValueOnGameThread() != 0;
+	}
+
+	return false;
+}
+
+void GriffonDebug::RecordValue(const TCHAR *Label, float Value, const FColor& Color)
+{
+	check(IsInGameThread());
+
+	if (!bFlushRegistered)
+	{
+		FrameValues.Reserve(MaxValuesPerFrame);
+		FCoreDelegates::OnEndFrame.AddStatic(&FlushFrameValues);
+		bFlushRegistered = true;
+	}
+
+	if (FrameValues.Num() < MaxValuesPerFrame)
+		FrameValues.Add({Label, Value, Color});
+}
+
+#endif
@@ -0,0 +1,145 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GriffonEffectSubsystem.h"
+#include "GriffonStats.h"
+#include "NiagaraComponent.h"
+#include "NiagaraFunctionLibrary.h"
+#include "NiagaraSystem.h"
+#include "HAL/IConsoleManager.h"
+#include "UObject/UObjectArray.h"
+
+DECLARE_CYCLE_STAT(TEXT("Effect Play"), STAT_GriffonEffectPlay, STATGROUP_Griffon);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Effect Pool Misses"), STAT_GriffonEffectPoolMisses, STATGROUP_Griffon);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Effect Objects Created"), STAT_GriffonEffectObjects, STATGROUP_Griffon);
+
+namespace
+{
+	TAutoConsoleVariable<int32> CVarMaxPooled(
+		TEXT("griffon.Effects.MaxPooled"), 8,
+		TEXT("Free components kept for each effect system, the others are destroyed when they complete."));
+}
+
+void UGriffonEffectSubsystem::Deinitialize()
+{
+	// The components go with the world
+	Pools.Reset();
+
+	Super::Deinitialize();
+}
+
+void UGriffonEffectSubsystem::Prewarm(UNiagaraSystem *System, int32 Count)
+{
+	if (System == nullptr)
+		return;
+
+	FGriffonEffectPool& Pool = Pools.FindOrAdd(System);
+	while (Pool.Free.Num() < Count)
+	{
+		UNiagaraComponent *Component = SpawnComponent(System);
+		if (Component == nullptr)
+			return;
+
+		// Activated once so the system instance and its simulation are built now, not on the first play.
+		// Deactivating finishes it, ReturnToPool ignores it as it is not playing
+		Component->Activate(true);
+		Component->DeactivateImmediate();
+
+		Pool.Free.Add(Component);
+	}
+}
+
+UNiagaraComponent* UGriffonEffectSubsystem::Play(UNiagaraSystem *System, const FVector& Location, const FRotator& Rotation)
+{
+	if (System == nullptr)
+		return nullptr;
+
+	SCOPE_CYCLE_COUNTER(STAT_GriffonEffectPlay);
+	const double StartTime = FPlatformTime::Seconds();
+	const int32 StartObjects = GUObjectArray.GetObjectArrayNumMinusAvailable();
+
+	FGriffonEffectPool& Pool = Pools.FindOrAdd(System);
+
+	// Destroyed with their outer when the world changed
+	UNiagaraComponent *Component = nullptr;
+	while (Component == nullptr && !Pool.Free.IsEmpty())
+	{
+		Component = Pool.Free.Pop(false);
+		if (!IsValid(Component))
+			Component = nullptr;
+	}
+
+	if (Component == nullptr)
+	{
+		INC_DWORD_STAT(STAT_GriffonEffectPoolMisses);
+		Component = SpawnComponent(System);
+	}
+
+	if (Component)
+	{
+		Pool.Playing.Add(Component);
+		Component->SetWorldLocationAndRotation(Location, Rotation);
+		Component->Activate(true);
+	}
+
+	const int32 NumObjects = GUObjectArray.GetObjectArrayNumMinusAvailable() - StartObjects;
+	INC_DWORD_STAT_BY(STAT_GriffonEffectObjects, NumObjects);
+	PlaySeconds += FPlatformTime::Seconds() - StartTime;
+	PlayObjects += NumObjects;
+
+	return Component;
+}
+
+void UGriffonEffectSubsystem::Release(UNiagaraComponent *Component)
+{
+	if (Component == nullptr)
+		return;
+
+	// Completing returns it from OnEffectFinished already, if bound
+	Component->DeactivateImmediate();
+	ReturnToPool(Component);
+}
+
+void UGriffonEffectSubsystem::ConsumePlayCost(double& OutSeconds, int32& OutObjects)
+{
+	OutSeconds = PlaySeconds;
+	OutObjects = PlayObjects;
+
+	PlaySeconds = 0;
+	PlayObjects = 0;
+}
+
+UNiagaraComponent* UGriffonEffectSubsystem::SpawnComponent(UNiagaraSystem *System)
+{
+	constexpr bool bAutoDestroy = false;
+	constexpr bool bAutoActivate = false;
+	constexpr bool bPreCullCheck = false;
+
+	UNiagaraComponent *Component = UNiagaraFunctionLibrary::SpawnSystemAtLocation(GetWorld(), System, FVector::ZeroVector,
+		FRotator::ZeroRotator, FVector(1), bAutoDestroy, bAutoActivate, ENCPoolMethod::None, bPreCullCheck);
+
+	if (Component)
+		Component->OnSystemFinished.AddUniqueDynamic(this, &UGriffonEffectSubsystem::OnEffectFinished);
+
+	return Component;
+}
+
+void UGriffonEffectSubsystem::ReturnToPool(UNiagaraComponent *Component)
+{
+	FGriffonEffectPool *Pool = Pools.Find(Component->GetAsset());
+	if (Pool == nullptr || Pool->Playing.RemoveSwap(Component) == 0)
+		return;
+
+	if (Pool->Free.Num() >= CVarMaxPooled.GetValueOnGameThread())
+	{
+		Component->DestroyComponent();
+		return;
+	}
+
+	Pool->Free.Add(Component);
+}
+
+void UGriffonEffectSubsystem::OnEffectFinished(UNiagaraComponent *Component)
+{
+	ReturnToPool(Component);
+}
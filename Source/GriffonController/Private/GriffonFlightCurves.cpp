@@ -0,0 +1,158 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GriffonFlightCurves.h"
+#include "GriffonController.h"
+#include "Curves/CurveFloat.h"
+#include "UObject/ObjectSaveContext.h"
+
+///////////////////
+/// BAKED CURVE
+
+void FGriffonBakedCurve::Bake(const UCurveFloat* Curve)
+{
+	MinTime = 0;
+	InvStep = 0;
+	FMemory::Memzero(Samples);
+
+	if (Curve == nullptr)
+		return;
+
+	float MaxTime;
+	Curve->GetTimeRange(MinTime, MaxTime);
+
+	const float Step = (MaxTime - MinTime) / (Resolution - 1);
+	InvStep = Step > 0 ? 1 / Step : 0;
+
+	for (int32 i = 0; i < Resolution; i++)
+		Samples[i] = Curve->GetFloatValue(MinTime + Step * i);
+}
+
+void FGriffonBakedCurve::BakeInclination(const UCurveFloat* AngleCurve)
+{
+	FMemory::Memzero(Samples);
+
+	// Inclination from -1 to 1
+	MinTime = -1;
+	InvStep = (Resolution - 1) / 2.f;
+
+	if (AngleCurve == nullptr)
+		return;
+
+	for (int32 i = 0; i < Resolution; i++)
+	{
+		const float Inclination = FMath::Min(MinTime + i / InvStep, 1.f);
+		Samples[i] = AngleCurve->GetFloatValue(FMath::RadiansToDegrees(FMath::Acos(Inclination)) - 90);
+	}
+}
+
+float FGriffonBakedCurve::ComputeMaxError(const UCurveFloat* Curve, int32 ChecksPerSample) const
+{
+	if (Curve == nullptr)
+		return 0;
+
+	float CurveMinTime, CurveMaxTime;
+	Curve->GetTimeRange(CurveMinTime, CurveMaxTime);
+
+	// Also check a bit outside of the range, where the table clamps
+	const float Margin = (CurveMaxTime - CurveMinTime) * 0.1f;
+	const int32 NumChecks = Resolution * ChecksPerSample;
+	const float CheckStep = (CurveMaxTime - CurveMinTime + Margin * 2) / NumChecks;
+
+	float MaxError = 0;
+	for (int32 i = 0; i <= NumChecks; i++)
+	{
+		const float Time = CurveMinTime - Margin + CheckStep * i;
+		MaxError = FMath::Max(MaxError, FMath::Abs(Eval(Time) - Curve->GetFloatValue(Time)));
+	}
+
+	return MaxError;
+}
+
+float FGriffonBakedCurve::ComputeMaxInclinationError(const UCurveFloat* AngleCurve, int32 ChecksPerSample) const
+{
+	if (AngleCurve == nullptr)
+		return 0;
+
+	const int32 NumChecks = Resolution * ChecksPerSample;
+
+	float MaxError = 0;
+	for (int32 i = 0; i <= NumChecks; i++)
+	{
+		const float Inclination = FMath::Min(-1 + 2.f * i / NumChecks, 1.f);
+		const float Angle = FMath::RadiansToDegrees(FMath::Acos(Inclination)) - 90;
+		MaxError = FMath::Max(MaxError, FMath::Abs(Eval(Inclination) - AngleCurve->GetFloatValue(Angle)));
+	}
+
+	return MaxError;
+}
+
+///////////////////
+/// ASSET
+
+void UGriffonFlightCurves::PostLoad()
+{
+	Super::PostLoad();
+
+	Bake();
+}
+
+void UGriffonFlightCurves::PreSave(FObjectPreSaveContext SaveContext)
+{
+	Super::PreSave(SaveContext);
+
+	// Check the error on cook/save so a bad curve is reported before it reach the game
+	if (!Bake() && SaveContext.IsCooking())
+	{
+		UE_LOG(LogGriffon, Error, TEXT("%s: baked flight curves error %f is above %f, can't cook it"), *GetName(), MaxBakeError, MaxAllowedBakeError);
+	}
+}
+
+#if WITH_EDITOR
+void UGriffonFlightCurves::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	Bake();
+}
+
+EDataValidationResult UGriffonFlightCurves::IsDataValid(TArray<FText>& ValidationErrors)
+{
+	EDataValidationResult Result = Super::IsDataValid(ValidationErrors);
+
+	if (MaxBakeError > MaxAllowedBakeError)
+	{
+		ValidationErrors.Add(FText::Format(INVTEXT("Baked flight curves error {0} is above {1}, the curves have too much detail for {2} samples"),
+			MaxBakeError, MaxAllowedBakeError, FGriffonBakedCurve::Resolution));
+		Result = EDataValidationResult::Invalid;
+	}
+
+	return Result;
+}
+#endif
+
+bool UGriffonFlightCurves::Bake()
+{
+	// Curves can be loaded after us, keys must be there before sampling
+	if (LiftMultiplierCurve)
+		LiftMultiplierCurve->ConditionalPostLoad();
+	if (AngleMultiplierCurve)
+		AngleMultiplierCurve->ConditionalPostLoad();
+
+	LiftTable.Bake(LiftMultiplierCurve);
+	AngleTable.Bake(AngleMultiplierCurve);
+	InclinationTable.BakeInclination(AngleMultiplierCurve);
+
+	MaxBakeError = FMath::Max3(LiftTable.ComputeMaxError(LiftMultiplierCurve),
+							   AngleTable.ComputeMaxError(AngleMultiplierCurve),
+							   InclinationTable.ComputeMaxInclinationError(AngleMultiplierCurve));
+
+	if (MaxBakeError > MaxAllowedBakeError)
+	{
+		UE_LOG(LogGriffon, Warning, TEXT("%s: baked flight curves error %f is above %f, the curves have too much detail for %d samples"),
+			*GetName(), MaxBakeError, MaxAllowedBakeError, FGriffonBakedCurve::Resolution);
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,552 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GriffonFlightKernel.h"
+#include "GriffonFlightCurves.h"
+#include "Async/ParallelFor.h"
+
+namespace
+{
+	/** Used by empty and padding slots, gives no lift */
+	const FGriffonBakedCurve ZeroCurve;
+	/** Never a real brick, the wind subsystem looks the brick up again */
+	const FIntVector NoWindBrick(MAX_int32);
+
+	constexpr int32 GroupsPerTask = 64;
+
+	template <typename FuncType>
+	void ForEachLaneArray(FGriffonFlightBatch& Batch, FuncType Func)
+	{
+		Func(Batch.VelocityX);
+		Func(Batch.VelocityY);
+		Func(Batch.VelocityZ);
+		Func(Batch.ControlPitch);
+		Func(Batch.ControlYaw);
+		Func(Batch.ControlRoll);
+		Func(Batch.ActorPitch);
+		Func(Batch.ActorYaw);
+		Func(Batch.ActorRoll);
+		Func(Batch.Mass);
+		Func(Batch.PositionX);
+		Func(Batch.PositionY);
+		Func(Batch.PositionZ);
+		Func(Batch.AirVelocityX);
+		Func(Batch.AirVelocityY);
+		Func(Batch.AirVelocityZ);
+		Func(Batch.ControlQuatX);
+		Func(Batch.ControlQuatY);
+		Func(Batch.ControlQuatZ);
+		Func(Batch.ControlQuatW);
+		Func(Batch.ActorQuatX);
+		Func(Batch.ActorQuatY);
+		Func(Batch.ActorQuatZ);
+		Func(Batch.ActorQuatW);
+		Func(Batch.FlySpeedGliding);
+		Func(Batch.ControlInclination);
+		Func(Batch.LiftNormalized);
+		Func(Batch.LiftForce);
+		Func(Batch.CanFly);
+		Func(Batch.GlidingDirectionX);
+		Func(Batch.GlidingDirectionY);
+	}
+
+	using FLane = VectorRegister4Float;
+
+	FORCEINLINE FLane Splat(float Value)
+	{
+		return VectorSetFloat1(Value);
+	}
+
+	FORCEINLINE FLane Clamp(const FLane& Value, const FLane& Min, const FLane& Max)
+	{
+		return VectorMin(VectorMax(Value, Min), Max);
+	}
+
+	/** FMath::FInterpTo, Alpha being DeltaTime * InterpSpeed already clamped */
+	FORCEINLINE FLane InterpTo(const FLane& Current, const FLane& Target, const FLane& Alpha)
+	{
+		const FLane Dist = VectorSubtract(Target, Current);
+		const FLane bReached = VectorCompareLT(VectorMultiply(Dist, Dist), Splat(SMALL_NUMBER));
+
+		return VectorSelect(bReached, Target, VectorMultiplyAdd(Dist, Alpha, Current));
+	}
+
+	/** FRotator::NormalizeAxis, angle in [-180, 180[ */
+	FORCEINLINE FLane NormalizeAxis(const FLane& Angle)
+	{
+		const FLane Turns = VectorFloor(VectorMultiply(VectorAdd(Angle, Splat(180.f)), Splat(1.f / 360.f)));
+
+		return VectorNegateMultiplyAdd(Turns, Splat(360.f), Angle);
+	}
+
+	FORCEINLINE FLane Load(const FGriffonFlightBatch::FLaneArray& Array, int32 Lane)
+	{
+		return VectorLoadAligned(Array.GetData() + Lane);
+	}
+
+	FORCEINLINE void Store(const FLane& Value, FGriffonFlightBatch::FLaneArray& Array, int32 Lane)
+	{
+		VectorStoreAligned(Value, Array.GetData() + Lane);
+	}
+
+	/** Only the lanes set in Mask are written, the others keep their value */
+	template <bool bMasked>
+	FORCEINLINE void Store(const FLane& Value, FGriffonFlightBatch::FLaneArray& Array, int32 Lane, const FLane& Mask)
+	{
+		if constexpr (bMasked)
+			Store(VectorSelect(Mask, Value, Load(Array, Lane)), Array, Lane);
+		else
+			Store(Value, Array, Lane);
+	}
+}
+
+///////////////////
+/// BATCH
+
+int32 FGriffonFlightBatch::AddSlot()
+{
+	const int32 Slot = NumSlots++;
+
+	if (Slot % LaneWidth == 0)
+		SetNumLanes(Slot + LaneWidth);
+
+	ResetSlot(Slot);
+	return Slot;
+}
+
+int32 FGriffonFlightBatch::RemoveSlotSwap(int32 Slot)
+{
+	check(Slot >= 0 && Slot < NumSlots);
+
+	const int32 Last = NumSlots - 1;
+
+	if (Slot != Last)
+	{
+		ForEachLaneArray(*this, [Slot, Last](FLaneArray& Array) { Array[Slot] = Array[Last]; });
+		LiftCurves[Slot] = LiftCurves[Last];
+		AngleCurves[Slot] = AngleCurves[Last];
+		InclinationCurves[Slot] = InclinationCurves[Last];
+		WindBricks[Slot] = WindBricks[Last];
+		WindBrickIndices[Slot] = WindBrickIndices[Last];
+	}
+
+	ResetSlot(Last);
+	NumSlots--;
+
+	if (NumSlots % LaneWidth == 0)
+		SetNumLanes(NumSlots);
+
+	return Slot != Last ? Last : INDEX_NONE;
+}
+
+void FGriffonFlightBatch::ResetSlot(int32 Slot)
+{
+	ForEachLaneArray(*this, [Slot](FLaneArray& Array) { Array[Slot] = 0; });
+	LiftCurves[Slot] = &ZeroCurve;
+	AngleCurves[Slot] = &ZeroCurve;
+	InclinationCurves[Slot] = &ZeroCurve;
+	WindBricks[Slot] = NoWindBrick;
+	WindBrickIndices[Slot] = INDEX_NONE;
+}
+
+void FGriffonFlightBatch::SetNumLanes(int32 NumLanes)
+{
+	constexpr bool bAllowShrinking = false;
+
+	ForEachLaneArray(*this, [NumLanes](FLaneArray& Array) { Array.SetNumZeroed(NumLanes, bAllowShrinking); });
+	LiftCurves.SetNum(NumLanes, bAllowShrinking);
+	AngleCurves.SetNum(NumLanes, bAllowShrinking);
+	InclinationCurves.SetNum(NumLanes, bAllowShrinking);
+	WindBricks.SetNum(NumLanes, bAllowShrinking);
+	WindBrickIndices.SetNum(NumLanes, bAllowShrinking);
+
+	for (int32 Lane = NumSlots; Lane < NumLanes; Lane++)
+	{
+		LiftCurves[Lane] = &ZeroCurve;
+		AngleCurves[Lane] = &ZeroCurve;
+		InclinationCurves[Lane] = &ZeroCurve;
+		WindBricks[Lane] = NoWindBrick;
+		WindBrickIndices[Lane] = INDEX_NONE;
+	}
+}
+
+///////////////////
+/// KERNEL
+
+namespace
+{
+	template <bool bMasked>
+	void StepRotators(FGriffonFlightBatch& Batch, int32 FirstGroup, int32 NumGroups, float DeltaSeconds, const FLane& Mask)
+	{
+		constexpr int32 Width = FGriffonFlightBatch::LaneWidth;
+
+		const FLane Zero = VectorZeroFloat();
+		const FLane One = VectorOneFloat();
+		const FLane DegToRad = Splat(PI / 180.f);
+		const FLane RadToDeg = Splat(180.f / PI);
+		const FLane GravityZ = Splat(Batch.GravityZ);
+		const FLane DeltaTime = Splat(DeltaSeconds);
+
+		for (int32 Group = FirstGroup; Group < FirstGroup + NumGroups; Group++)
+		{
+			const int32 Lane = Group * Width;
+
+			// Velocity relative to the air, the wind pushes the glide and the thermals add lift
+			const FLane AirVelocityX = Load(Batch.AirVelocityX, Lane);
+			const FLane AirVelocityY = Load(Batch.AirVelocityY, Lane);
+			const FLane AirVelocityZ = Load(Batch.AirVelocityZ, Lane);
+			const FLane VelocityX = VectorSubtract(Load(Batch.VelocityX, Lane), AirVelocityX);
+			const FLane VelocityY = VectorSubtract(Load(Batch.VelocityY, Lane), AirVelocityY);
+			const FLane VelocityZ = VectorSubtract(Load(Batch.VelocityZ, Lane), AirVelocityZ);
+
+			FLane SinControlPitch, CosControlPitch, SinControlYaw, CosControlYaw, SinControlRoll, CosControlRoll, SinActorYaw, CosActorYaw;
+			const FLane ControlPitch = VectorMultiply(Load(Batch.ControlPitch, Lane), DegToRad);
+			const FLane ControlYaw = VectorMultiply(Load(Batch.ControlYaw, Lane), DegToRad);
+			const FLane ControlRoll = VectorMultiply(Load(Batch.ControlRoll, Lane), DegToRad);
+			const FLane ActorYawRad = VectorMultiply(Load(Batch.ActorYaw, Lane), DegToRad);
+			VectorSinCos(&SinControlPitch, &CosControlPitch, &ControlPitch);
+			VectorSinCos(&SinControlYaw, &CosControlYaw, &ControlYaw);
+			VectorSinCos(&SinControlRoll, &CosControlRoll, &ControlRoll);
+			VectorSinCos(&SinActorYaw, &CosActorYaw, &ActorYawRad);
+
+			// INCLINATION // 22:00
+			// Get how much the camera is aiming to the actor forward in Z
+			// Up vector of the control rotation . forward vector of the actor yaw
+			// 1 parallel, 0 perpendicular, -1 parallel opposite
+			const FLane ControlInclination = VectorSubtract(
+				VectorMultiply(SinControlRoll, VectorSubtract(VectorMultiply(CosControlYaw, SinActorYaw), VectorMultiply(SinControlYaw, CosActorYaw))),
+				VectorMultiply(VectorMultiply(CosControlRoll, SinControlPitch), VectorMultiplyAdd(CosControlYaw, CosActorYaw, VectorMultiply(SinControlYaw, SinActorYaw))));
+			const FLane AbsControlInclination = VectorAbs(ControlInclination);
+
+			// CALCULATE LIFT // 16:00
+			// Velocity only take negative Z value // 19:00
+			const FLane LiftVelocityZ = Clamp(VelocityZ, Splat(-4000.f), Zero);
+			const FLane LiftVelocity = VectorSqrt(VectorMultiplyAdd(VelocityX, VelocityX,
+				VectorMultiplyAdd(VelocityY, VelocityY, VectorMultiply(LiftVelocityZ, LiftVelocityZ))));
+
+			const FLane ControlInclinationAngle = VectorSubtract(VectorMultiply(VectorACos(Clamp(ControlInclination, VectorNegate(One), One)), RadToDeg), Splat(90.f));
+
+			// Curves can't be vectorized, the lookup in the baked tables is cheap enough per lane
+			alignas(16) float AngleTimes[Width];
+			alignas(16) float VelocityTimes[Width];
+			alignas(16) float Lifts[Width];
+			VectorStoreAligned(ControlInclinationAngle, AngleTimes);
+			VectorStoreAligned(LiftVelocity, VelocityTimes);
+			for (int32 i = 0; i < Width; i++)
+				Lifts[i] = Batch.AngleCurves[Lane + i]->Eval(AngleTimes[i]) * Batch.LiftCurves[Lane + i]->Eval(VelocityTimes[i]);
+
+			const FLane LiftNormalized = VectorLoadAligned(Lifts);
+
+			// Same as round(LiftNormalized) != 0
+			const FLane bCanFly = VectorCompareGE(VectorAbs(LiftNormalized), Splat(0.5f));
+
+			// GLIDE // 28:00
+			// Add default Movement Input in the glide direction to glide
+			// and it allow to go faster when going down and slower when going up
+			const FLane GlidingRange = Clamp(VectorMultiply(VectorAdd(VelocityZ, Splat(500.f)), Splat(1.f / 500.f)), Zero, One);
+			const FLane ScaleGlidingSpeed = VectorMultiply(VectorSubtract(One, GlidingRange), Splat(1.5f));
+			const FLane GlidingAlpha = Clamp(VectorMultiply(DeltaTime, VectorAdd(AbsControlInclination, Splat(0.5f))), Zero, One);
+			const FLane FlySpeedGliding = InterpTo(Load(Batch.FlySpeedGliding, Lane), ScaleGlidingSpeed, GlidingAlpha);
+
+			// Looking direction
+			const FLane GlidingDirectionX = CosControlYaw;
+			const FLane GlidingDirectionY = SinControlYaw;
+
+			// ADD LIFT FORCE //
+			// What make us glide better when faster
+			const FLane LiftForce = VectorMultiply(VectorMultiply(Load(Batch.Mass, Lane), VectorAbs(GravityZ)), LiftNormalized);
+
+			// VELOCITY // 39:00
+			// If can fly we add velocity UP/DOWN on Z (pretty much the flying system)
+			const FLane TargetVelocityZ = VectorMultiply(VectorMultiply(ControlInclination, GravityZ), VectorMultiply(AbsControlInclination, Splat(10.f)));
+			const FLane NextVelocityZ = InterpTo(VelocityZ, TargetVelocityZ, Clamp(VectorMultiply(DeltaTime, Splat(4.f)), Zero, One));
+
+			// VInterpTo toward the gliding direction, keeping the speed
+			const FLane Speed = VectorSqrt(VectorMultiplyAdd(VelocityX, VelocityX, VectorMultiplyAdd(VelocityY, VelocityY, VectorMultiply(VelocityZ, VelocityZ))));
+			const FLane DistX = VectorSubtract(VectorMultiply(GlidingDirectionX, Speed), VelocityX);
+			const FLane DistY = VectorSubtract(VectorMultiply(GlidingDirectionY, Speed), VelocityY);
+			const FLane DistZ = VectorNegate(VelocityZ);
+			const FLane bVelocityReached = VectorCompareLT(VectorMultiplyAdd(DistX, DistX, VectorMultiplyAdd(DistY, DistY, VectorMultiply(DistZ, DistZ))), Splat(KINDA_SMALL_NUMBER));
+			const FLane VelocityAlpha = VectorSelect(bVelocityReached, One, Clamp(VectorMultiply(DeltaTime, Splat(3.f)), Zero, One));
+
+			const FLane NewVelocityX = VectorSelect(bCanFly, VectorMultiplyAdd(DistX, VelocityAlpha, VelocityX), VelocityX);
+			const FLane NewVelocityY = VectorSelect(bCanFly, VectorMultiplyAdd(DistY, VelocityAlpha, VelocityY), VelocityY);
+			const FLane NewVelocityZ = VectorSelect(bCanFly, NextVelocityZ, VelocityZ);
+
+			// ROTATION // 42:00
+			// Prevent drifting in the air
+			const FLane HorizontalSpeedSquared = VectorMultiplyAdd(NewVelocityX, NewVelocityX, VectorMultiply(NewVelocityY, NewVelocityY));
+			const FLane NewPitch = VectorMultiply(VectorATan2(NewVelocityZ, VectorSqrt(HorizontalSpeedSquared)), RadToDeg);
+
+			const FLane VelocityYawRad = VectorATan2(NewVelocityY, NewVelocityX);
+			FLane SinVelocityYaw, CosVelocityYaw;
+			VectorSinCos(&SinVelocityYaw, &CosVelocityYaw, &VelocityYawRad);
+
+			// Right vector of the velocity . forward vector of the actor yaw
+			const FLane TurnInclination = VectorSubtract(VectorMultiply(CosVelocityYaw, SinActorYaw), VectorMultiply(SinVelocityYaw, CosActorYaw));
+
+			// 3 constant value, just the roll feel way better, it's too small else
+			const FLane TurnInclinationAngle = VectorMultiply(VectorSubtract(VectorMultiply(VectorACos(Clamp(TurnInclination, VectorNegate(One), One)), RadToDeg), Splat(90.f)), Splat(3.f));
+			const FLane NewRoll = Clamp(TurnInclinationAngle, Splat(-110.f), Splat(110.f));
+
+			// Yaw of the horizontal velocity, 0 when it is too small to be normalized
+			const FLane bHasHorizontalVelocity = VectorCompareGT(HorizontalSpeedSquared, Splat(SMALL_NUMBER));
+			const FLane NewYaw = VectorSelect(bHasHorizontalVelocity, VectorMultiply(VelocityYawRad, RadToDeg), Zero);
+
+			// RInterpTo
+			const FLane ActorPitch = Load(Batch.ActorPitch, Lane);
+			const FLane ActorYaw = Load(Batch.ActorYaw, Lane);
+			const FLane ActorRoll = Load(Batch.ActorRoll, Lane);
+			const FLane DeltaPitch = NormalizeAxis(VectorSubtract(NewPitch, ActorPitch));
+			const FLane DeltaYaw = NormalizeAxis(VectorSubtract(NewYaw, ActorYaw));
+			const FLane DeltaRoll = NormalizeAxis(VectorSubtract(NewRoll, ActorRoll));
+
+			const FLane Tolerance = Splat(KINDA_SMALL_NUMBER);
+			const FLane bRotationReached = VectorBitwiseAnd(VectorCompareLE(VectorAbs(DeltaPitch), Tolerance),
+				VectorBitwiseAnd(VectorCompareLE(VectorAbs(DeltaYaw), Tolerance), VectorCompareLE(VectorAbs(DeltaRoll), Tolerance)));
+			const FLane RotationAlpha = Clamp(VectorMultiply(DeltaTime, Splat(3.f)), Zero, One);
+
+			Store<bMasked>(VectorSelect(bRotationReached, NewPitch, NormalizeAxis(VectorMultiplyAdd(DeltaPitch, RotationAlpha, ActorPitch))), Batch.ActorPitch, Lane, Mask);
+			Store<bMasked>(VectorSelect(bRotationReached, NewYaw, NormalizeAxis(VectorMultiplyAdd(DeltaYaw, RotationAlpha, ActorYaw))), Batch.ActorYaw, Lane, Mask);
+			Store<bMasked>(VectorSelect(bRotationReached, NewRoll, NormalizeAxis(VectorMultiplyAdd(DeltaRoll, RotationAlpha, ActorRoll))), Batch.ActorRoll, Lane, Mask);
+
+			Store<bMasked>(VectorAdd(NewVelocityX, AirVelocityX), Batch.VelocityX, Lane, Mask);
+			Store<bMasked>(VectorAdd(NewVelocityY, AirVelocityY), Batch.VelocityY, Lane, Mask);
+			Store<bMasked>(VectorAdd(NewVelocityZ, AirVelocityZ), Batch.VelocityZ, Lane, Mask);
+			Store<bMasked>(FlySpeedGliding, Batch.FlySpeedGliding, Lane, Mask);
+			Store<bMasked>(ControlInclination, Batch.ControlInclination, Lane, Mask);
+			Store<bMasked>(LiftNormalized, Batch.LiftNormalized, Lane, Mask);
+			Store<bMasked>(LiftForce, Batch.LiftForce, Lane, Mask);
+			Store<bMasked>(VectorSelect(bCanFly, One, Zero), Batch.CanFly, Lane, Mask);
+			Store<bMasked>(GlidingDirectionX, Batch.GlidingDirectionX, Lane, Mask);
+			Store<bMasked>(GlidingDirectionY, Batch.GlidingDirectionY, Lane, Mask);
+		}
+	}
+
+	/** Cosine and sine of half an angle given by its cosine and sine, angle in ]-180, 180] */
+	FORCEINLINE void HalfAngle(const FLane& Cos, const FLane& Sin, FLane& OutCos, FLane& OutSin)
+	{
+		// The biggest of the two is taken from its square root, the other one from sin = 2 sin(a/2) cos(a/2)
+		const FLane Big = VectorSqrt(VectorMultiply(VectorAdd(VectorOneFloat(), VectorAbs(Cos)), Splat(0.5f)));
+		const FLane Other = VectorDivide(Sin, VectorMultiply(Big, Splat(2.f)));
+		const FLane bFront = VectorCompareGE(Cos, VectorZeroFloat());
+
+		OutCos = VectorSelect(bFront, Big, VectorAbs(Other));
+		OutSin = VectorSelect(bFront, Other, VectorSelect(VectorCompareLT(Sin, VectorZeroFloat()), VectorNegate(Big), Big));
+	}
+
+	/** X and Y of a vector normalized on the plane, Fallback when too small */
+	FORCEINLINE void Normalize2D(FLane& X, FLane& Y, const FLane& FallbackX, const FLane& FallbackY)
+	{
+		const FLane SizeSquared = VectorMultiplyAdd(X, X, VectorMultiply(Y, Y));
+		const FLane bValid = VectorCompareGT(SizeSquared, Splat(SMALL_NUMBER));
+		const FLane InvSize = VectorReciprocalSqrt(VectorMax(SizeSquared, Splat(SMALL_NUMBER)));
+
+		X = VectorSelect(bValid, VectorMultiply(X, InvSize), FallbackX);
+		Y = VectorSelect(bValid, VectorMultiply(Y, InvSize), FallbackY);
+	}
+
+	// Roll is 3 times the turn angle up to 110 degrees
+	// i.e. a turn inclination (sine of the turn angle) up to the sine of 110 / 3 degrees
+	constexpr float MaxTurnRoll = 110;
+	const float MaxTurnInclination = FMath::Sin(FMath::DegreesToRadians(MaxTurnRoll / 3));
+	const float CosHalfMaxTurnRoll = FMath::Cos(FMath::DegreesToRadians(MaxTurnRoll / 2));
+	const float SinHalfMaxTurnRoll = FMath::Sin(FMath::DegreesToRadians(MaxTurnRoll / 2));
+
+	template <bool bMasked>
+	void StepTrigFree(FGriffonFlightBatch& Batch, int32 FirstGroup, int32 NumGroups, float DeltaSeconds, const FLane& Mask)
+	{
+		constexpr int32 Width = FGriffonFlightBatch::LaneWidth;
+
+		const FLane Zero = VectorZeroFloat();
+		const FLane One = VectorOneFloat();
+		const FLane Two = Splat(2.f);
+		const FLane GravityZ = Splat(Batch.GravityZ);
+		const FLane DeltaTime = Splat(DeltaSeconds);
+
+		for (int32 Group = FirstGroup; Group < FirstGroup + NumGroups; Group++)
+		{
+			const int32 Lane = Group * Width;
+
+			// Velocity relative to the air, the wind pushes the glide and the thermals add lift
+			const FLane AirVelocityX = Load(Batch.AirVelocityX, Lane);
+			const FLane AirVelocityY = Load(Batch.AirVelocityY, Lane);
+			const FLane AirVelocityZ = Load(Batch.AirVelocityZ, Lane);
+			const FLane VelocityX = VectorSubtract(Load(Batch.VelocityX, Lane), AirVelocityX);
+			const FLane VelocityY = VectorSubtract(Load(Batch.VelocityY, Lane), AirVelocityY);
+			const FLane VelocityZ = VectorSubtract(Load(Batch.VelocityZ, Lane), AirVelocityZ);
+
+			const FLane ControlX = Load(Batch.ControlQuatX, Lane);
+			const FLane ControlY = Load(Batch.ControlQuatY, Lane);
+			const FLane ControlZ = Load(Batch.ControlQuatZ, Lane);
+			const FLane ControlW = Load(Batch.ControlQuatW, Lane);
+			const FLane ActorX = Load(Batch.ActorQuatX, Lane);
+			const FLane ActorY = Load(Batch.ActorQuatY, Lane);
+			const FLane ActorZ = Load(Batch.ActorQuatZ, Lane);
+			const FLane ActorW = Load(Batch.ActorQuatW, Lane);
+
+			// Up vector of the control rotation, Z is not needed
+			const FLane ControlUpX = VectorMultiply(Two, VectorMultiplyAdd(ControlX, ControlZ, VectorMultiply(ControlW, ControlY)));
+			const FLane ControlUpY = VectorMultiply(Two, VectorNegateMultiplyAdd(ControlW, ControlX, VectorMultiply(ControlY, ControlZ)));
+
+			// Forward vectors flattened, same as the forward of the yaw only rotations
+			FLane ControlForwardX = VectorNegateMultiplyAdd(Two, VectorMultiplyAdd(ControlY, ControlY, VectorMultiply(ControlZ, ControlZ)), One);
+			FLane ControlForwardY = VectorMultiply(Two, VectorMultiplyAdd(ControlX, ControlY, VectorMultiply(ControlW, ControlZ)));
+			FLane ActorForwardX = VectorNegateMultiplyAdd(Two, VectorMultiplyAdd(ActorY, ActorY, VectorMultiply(ActorZ, ActorZ)), One);
+			FLane ActorForwardY = VectorMultiply(Two, VectorMultiplyAdd(ActorX, ActorY, VectorMultiply(ActorW, ActorZ)));
+			Normalize2D(ActorForwardX, ActorForwardY, One, Zero);
+			Normalize2D(ControlForwardX, ControlForwardY, ActorForwardX, ActorForwardY);
+
+			// INCLINATION
+			const FLane ControlInclination = VectorMultiplyAdd(ControlUpX, ActorForwardX, VectorMultiply(ControlUpY, ActorForwardY));
+			const FLane AbsControlInclination = VectorAbs(ControlInclination);
+
+			// CALCULATE LIFT
+			const FLane LiftVelocityZ = Clamp(VelocityZ, Splat(-4000.f), Zero);
+			const FLane LiftVelocity = VectorSqrt(VectorMultiplyAdd(VelocityX, VelocityX,
+				VectorMultiplyAdd(VelocityY, VelocityY, VectorMultiply(LiftVelocityZ, LiftVelocityZ))));
+
+			// The inclination table is indexed by the inclination itself, no acos
+			alignas(16) float Inclinations[Width];
+			alignas(16) float VelocityTimes[Width];
+			alignas(16) float Lifts[Width];
+			VectorStoreAligned(ControlInclination, Inclinations);
+			VectorStoreAligned(LiftVelocity, VelocityTimes);
+			for (int32 i = 0; i < Width; i++)
+				Lifts[i] = Batch.InclinationCurves[Lane + i]->Eval(Inclinations[i]) * Batch.LiftCurves[Lane + i]->Eval(VelocityTimes[i]);
+
+			const FLane LiftNormalized = VectorLoadAligned(Lifts);
+			const FLane bCanFly = VectorCompareGE(VectorAbs(LiftNormalized), Splat(0.5f));
+
+			// GLIDE
+			const FLane GlidingRange = Clamp(VectorMultiply(VectorAdd(VelocityZ, Splat(500.f)), Splat(1.f / 500.f)), Zero, One);
+			const FLane ScaleGlidingSpeed = VectorMultiply(VectorSubtract(One, GlidingRange), Splat(1.5f));
+			const FLane GlidingAlpha = Clamp(VectorMultiply(DeltaTime, VectorAdd(AbsControlInclination, Splat(0.5f))), Zero, One);
+			const FLane FlySpeedGliding = InterpTo(Load(Batch.FlySpeedGliding, Lane), ScaleGlidingSpeed, GlidingAlpha);
+
+			const FLane LiftForce = VectorMultiply(VectorMultiply(Load(Batch.Mass, Lane), VectorAbs(GravityZ)), LiftNormalized);
+
+			// VELOCITY
+			const FLane TargetVelocityZ = VectorMultiply(VectorMultiply(ControlInclination, GravityZ), VectorMultiply(AbsControlInclination, Splat(10.f)));
+			const FLane NextVelocityZ = InterpTo(VelocityZ, TargetVelocityZ, Clamp(VectorMultiply(DeltaTime, Splat(4.f)), Zero, One));
+
+			const FLane Speed = VectorSqrt(VectorMultiplyAdd(VelocityX, VelocityX, VectorMultiplyAdd(VelocityY, VelocityY, VectorMultiply(VelocityZ, VelocityZ))));
+			const FLane DistX = VectorSubtract(VectorMultiply(ControlForwardX, Speed), VelocityX);
+			const FLane DistY = VectorSubtract(VectorMultiply(ControlForwardY, Speed), VelocityY);
+			const FLane DistZ = VectorNegate(VelocityZ);
+			const FLane bVelocityReached = VectorCompareLT(VectorMultiplyAdd(DistX, DistX, VectorMultiplyAdd(DistY, DistY, VectorMultiply(DistZ, DistZ))), Splat(KINDA_SMALL_NUMBER));
+			const FLane VelocityAlpha = VectorSelect(bVelocityReached, One, Clamp(VectorMultiply(DeltaTime, Splat(3.f)), Zero, One));
+
+			const FLane NewVelocityX = VectorSelect(bCanFly, VectorMultiplyAdd(DistX, VelocityAlpha, VelocityX), VelocityX);
+			const FLane NewVelocityY = VectorSelect(bCanFly, VectorMultiplyAdd(DistY, VelocityAlpha, VelocityY), VelocityY);
+			const FLane NewVelocityZ = VectorSelect(bCanFly, NextVelocityZ, VelocityZ);
+
+			// ROTATION
+			// Cosine and sine of the velocity yaw and pitch from the velocity itself, yaw 0 without horizontal velocity
+			const FLane HorizontalSpeedSquared = VectorMultiplyAdd(NewVelocityX, NewVelocityX, VectorMultiply(NewVelocityY, NewVelocityY));
+			const FLane HorizontalSpeed = VectorSqrt(HorizontalSpeedSquared);
+			const FLane bHasHorizontalVelocity = VectorCompareGT(HorizontalSpeedSquared, Splat(SMALL_NUMBER));
+			const FLane InvHorizontalSpeed = VectorReciprocal(VectorMax(HorizontalSpeed, Splat(SMALL_NUMBER)));
+			const FLane CosYaw = VectorSelect(bHasHorizontalVelocity, VectorMultiply(NewVelocityX, InvHorizontalSpeed), One);
+			const FLane SinYaw = VectorSelect(bHasHorizontalVelocity, VectorMultiply(NewVelocityY, InvHorizontalSpeed), Zero);
+
+			const FLane SpeedSquared = VectorMultiplyAdd(NewVelocityZ, NewVelocityZ, HorizontalSpeedSquared);
+			const FLane bHasVelocity = VectorCompareGT(SpeedSquared, Splat(SMALL_NUMBER));
+			const FLane InvSpeed = VectorReciprocalSqrt(VectorMax(SpeedSquared, Splat(SMALL_NUMBER)));
+			const FLane CosPitch = VectorSelect(bHasVelocity, VectorMultiply(HorizontalSpeed, InvSpeed), One);
+			const FLane SinPitch = VectorSelect(bHasVelocity, VectorMultiply(NewVelocityZ, InvSpeed), Zero);
+
+			// Right vector of the velocity . forward vector of the actor yaw = sine of the turn angle
+			const FLane TurnInclination = VectorNegateMultiplyAdd(SinYaw, ActorForwardX, VectorMultiply(CosYaw, ActorForwardY));
+
+			// Roll is -3 times the turn angle, cos/sin of its half from the triple angle identities on the half turn angle
+			FLane CosHalfTurn, SinHalfTurn;
+			HalfAngle(VectorSqrt(VectorMax(VectorNegateMultiplyAdd(TurnInclination, TurnInclination, One), Zero)), TurnInclination, CosHalfTurn, SinHalfTurn);
+			const FLane CosHalfTurn3 = VectorNegateMultiplyAdd(Splat(3.f), CosHalfTurn, VectorMultiply(Splat(4.f), VectorMultiply(CosHalfTurn, VectorMultiply(CosHalfTurn, CosHalfTurn))));
+			const FLane SinHalfTurn3 = VectorNegateMultiplyAdd(Splat(4.f), VectorMultiply(SinHalfTurn, VectorMultiply(SinHalfTurn, SinHalfTurn)), VectorMultiply(Splat(3.f), SinHalfTurn));
+
+			const FLane bRollClamped = VectorCompareGT(VectorAbs(TurnInclination), Splat(MaxTurnInclination));
+			const FLane ClampedSinHalfRoll = VectorSelect(VectorCompareGT(TurnInclination, Zero), Splat(-SinHalfMaxTurnRoll), Splat(SinHalfMaxTurnRoll));
+			const FLane CosHalfRoll = VectorSelect(bRollClamped, Splat(CosHalfMaxTurnRoll), CosHalfTurn3);
+			const FLane SinHalfRoll = VectorSelect(bRollClamped, ClampedSinHalfRoll, VectorNegate(SinHalfTurn3));
+
+			FLane CosHalfYaw, SinHalfYaw, CosHalfPitch, SinHalfPitch;
+			HalfAngle(CosYaw, SinYaw, CosHalfYaw, SinHalfYaw);
+			HalfAngle(CosPitch, SinPitch, CosHalfPitch, SinHalfPitch);
+
+			// FRotator::Quaternion
+			const FLane CRCP = VectorMultiply(CosHalfRoll, CosHalfPitch);
+			const FLane CRSP = VectorMultiply(CosHalfRoll, SinHalfPitch);
+			const FLane SRCP = VectorMultiply(SinHalfRoll, CosHalfPitch);
+			const FLane SRSP = VectorMultiply(SinHalfRoll, SinHalfPitch);
+			FLane TargetX = VectorSubtract(VectorMultiply(CRSP, SinHalfYaw), VectorMultiply(SRCP, CosHalfYaw));
+			FLane TargetY = VectorNegate(VectorMultiplyAdd(CRSP, CosHalfYaw, VectorMultiply(SRCP, SinHalfYaw)));
+			FLane TargetZ = VectorSubtract(VectorMultiply(CRCP, SinHalfYaw), VectorMultiply(SRSP, CosHalfYaw));
+			FLane TargetW = VectorMultiplyAdd(CRCP, CosHalfYaw, VectorMultiply(SRSP, SinHalfYaw));
+
+			// Normalized lerp on the shortest path instead of RInterpTo
+			const FLane Dot = VectorMultiplyAdd(ActorX, TargetX, VectorMultiplyAdd(ActorY, TargetY, VectorMultiplyAdd(ActorZ, TargetZ, VectorMultiply(ActorW, TargetW))));
+			const FLane Sign = VectorSelect(VectorCompareLT(Dot, Zero), VectorNegate(One), One);
+			const FLane RotationAlpha = Clamp(VectorMultiply(DeltaTime, Splat(3.f)), Zero, One);
+
+			const FLane RotationX = VectorMultiplyAdd(VectorNegateMultiplyAdd(Sign, TargetX, ActorX), VectorNegate(RotationAlpha), ActorX);
+			const FLane RotationY = VectorMultiplyAdd(VectorNegateMultiplyAdd(Sign, TargetY, ActorY), VectorNegate(RotationAlpha), ActorY);
+			const FLane RotationZ = VectorMultiplyAdd(VectorNegateMultiplyAdd(Sign, TargetZ, ActorZ), VectorNegate(RotationAlpha), ActorZ);
+			const FLane RotationW = VectorMultiplyAdd(VectorNegateMultiplyAdd(Sign, TargetW, ActorW), VectorNegate(RotationAlpha), ActorW);
+			const FLane RotationSizeSquared = VectorMultiplyAdd(RotationX, RotationX, VectorMultiplyAdd(RotationY, RotationY, VectorMultiplyAdd(RotationZ, RotationZ, VectorMultiply(RotationW, RotationW))));
+			const FLane InvRotationSize = VectorReciprocalSqrt(VectorMax(RotationSizeSquared, Splat(SMALL_NUMBER)));
+
+			Store<bMasked>(VectorMultiply(RotationX, InvRotationSize), Batch.ActorQuatX, Lane, Mask);
+			Store<bMasked>(VectorMultiply(RotationY, InvRotationSize), Batch.ActorQuatY, Lane, Mask);
+			Store<bMasked>(VectorMultiply(RotationZ, InvRotationSize), Batch.ActorQuatZ, Lane, Mask);
+			Store<bMasked>(VectorMultiply(RotationW, InvRotationSize), Batch.ActorQuatW, Lane, Mask);
+
+			Store<bMasked>(VectorAdd(NewVelocityX, AirVelocityX), Batch.VelocityX, Lane, Mask);
+			Store<bMasked>(VectorAdd(NewVelocityY, AirVelocityY), Batch.VelocityY, Lane, Mask);
+			Store<bMasked>(VectorAdd(NewVelocityZ, AirVelocityZ), Batch.VelocityZ, Lane, Mask);
+			Store<bMasked>(FlySpeedGliding, Batch.FlySpeedGliding, Lane, Mask);
+			Store<bMasked>(ControlInclination, Batch.ControlInclination, Lane, Mask);
+			Store<bMasked>(LiftNormalized, Batch.LiftNormalized, Lane, Mask);
+			Store<bMasked>(LiftForce, Batch.LiftForce, Lane, Mask);
+			Store<bMasked>(VectorSelect(bCanFly, One, Zero), Batch.CanFly, Lane, Mask);
+			Store<bMasked>(ControlForwardX, Batch.GlidingDirectionX, Lane, Mask);
+			Store<bMasked>(ControlForwardY, Batch.GlidingDirectionY, Lane, Mask);
+		}
+	}
+}
+
+void GriffonFlightKernel::Step(FGriffonFlightBatch& Batch, int32 FirstGroup, int32 NumGroups, float DeltaSeconds)
+{
+	const FLane Mask = VectorZeroFloat();
+
+	if (Batch.bTrigFreeMath)
+		StepTrigFree<false>(Batch, FirstGroup, NumGroups, DeltaSeconds, Mask);
+	else
+		StepRotators<false>(Batch, FirstGroup, NumGroups, DeltaSeconds, Mask);
+}
+
+void GriffonFlightKernel::StepSlot(FGriffonFlightBatch& Batch, int32 Slot, float DeltaSeconds)
+{
+	check(Slot >= 0 && Slot < Batch.Num());
+
+	constexpr int32 Width = FGriffonFlightBatch::LaneWidth;
+	const int32 Group = Slot / Width;
+	const FLane Mask = VectorCompareEQ(Splat(float(Slot % Width)), MakeVectorRegisterFloat(0.f, 1.f, 2.f, 3.f));
+
+	if (Batch.bTrigFreeMath)
+		StepTrigFree<true>(Batch, Group, 1, DeltaSeconds, Mask);
+	else
+		StepRotators<true>(Batch, Group, 1, DeltaSeconds, Mask);
+}
+
+void GriffonFlightKernel::StepParallel(FGriffonFlightBatch& Batch, float DeltaSeconds)
+{
+	const int32 NumGroups = Batch.NumGroups();
+	const int32 NumTasks = FMath::DivideAndRoundUp(NumGroups, GroupsPerTask);
+
+	ParallelFor(NumTasks, [&Batch, NumGroups, DeltaSeconds](int32 Task)
+	{
+		const int32 FirstGroup = Task * GroupsPerTask;
+		Step(Batch, FirstGroup, FMath::Min(GroupsPerTask, NumGroups - FirstGroup), DeltaSeconds);
+	}, NumTasks == 1 ? EParallelForFlags::ForceSingleThread : EParallelForFlags::None);
+}
@@ -0,0 +1,149 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GriffonFlightSubsystem.h"
+#include "GriffonControllerCharacter.h"
+#include "GriffonFlightCurves.h"
+#include "GriffonStats.h"
+#include "GriffonWindSubsystem.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("Flight Batch"), STAT_GriffonFlightBatch, STATGROUP_Griffon);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Batched Flyers"), STAT_GriffonBatchedFlyers, STATGROUP_Griffon);
+
+namespace
+{
+	TAutoConsoleVariable<int32> CVarTrigFree(
+		TEXT("griffon.Flight.TrigFree"), 0,
+		TEXT("Run the flight math on quaternions and dot products, without sin/cos/acos/atan2.\n")
+		TEXT("Checked against the rotator math by the GriffonBenchmark commandlet."));
+}
+
+void UGriffonFlightSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	WindSubsystem = Collection.InitializeDependency<UGriffonWindSubsystem>();
+}
+
+void UGriffonFlightSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_GriffonFlightBatch);
+
+	// Changed between two frames only, every griffon of a frame fills the same inputs
+	Batch.bTrigFreeMath = CVarTrigFree.GetValueOnGameThread() != 0;
+	FlockBatch.bTrigFreeMath = Batch.bTrigFreeMath;
+
+	// Batched griffons are applied after their movement component ticked,
+	// so the result is used by the movement the next frame
+	int32 NumBatched = 0;
+	for (AGriffonControllerCharacter *Griffon : FlockFlyers)
+	{
+		if (Griffon->FlightStepMode == FlightStep_Batched && Griffon->IsActorTickEnabled())
+		{
+			Griffon->WriteFlightInputs(FlockBatch);
+			NumBatched++;
+		}
+	}
+
+	INC_DWORD_STAT_BY(STAT_GriffonBatchedFlyers, NumBatched);
+
+	if (NumBatched == 0)
+		return;
+
+	// Only the flock, the other flyers step their own slot
+	FlockBatch.GravityZ = GetWorld()->GetGravityZ();
+	WindSubsystem->SampleBatch(FlockBatch, 0, FlockBatch.NumGroups());
+	GriffonFlightKernel::StepParallel(FlockBatch, DeltaTime);
+
+	// Backward, a griffon landing leave the batch and the last slot take its place
+	for (int32 Slot = FlockFlyers.Num() - 1; Slot >= 0; Slot--)
+	{
+		AGriffonControllerCharacter *Griffon = FlockFlyers[Slot];
+		if (Griffon->FlightStepMode == FlightStep_Batched && Griffon->IsActorTickEnabled())
+		{
+			Griffon->ApplyFlightOutputs(FlockBatch);
+		}
+	}
+}
+
+TStatId UGriffonFlightSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UGriffonFlightSubsystem, STATGROUP_Tickables);
+}
+
+void UGriffonFlightSubsystem::RegisterFlyer(AGriffonControllerCharacter *Griffon)
+{
+	if (Griffon->FlightSlot != INDEX_NONE)
+		return;
+
+	// Kept in the batch it took off in until it lands
+	Griffon->bFlockFlightSlot = Griffon->FlightStepMode == FlightStep_Batched;
+	Griffon->FlightSlot = GetBatch(Griffon).AddSlot();
+	GetFlyers(Griffon).Add(Griffon);
+}
+
+void UGriffonFlightSubsystem::UnregisterFlyer(AGriffonControllerCharacter *Griffon)
+{
+	const int32 Slot = Griffon->FlightSlot;
+	if (Slot == INDEX_NONE)
+		return;
+
+	TArray<AGriffonControllerCharacter *>& SlotFlyers = GetFlyers(Griffon);
+	const int32 MovedSlot = GetBatch(Griffon).RemoveSlotSwap(Slot);
+	SlotFlyers.RemoveAtSwap(Slot);
+
+	if (MovedSlot != INDEX_NONE)
+		SlotFlyers[Slot]->FlightSlot = Slot;
+
+	Griffon->FlightSlot = INDEX_NONE;
+}
+
+void UGriffonFlightSubsystem::StepFlyer(const AGriffonControllerCharacter *Griffon, float DeltaSeconds)
+{
+	check(Griffon->FlightSlot != INDEX_NONE);
+
+	FGriffonFlightBatch& FlyerBatch = GetBatch(Griffon);
+	const int32 Group = Griffon->FlightSlot / FGriffonFlightBatch::LaneWidth;
+
+	// The wind is sampled for the whole group, only the air velocity of the others changes
+	FlyerBatch.GravityZ = GetWorld()->GetGravityZ();
+	WindSubsystem->SampleBatch(FlyerBatch, Group, 1);
+	GriffonFlightKernel::StepSlot(FlyerBatch, Griffon->FlightSlot, DeltaSeconds);
+}
+
+FGriffonFlightBatch& UGriffonFlightSubsystem::GetBatch(const AGriffonControllerCharacter *Griffon)
+{
+	return Griffon->bFlockFlightSlot ? FlockBatch : Batch;
+}
+
+TArray<AGriffonControllerCharacter *>& UGriffonFlightSubsystem::GetFlyers(const AGriffonControllerCharacter *Griffon)
+{
+	return Griffon->bFlockFlightSlot ? FlockFlyers : Flyers;
+}
+
+const FGriffonBakedCurve* UGriffonFlightSubsystem::FindOrBakeCurve(const UCurveFloat *Curve)
+{
+	TUniquePtr<FGriffonBakedCurve>& BakedCurve = BakedCurves.FindOrAdd(Curve);
+
+	if (!BakedCurve.IsValid())
+	{
+		BakedCurve = MakeUnique<FGriffonBakedCurve>();
+		BakedCurve->Bake(Curve);
+	}
+
+	return BakedCurve.Get();
+}
+
+const FGriffonBakedCurve* UGriffonFlightSubsystem::FindOrBakeInclinationCurve(const UCurveFloat *AngleCurve)
+{
+	TUniquePtr<FGriffonBakedCurve>& BakedCurve = BakedInclinationCurves.FindOrAdd(AngleCurve);
+
+	if (!BakedCurve.IsValid())
+	{
+		BakedCurve = MakeUnique<FGriffonBakedCurve>();
+		BakedCurve->BakeInclination(AngleCurve);
+	}
+
+	return BakedCurve.Get();
+}
@@ -0,0 +1,142 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GriffonFlightTelemetry.h"
+#include "GriffonController.h"
+#include "Async/Async.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/Archive.h"
+
+namespace
+{
+	FAutoConsoleCommand DumpCommand(
+		TEXT("griffon.Telemetry.Dump"),
+		TEXT("Write the last flight samples to Saved/Telemetry."),
+		FConsoleCommandDelegate::CreateLambda([]()
+		{
+			FGriffonFlightTelemetry::Get().Dump();
+		}));
+
+	FAutoConsoleCommand ToCSVCommand(
+		TEXT("griffon.Telemetry.ToCSV"),
+		TEXT("Convert a flight telemetry dump to csv. Usage: griffon.Telemetry.ToCSV <File>"),
+		FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+		{
+			if (Args.Num() == 1)
+				FGriffonFlightTelemetry::ConvertToCSV(Args[0]);
+		}));
+
+	void SerializeSample(FArchive& Ar, FGriffonFlightSample& Sample)
+	{
+		Ar << Sample.Time << Sample.FlyerId << Sample.Frame;
+		Ar << Sample.ControlInclination << Sample.LiftNormalized << Sample.FlySpeedGliding << Sample.VelocityAngle;
+		Ar << Sample.Velocity.X << Sample.Velocity.Y << Sample.Velocity.Z;
+		Ar << Sample.Rotation.Pitch << Sample.Rotation.Yaw << Sample.Rotation.Roll;
+	}
+}
+
+FGriffonFlightTelemetry& FGriffonFlightTelemetry::Get()
+{
+	static FGriffonFlightTelemetry Telemetry;
+	return Telemetry;
+}
+
+void FGriffonFlightTelemetry::CopySamples(TArray<FGriffonFlightSample>& OutSamples) const
+{
+	const uint64 End = WriteIndex.load(std::memory_order_acquire);
+	const uint64 Begin = End > Capacity ? End - Capacity : 0;
+
+	OutSamples.Reset(End - Begin);
+
+	for (uint64 Index = Begin; Index < End; Index++)
+	{
+		const FSlot& Slot = Slots[Index & (Capacity - 1)];
+		const uint64 ExpectedSequence = Index * 2 + 2;
+
+		if (Slot.Sequence.load(std::memory_order_acquire) != ExpectedSequence)
+			continue; // Still being written, or already overwritten
+
+		const FGriffonFlightSample Sample = Slot.Sample;
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (Slot.Sequence.load(std::memory_order_relaxed) != ExpectedSequence)
+			continue; // Overwritten while copying
+
+		OutSamples.Add(Sample);
+	}
+}
+
+bool FGriffonFlightTelemetry::Dump()
+{
+	if (bDumping.exchange(true))
+		return false;
+
+	const FString Filename = FPaths::ProjectSavedDir() / TEXT("Telemetry") /
+		FString::Printf(TEXT("Flight_%s.gft"), *FDateTime::Now().ToString());
+
+	Async(EAsyncExecution::Thread, [this, Filename]()
+	{
+		TArray<FGriffonFlightSample> Samples;
+		CopySamples(Samples);
+
+		if (TUniquePtr<FArchive> Writer = TUniquePtr<FArchive>(IFileManager::Get().CreateFileWriter(*Filename)))
+		{
+			uint32 Magic = FileMagic;
+			uint32 Version = FileVersion;
+			uint32 NumSamples = Samples.Num();
+			*Writer << Magic << Version << NumSamples;
+
+			for (FGriffonFlightSample& Sample : Samples)
+				SerializeSample(*Writer, Sample);
+
+			Writer->Close();
+			UE_LOG(LogGriffon, Log, TEXT("Flight telemetry: %u samples written to %s"), NumSamples, *Filename);
+		} else
+		{
+			UE_LOG(LogGriffon, Warning, TEXT("Flight telemetry: can't write %s"), *Filename);
+		}
+
+		bDumping = false;
+	});
+
+	return true;
+}
+
+bool FGriffonFlightTelemetry::ConvertToCSV(const FString& DumpFilename)
+{
+	TUniquePtr<FArchive> Reader = TUniquePtr<FArchive>(IFileManager::Get().CreateFileReader(*DumpFilename));
+	if (!Reader)
+	{
+		UE_LOG(LogGriffon, Warning, TEXT("Flight telemetry: can't read %s"), *DumpFilename);
+		return false;
+	}
+
+	uint32 Magic, Version, NumSamples;
+	*Reader << Magic << Version << NumSamples;
+
+	if (Magic != FileMagic || Version != FileVersion)
+	{
+		UE_LOG(LogGriffon, Warning, TEXT("Flight telemetry: %s is not a version %u dump"), *DumpFilename, FileVersion);
+		return false;
+	}
+
+	FString CSV = TEXT("Time,FlyerId,Frame,ControlInclination,LiftNormalized,FlySpeedGliding,VelocityAngle,VelocityX,VelocityY,VelocityZ,Pitch,Yaw,Roll\n");
+
+	for (uint32 i = 0; i < NumSamples && !Reader->IsError(); i++)
+	{
+		FGriffonFlightSample Sample;
+		SerializeSample(*Reader, Sample);
+
+		CSV += FString::Printf(TEXT("%f,%u,%u,%f,%f,%f,%f,%f,%f,%f,%f,%f,%f\n"),
+			Sample.Time, Sample.FlyerId, Sample.Frame,
+			Sample.ControlInclination, Sample.LiftNormalized, Sample.FlySpeedGliding, Sample.VelocityAngle,
+			Sample.Velocity.X, Sample.Velocity.Y, Sample.Velocity.Z,
+			Sample.Rotation.Pitch, Sample.Rotation.Yaw, Sample.Rotation.Roll);
+	}
+
+	return FFileHelper::SaveStringToFile(CSV, *FPaths::ChangeExtension(DumpFilename, TEXT("csv")));
+}
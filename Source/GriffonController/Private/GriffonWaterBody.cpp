@@ -0,0 +1,51 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GriffonWaterBody.h"
+#include "GriffonWaterSubsystem.h"
+#include "Components/BoxComponent.h"
+
+AGriffonWaterBody::AGriffonWaterBody()
+{
+	PrimaryActorTick.bCanEverTick = false;
+
+	WaterBox = CreateDefaultSubobject<UBoxComponent>(TEXT("WaterBox"));
+	WaterBox->InitBoxExtent(FVector(1000, 1000, 200));
+	WaterBox->SetCollisionProfileName(TEXT("Trigger"));
+	WaterBox->SetGenerateOverlapEvents(true);
+	RootComponent = WaterBox;
+}
+
+FBox AGriffonWaterBody::GetWaterBounds() const
+{
+	return WaterBox->Bounds.GetBox();
+}
+
+bool AGriffonWaterBody::GetSurfaceHeightAt(const FVector2D& Point, float& OutHeight) const
+{
+	const FTransform& Transform = WaterBox->GetComponentTransform();
+	const FVector Extent = WaterBox->GetUnscaledBoxExtent();
+
+	const FVector Local = Transform.InverseTransformPosition(FVector(Point, Transform.GetLocation().Z));
+	if (FMath::Abs(Local.X) > Extent.X || FMath::Abs(Local.Y) > Extent.Y)
+		return false;
+
+	OutHeight = Transform.GetLocation().Z + WaterBox->GetScaledBoxExtent().Z;
+	return true;
+}
+
+void AGriffonWaterBody::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (UGriffonWaterSubsystem *WaterSubsystem = GetWorld()->GetSubsystem<UGriffonWaterSubsystem>())
+		WaterSubsystem->RegisterBody(this);
+}
+
+void AGriffonWaterBody::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UGriffonWaterSubsystem *WaterSubsystem = GetWorld()->GetSubsystem<UGriffonWaterSubsystem>())
+		WaterSubsystem->UnregisterBody(this);
+
+	Super::EndPlay(EndPlayReason);
+}
@@ -0,0 +1,112 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GriffonWaterSubsystem.h"
+#include "GriffonStats.h"
+#include "GriffonWaterBody.h"
+
+DECLARE_CYCLE_STAT(TEXT("Water Height Query"), STAT_GriffonWaterQuery, STATGROUP_Griffon);
+DECLARE_CYCLE_STAT(TEXT("Water Tile Build"), STAT_GriffonWaterTileBuild, STATGROUP_Griffon);
+DECLARE_MEMORY_STAT(TEXT("Water Height Field"), STAT_GriffonWaterMemory, STATGROUP_Griffon);
+
+namespace
+{
+	/** Cells without water */
+	constexpr float NoWater = -UE_BIG_NUMBER;
+}
+
+void UGriffonWaterSubsystem::RegisterBody(AGriffonWaterBody *Body)
+{
+	Bodies.AddUnique(Body);
+	Invalidate();
+}
+
+void UGriffonWaterSubsystem::UnregisterBody(AGriffonWaterBody *Body)
+{
+	Bodies.Remove(Body);
+	Invalidate();
+}
+
+void UGriffonWaterSubsystem::Invalidate()
+{
+	Tiles.Reset();
+	TileIndices.Reset();
+	SET_MEMORY_STAT(STAT_GriffonWaterMemory, 0);
+
+	Generation++;
+}
+
+int32 UGriffonWaterSubsystem::BuildTile(const FIntPoint& Coord)
+{
+	SCOPE_CYCLE_COUNTER(STAT_GriffonWaterTileBuild);
+
+	constexpr float TileSize = CellSize * TileCells;
+	const FVector2D Origin = FVector2D(Coord) * TileSize;
+	const FBox2D TileBounds(Origin, Origin + FVector2D(TileSize));
+
+	TArray<const AGriffonWaterBody *, TInlineAllocator<4>> TileBodies;
+	for (const AGriffonWaterBody *Body : Bodies)
+	{
+		const FBox Bounds = Body->GetWaterBounds();
+		if (FBox2D(FVector2D(Bounds.Min), FVector2D(Bounds.Max)).Intersect(TileBounds))
+			TileBodies.Add(Body);
+	}
+
+	if (TileBodies.IsEmpty())
+	{
+		TileIndices.Add(Coord, INDEX_NONE);
+		return INDEX_NONE;
+	}
+
+	// Highest surface at the center of each cell
+	const int32 Index = Tiles.AddUninitialized();
+	FTile& Tile = Tiles[Index];
+
+	for (int32 Y = 0; Y < TileCells; Y++)
+		for (int32 X = 0; X < TileCells; X++)
+		{
+			const FVector2D Point = Origin + (FVector2D(X, Y) + 0.5f) * CellSize;
+
+			float Height = NoWater;
+			for (const AGriffonWaterBody *Body : TileBodies)
+			{
+				float BodyHeight;
+				if (Body->GetSurfaceHeightAt(Point, BodyHeight))
+					Height = FMath::Max(Height, BodyHeight);
+			}
+
+			Tile.Heights[X + Y * TileCells] = Height;
+		}
+
+	TileIndices.Add(Coord, Index);
+	SET_MEMORY_STAT(STAT_GriffonWaterMemory, Tiles.GetAllocatedSize() + TileIndices.GetAllocatedSize());
+
+	return Index;
+}
+
+bool UGriffonWaterSubsystem::FindWaterHeight(const FVector& Location, FGriffonWaterTileCache& Cache, float& OutHeight)
+{
+	SCOPE_CYCLE_COUNTER(STAT_GriffonWaterQuery);
+
+	const FIntPoint Cell(FMath::FloorToInt(Location.X / CellSize), FMath::FloorToInt(Location.Y / CellSize));
+	const FIntPoint Coord(Cell.X >> TileShift, Cell.Y >> TileShift);
+
+	if (Cache.Generation != Generation || Cache.Coord != Coord)
+	{
+		const int32 *Index = TileIndices.Find(Coord);
+		Cache.Coord = Coord;
+		Cache.Index = Index ? *Index : BuildTile(Coord);
+		Cache.Generation = Generation;
+	}
+
+	if (Cache.Index == INDEX_NONE)
+		return false;
+
+	const FIntPoint Local = Cell - Coord * TileCells;
+	const float Height = Tiles[Cache.Index].Heights[Local.X + Local.Y * TileCells];
+	if (Height == NoWater)
+		return false;
+
+	OutHeight = Height;
+	return true;
+}
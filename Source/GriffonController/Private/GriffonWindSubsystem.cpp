@@ -0,0 +1,221 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GriffonWindSubsystem.h"
+#include "GriffonFlightKernel.h"
+#include "GriffonStats.h"
+#include "GriffonWindVolume.h"
+
+DECLARE_CYCLE_STAT(TEXT("Wind Sample"), STAT_GriffonWindSample, STATGROUP_Griffon);
+DECLARE_CYCLE_STAT(TEXT("Wind Rebuild"), STAT_GriffonWindRebuild, STATGROUP_Griffon);
+DECLARE_MEMORY_STAT(TEXT("Wind Field"), STAT_GriffonWindMemory, STATGROUP_Griffon);
+
+namespace
+{
+	using FLane = VectorRegister4Float;
+
+	constexpr int32 BrickPoints = UGriffonWindSubsystem::BrickPoints;
+	constexpr int32 NumCorners = 8;
+
+	FORCEINLINE int32 PointIndex(int32 X, int32 Y, int32 Z)
+	{
+		return X + (Y + Z * BrickPoints) * BrickPoints;
+	}
+
+	/** Offset of the corner i of a cell, bit 0 is X, bit 1 Y, bit 2 Z */
+	FORCEINLINE int32 CornerOffset(int32 Corner)
+	{
+		return PointIndex(Corner & 1, (Corner >> 1) & 1, (Corner >> 2) & 1);
+	}
+
+	FORCEINLINE FLane Lerp(const FLane& A, const FLane& B, const FLane& Alpha)
+	{
+		return VectorMultiplyAdd(VectorSubtract(B, A), Alpha, A);
+	}
+
+	void ZeroAirVelocity(FGriffonFlightBatch& Batch, int32 FirstLane, int32 NumLanes)
+	{
+		FMemory::Memzero(Batch.AirVelocityX.GetData() + FirstLane, NumLanes * sizeof(float));
+		FMemory::Memzero(Batch.AirVelocityY.GetData() + FirstLane, NumLanes * sizeof(float));
+		FMemory::Memzero(Batch.AirVelocityZ.GetData() + FirstLane, NumLanes * sizeof(float));
+	}
+}
+
+void UGriffonWindSubsystem::RegisterVolume(AGriffonWindVolume *Volume)
+{
+	Volumes.AddUnique(Volume);
+	bDirty = true;
+}
+
+void UGriffonWindSubsystem::UnregisterVolume(AGriffonWindVolume *Volume)
+{
+	Volumes.Remove(Volume);
+	bDirty = true;
+}
+
+void UGriffonWindSubsystem::Rebuild()
+{
+	SCOPE_CYCLE_COUNTER(STAT_GriffonWindRebuild);
+
+	Bricks.Reset();
+	BrickIndices.Reset();
+
+	// Every brick touched by a volume
+	constexpr float BrickSize = CellSize * BrickCells;
+
+	for (const AGriffonWindVolume *Volume : Volumes)
+	{
+		const FBox Bounds = Volume->GetWindBounds();
+		const FIntVector Min(FMath::FloorToInt(Bounds.Min.X / BrickSize), FMath::FloorToInt(Bounds.Min.Y / BrickSize), FMath::FloorToInt(Bounds.Min.Z / BrickSize));
+		const FIntVector Max(FMath::FloorToInt(Bounds.Max.X / BrickSize), FMath::FloorToInt(Bounds.Max.Y / BrickSize), FMath::FloorToInt(Bounds.Max.Z / BrickSize));
+
+		for (int32 Z = Min.Z; Z <= Max.Z; Z++)
+			for (int32 Y = Min.Y; Y <= Max.Y; Y++)
+				for (int32 X = Min.X; X <= Max.X; X++)
+				{
+					const FIntVector Coord(X, Y, Z);
+					if (!BrickIndices.Contains(Coord))
+					{
+						BrickIndices.Add(Coord, Bricks.Num());
+						Bricks.AddZeroed_GetRef().Coord = Coord;
+					}
+				}
+	}
+
+	// Sample the volumes at every point of the bricks
+	TArray<const AGriffonWindVolume *, TInlineAllocator<8>> BrickVolumes;
+
+	for (FBrick& Brick : Bricks)
+	{
+		const FVector Origin = FVector(Brick.Coord * BrickCells) * CellSize;
+		const FBox BrickBounds(Origin, Origin + FVector(BrickCells * CellSize));
+
+		BrickVolumes.Reset();
+		for (const AGriffonWindVolume *Volume : Volumes)
+		{
+			if (Volume->GetWindBounds().Intersect(BrickBounds))
+				BrickVolumes.Add(Volume);
+		}
+
+		for (int32 Z = 0; Z < BrickPoints; Z++)
+			for (int32 Y = 0; Y < BrickPoints; Y++)
+				for (int32 X = 0; X < BrickPoints; X++)
+				{
+					const FVector Location = Origin + FVector(X, Y, Z) * CellSize;
+
+					FVector AirVelocity = FVector::ZeroVector;
+					for (const AGriffonWindVolume *Volume : BrickVolumes)
+						AirVelocity += Volume->GetAirVelocityAt(Location);
+
+					Brick.Samples[PointIndex(X, Y, Z)] = FVector3f(AirVelocity);
+				}
+	}
+
+	SET_MEMORY_STAT(STAT_GriffonWindMemory, Bricks.GetAllocatedSize() + BrickIndices.GetAllocatedSize());
+
+	Generation++;
+	bDirty = false;
+}
+
+FORCEINLINE const UGriffonWindSubsystem::FBrick* UGriffonWindSubsystem::FindBrick(FGriffonFlightBatch& Batch, int32 Slot, const FIntVector& Coord) const
+{
+	// Flyers stay in the same brick for many frames, the map is only searched when they leave it
+	if (Batch.WindBricks[Slot] != Coord)
+	{
+		const int32 *Index = BrickIndices.Find(Coord);
+		Batch.WindBricks[Slot] = Coord;
+		Batch.WindBrickIndices[Slot] = Index ? *Index : INDEX_NONE;
+	}
+
+	const int32 Index = Batch.WindBrickIndices[Slot];
+	return Index != INDEX_NONE ? &Bricks[Index] : nullptr;
+}
+
+void UGriffonWindSubsystem::SampleBatch(FGriffonFlightBatch& Batch, int32 FirstGroup, int32 NumGroups)
+{
+	SCOPE_CYCLE_COUNTER(STAT_GriffonWindSample);
+
+	constexpr int32 Width = FGriffonFlightBatch::LaneWidth;
+
+	if (bDirty)
+		Rebuild();
+
+	if (Bricks.IsEmpty())
+	{
+		ZeroAirVelocity(Batch, FirstGroup * Width, NumGroups * Width);
+		return;
+	}
+
+	if (Batch.WindGeneration != Generation)
+	{
+		for (int32 Slot = 0; Slot < Batch.WindBricks.Num(); Slot++)
+			Batch.WindBricks[Slot] = FIntVector(MAX_int32);
+
+		Batch.WindGeneration = Generation;
+	}
+
+	const FLane InvCellSize = VectorSetFloat1(1.f / CellSize);
+
+	for (int32 Group = FirstGroup; Group < FirstGroup + NumGroups; Group++)
+	{
+		const int32 Lane = Group * Width;
+
+		const FLane GridX = VectorMultiply(VectorLoadAligned(Batch.PositionX.GetData() + Lane), InvCellSize);
+		const FLane GridY = VectorMultiply(VectorLoadAligned(Batch.PositionY.GetData() + Lane), InvCellSize);
+		const FLane GridZ = VectorMultiply(VectorLoadAligned(Batch.PositionZ.GetData() + Lane), InvCellSize);
+		const FLane CellX = VectorFloor(GridX);
+		const FLane CellY = VectorFloor(GridY);
+		const FLane CellZ = VectorFloor(GridZ);
+
+		alignas(16) float Cells[3][Width];
+		VectorStoreAligned(CellX, Cells[0]);
+		VectorStoreAligned(CellY, Cells[1]);
+		VectorStoreAligned(CellZ, Cells[2]);
+
+		// Gather the 8 corners of the cell of each lane, the interpolation is then done for the 4 lanes at once
+		alignas(16) float Corners[NumCorners][3][Width];
+
+		for (int32 i = 0; i < Width; i++)
+		{
+			const FIntVector Cell(int32(Cells[0][i]), int32(Cells[1][i]), int32(Cells[2][i]));
+			const FIntVector Coord(Cell.X >> BrickShift, Cell.Y >> BrickShift, Cell.Z >> BrickShift);
+
+			const FBrick *Brick = FindBrick(Batch, Lane + i, Coord);
+			if (Brick == nullptr)
+			{
+				for (int32 Corner = 0; Corner < NumCorners; Corner++)
+					Corners[Corner][0][i] = Corners[Corner][1][i] = Corners[Corner][2][i] = 0;
+				continue;
+			}
+
+			const FIntVector Local = Cell - Coord * BrickCells;
+			const FVector3f *Base = Brick->Samples + PointIndex(Local.X, Local.Y, Local.Z);
+
+			for (int32 Corner = 0; Corner < NumCorners; Corner++)
+			{
+				const FVector3f& Sample = Base[CornerOffset(Corner)];
+				Corners[Corner][0][i] = Sample.X;
+				Corners[Corner][1][i] = Sample.Y;
+				Corners[Corner][2][i] = Sample.Z;
+			}
+		}
+
+		// Trilinear
+		const FLane FracX = VectorSubtract(GridX, CellX);
+		const FLane FracY = VectorSubtract(GridY, CellY);
+		const FLane FracZ = VectorSubtract(GridZ, CellZ);
+
+		float *AirVelocity[3] = {Batch.AirVelocityX.GetData(), Batch.AirVelocityY.GetData(), Batch.AirVelocityZ.GetData()};
+
+		for (int32 Axis = 0; Axis < 3; Axis++)
+		{
+			const FLane X00 = Lerp(VectorLoadAligned(Corners[0][Axis]), VectorLoadAligned(Corners[1][Axis]), FracX);
+			const FLane X10 = Lerp(VectorLoadAligned(Corners[2][Axis]), VectorLoadAligned(Corners[3][Axis]), FracX);
+			const FLane X01 = Lerp(VectorLoadAligned(Corners[4][Axis]), VectorLoadAligned(Corners[5][Axis]), FracX);
+			const FLane X11 = Lerp(VectorLoadAligned(Corners[6][Axis]), VectorLoadAligned(Corners[7][Axis]), FracX);
+
+			const FLane Value = Lerp(Lerp(X00, X10, FracY), Lerp(X01, X11, FracY), FracZ);
+			VectorStoreAligned(Value, AirVelocity[Axis] + Lane);
+		}
+	}
+}
@@ -0,0 +1,37 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GriffonWindVolume.h"
+#include "GriffonWindSubsystem.h"
+
+FBox AGriffonWindVolume::GetWindBounds() const
+{
+	return GetComponentsBoundingBox().ExpandBy(Falloff);
+}
+
+FVector AGriffonWindVolume::GetAirVelocityAt(const FVector& Location) const
+{
+	float Distance = MAX_flt;
+	if (!EncompassesPoint(Location, 0, &Distance) && Distance >= Falloff)
+		return FVector::ZeroVector;
+
+	const float Weight = Falloff > 0 ? 1 - FMath::Clamp(Distance / Falloff, 0.f, 1.f) : 1;
+
+	return (Wind + FVector(0, 0, Thermal)) * Weight;
+}
+
+void AGriffonWindVolume::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (UGriffonWindSubsystem *WindSubsystem = GetWorld()->GetSubsystem<UGriffonWindSubsystem>())
+		WindSubsystem->RegisterVolume(this);
+}
+
+void AGriffonWindVolume::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UGriffonWindSubsystem *WindSubsystem = GetWorld()->GetSubsystem<UGriffonWindSubsystem>())
+		WindSubsystem->UnregisterVolume(this);
+
+	Super::EndPlay(EndPlayReason);
+}
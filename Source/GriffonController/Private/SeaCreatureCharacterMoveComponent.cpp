@@ -0,0 +1,185 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SeaCreatureCharacterMoveComponent.h"
+
+#include "GriffonStats.h"
+#include "GriffonWaterBody.h"
+#include "Components/CapsuleComponent.h"
+#include "GameFramework/Character.h"
+
+DECLARE_CYCLE_STAT(TEXT("Swim Phys"), STAT_SeaCreatureSwimPhys, STATGROUP_Griffon);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Swimmers"), STAT_SeaCreatureSwimmers, STATGROUP_Griffon);
+
+void USeaCreatureCharacterMoveComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	WaterSubsystem = GetWorld()->GetSubsystem<UGriffonWaterSubsystem>();
+
+	if (UpdatedPrimitive)
+	{
+		UpdatedPrimitive->OnComponentBeginOverlap.AddUniqueDynamic(this, &USeaCreatureCharacterMoveComponent::OnWaterBeginOverlap);
+		UpdatedPrimitive->OnComponentEndOverlap.AddUniqueDynamic(this, &USeaCreatureCharacterMoveComponent::OnWaterEndOverlap);
+
+		// Spawned in the water, the overlaps began before the binding
+		TArray<AActor *> Bodies;
+		UpdatedPrimitive->GetOverlappingActors(Bodies, AGriffonWaterBody::StaticClass());
+		for (AActor *Body : Bodies)
+			OverlappedBodies.AddUnique(Cast<AGriffonWaterBody>(Body));
+	}
+}
+
+///////////////////
+/// SWIMMING
+
+bool USeaCreatureCharacterMoveComponent::IsCreatureSwimming() const
+{
+	return MovementMode == EMovementMode::MOVE_Custom && CustomMovementMode == ECustomMovementMode::CMOVE_Swimming;
+}
+
+float USeaCreatureCharacterMoveComponent::GetDepth() const
+{
+	return bInWater ? FMath::Max(0.f, WaterHeight - UpdatedComponent->GetComponentLocation().Z) : 0;
+}
+
+float USeaCreatureCharacterMoveComponent::ComputeImmersion() const
+{
+	if (!bInWater)
+		return 0;
+
+	const float HalfHeight = CharacterOwner->GetCapsuleComponent()->GetScaledCapsuleHalfHeight();
+	const float Bottom = UpdatedComponent->GetComponentLocation().Z - HalfHeight;
+
+	return FMath::Clamp((WaterHeight - Bottom) / (2 * HalfHeight), 0.f, 1.f);
+}
+
+void USeaCreatureCharacterMoveComponent::UpdateCharacterStateBeforeMovement(float DeltaSeconds)
+{
+	// One query per tick, only between entering and leaving a body
+	bInWater = !OverlappedBodies.IsEmpty() && WaterSubsystem &&
+		WaterSubsystem->FindWaterHeight(UpdatedComponent->GetComponentLocation(), WaterTileCache, WaterHeight);
+	Immersion = ComputeImmersion();
+
+	if (!IsCreatureSwimming() && Immersion >= ImmersionToSwim)
+	{
+		SetMovementMode(EMovementMode::MOVE_Custom, ECustomMovementMode::CMOVE_Swimming);
+	} else if (IsCreatureSwimming() && Immersion < ImmersionToLeave)
+	{
+		SetMovementMode(EMovementMode::MOVE_Falling);
+	}
+
+	if (IsCreatureSwimming())
+		INC_DWORD_STAT(STAT_SeaCreatureSwimmers);
+
+	Super::UpdateCharacterStateBeforeMovement(DeltaSeconds);
+}
+
+void USeaCreatureCharacterMoveComponent::OnWaterBeginOverlap(UPrimitiveComponent *OverlappedComponent, AActor *OtherActor,
+	UPrimitiveComponent *OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
+{
+	if (AGriffonWaterBody *Body = Cast<AGriffonWaterBody>(OtherActor))
+		OverlappedBodies.AddUnique(Body);
+}
+
+void USeaCreatureCharacterMoveComponent::OnWaterEndOverlap(UPrimitiveComponent *OverlappedComponent, AActor *OtherActor,
+	UPrimitiveComponent *OtherComp, int32 OtherBodyIndex)
+{
+	if (AGriffonWaterBody *Body = Cast<AGriffonWaterBody>(OtherActor))
+		OverlappedBodies.Remove(Body);
+}
+
+///////////////////
+/// SWIMMING PHYSICS
+
+void USeaCreatureCharacterMoveComponent::PhysCustom(float deltaTime, int32 Iterations)
+{
+	if (CustomMovementMode == ECustomMovementMode::CMOVE_Swimming)
+	{
+		PhysSwimming(deltaTime, Iterations);
+	}
+
+	Super::PhysCustom(deltaTime, Iterations);
+}
+
+void USeaCreatureCharacterMoveComponent::PhysicsRotation(float DeltaTime)
+{
+	if (!IsCreatureSwimming())
+	{
+		// Back upright out of the water, ShouldRemainVertical
+		Super::PhysicsRotation(DeltaTime);
+		return;
+	}
+
+	if (Velocity.IsNearlyZero())
+		return;
+
+	const float InterpSpeed = FMath::GetMappedRangeValueClamped(FVector2D(0, MaxSwimSpeed), SwimRotationInterpSpeed, Velocity.Size());
+	const FRotator Rotation = FMath::RInterpTo(UpdatedComponent->GetComponentRotation(), Velocity.ToOrientationRotator(), DeltaTime, InterpSpeed);
+
+	constexpr bool bSweep = false;
+	MoveUpdatedComponent(FVector::ZeroVector, Rotation, bSweep);
+}
+
+void USeaCreatureCharacterMoveComponent::PhysSwimming(float deltaTime, int32 Iterations)
+{
+	SCOPE_CYCLE_COUNTER(STAT_SeaCreatureSwimPhys);
+
+	if (deltaTime < MIN_TICK_TIME)
+	{
+		return;
+	}
+
+	RestorePreAdditiveRootMotionVelocity();
+
+	// Same water height for the whole tick, the immersion follows the capsule
+	Immersion = ComputeImmersion();
+
+	if (!HasAnimRootMotion() && !CurrentRootMotion.HasOverrideVelocity())
+	{
+		// DRAG
+		// Input acceleration in every direction, slowed by the water it is in
+		constexpr bool bFluid = true;
+		CalcVelocity(deltaTime, WaterFriction * Immersion, bFluid, GetMaxBrakingDeceleration());
+
+		// BUOYANCY
+		// Gravity less the push of the water, the creature settles where they cancel out
+		Velocity.Z += GetGravityZ() * (1 - Buoyancy * Immersion) * deltaTime;
+	}
+
+	ApplyRootMotionToVelocity(deltaTime);
+
+	// MOVE
+	Iterations++;
+	const FVector OldLocation = UpdatedComponent->GetComponentLocation();
+	const FVector Adjusted = Velocity * deltaTime;
+
+	FHitResult Hit(1.f);
+	SafeMoveUpdatedComponent(Adjusted, UpdatedComponent->GetComponentQuat(), true, Hit);
+
+	if (Hit.Time < 1.f)
+	{
+		HandleImpact(Hit, deltaTime, Adjusted);
+		SlideAlongSurface(Adjusted, (1.f - Hit.Time), Hit.Normal, Hit, true);
+	}
+
+	if (!HasAnimRootMotion() && !CurrentRootMotion.HasOverrideVelocity())
+	{
+		Velocity = (UpdatedComponent->GetComponentLocation() - OldLocation) / deltaTime;
+	}
+}
+
+float USeaCreatureCharacterMoveComponent::GetMaxSpeed() const
+{
+	return IsCreatureSwimming() ? MaxSwimSpeed : Super::GetMaxSpeed();
+}
+
+float USeaCreatureCharacterMoveComponent::GetMaxBrakingDeceleration() const
+{
+	return IsCreatureSwimming() ? BrakingDecelerationSwimming : Super::GetMaxBrakingDeceleration();
+}
+
+FVector USeaCreatureCharacterMoveComponent::ConstrainInputAcceleration(const FVector& InputAcceleration) const
+{
+	// Not left to the base one, which only knows the engine modes
+	return IsCreatureSwimming() ? InputAcceleration : Super::ConstrainInputAcceleration(InputAcceleration);
+}
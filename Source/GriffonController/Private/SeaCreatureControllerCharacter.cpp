@@ -13,10 +13,10 @@
 #include "EnumFile.h"
 #include "ShapeShiftManager.h"
 #include "Chaos/Utilities.h"
-#include "Kismet/KismetMathLibrary.h"
 
 // Sets default values
-ASeaCreatureControllerCharacter::ASeaCreatureControllerCharacter()
+ASeaCreatureControllerCharacter::ASeaCreatureControllerCharacter(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer.SetDefaultSubobjectClass<USeaCreatureCharacterMoveComponent>(ACharacter::CharacterMovementComponentName))
 {
 	// Set size for collision capsule
 	GetCapsuleComponent()->InitCapsuleSize(42.f, 96.0f);
@@ -37,6 +37,7 @@ ASeaCreatureControllerCharacter::ASeaCreatureControllerCharacter()
 	GetCharacterMovement()->MaxWalkSpeed = 500.f;
 	GetCharacterMovement()->MinAnalogWalkSpeed = 20.f;
 	GetCharacterMovement()->BrakingDecelerationWalking = 2000.f;
+	GetCharacterMovement()->MaxSwimSpeed = 500.f;
 
 	// Create a camera boom (pulls in towards the player if there is a collision)
 	CameraBoom = CreateDefaultSubobject<USpringArmComponent>(TEXT("CameraBoom"));
@@ -52,6 +53,7 @@ ASeaCreatureControllerCharacter::ASeaCreatureControllerCharacter()
 	// Note: The skeletal mesh and anim blueprint references on the Mesh component (inherited from Character) 
 	// are set in the derived blueprint asset named ThirdPersonCharacter (to avoid direct content references in C++)
 
+	MovementComponent = Cast<USeaCreatureCharacterMoveComponent>(GetCharacterMovement());
 }
 
 // Called when the game starts or when spawned
@@ -130,12 +132,9 @@ void ASeaCreatureControllerCharacter::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
 
-	float InterpSpeed = UKismetMathLibrary::MapRangeClamped(GetCharacterMovement()->Velocity.Length(),	0, 500,
-																											0.4, 4);
-	SetActorRotation(FMath::RInterpTo(GetActorRotation(), GetCharacterMovement()->Velocity.ToOrientationRotator(), DeltaTime, InterpSpeed));
 }
 
 void ASeaCreatureControllerCharacter::StartShapeShifting()
 {
-	GetShapeShiftManager()->ShapeShiftToForm(SSForm_Druid);
+	ServerShapeShiftToForm(SSForm_Druid);
 }
@@ -2,7 +2,14 @@
 
 
 #include "ShapeShiftForm.h"
+#include "ShapeShiftInputRecording.h"
 #include "ShapeShiftManager.h"
+#include "EnhancedInputSubsystems.h"
+#include "EnhancedPlayerInput.h"
+#include "Engine/InputDelegateBinding.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "GameFramework/PlayerController.h"
+#include "Net/UnrealNetwork.h"
 
 // Sets default values
 AShapeShiftForm::AShapeShiftForm(const FObjectInitializer& ObjectInitializer)
@@ -28,3 +35,134 @@ void AShapeShiftForm::StartShapeShifting()
 	
 }
 
+void AShapeShiftForm::ServerPrepareForm_Implementation(EShapeShiftForm Form)
+{
+	if (ShapeShiftManagerRef)
+		ShapeShiftManagerRef->PrepareForm(GetController(), Form);
+}
+
+void AShapeShiftForm::ServerShapeShiftToForm_Implementation(EShapeShiftForm Form)
+{
+	if (ShapeShiftManagerRef)
+		ShapeShiftManagerRef->ShapeShiftToForm(GetController(), Form);
+}
+
+void AShapeShiftForm::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(AShapeShiftForm, ShapeShiftManagerRef);
+}
+
+void AShapeShiftForm::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	// The controller processed this frame inputs before
+	FShapeShiftInputRecorder& Recorder = FShapeShiftInputRecorder::Get();
+	if (Recorder.IsRecording() && IsLocallyControlled())
+	{
+		FShapeShiftInputFrame Frame;
+		if (CaptureInput(Frame))
+			Recorder.Record(this, Frame);
+	}
+}
+
+///////////////////
+/// HANDOFF
+
+void AShapeShiftForm::PrebuildInput(APlayerController *PlayerController)
+{
+	// Same as APawn::PawnClientRestart, which skips it once done
+	if (InputComponent == nullptr)
+	{
+		InputComponent = CreatePlayerInputComponent();
+		if (InputComponent)
+		{
+			SetupPlayerInputComponent(InputComponent);
+			InputComponent->RegisterComponent();
+			if (UInputDelegateBinding::SupportsInputDelegate(GetClass()))
+			{
+				InputComponent->bBlockInput = bBlockInput;
+				UInputDelegateBinding::BindInputDelegatesWithSubobjects(this, InputComponent);
+			}
+		}
+	}
+
+	// Never removed, the actions of the other forms reach no input component. The controls
+	// are rebuilt the next frame, while the form is still prepared
+	UEnhancedInputLocalPlayerSubsystem *Subsystem = PlayerController ?
+		ULocalPlayer::GetSubsystem<UEnhancedInputLocalPlayerSubsystem>(PlayerController->GetLocalPlayer()) : nullptr;
+	if (Subsystem && DefaultMappingContext && !Subsystem->HasMappingContext(DefaultMappingContext))
+		Subsystem->AddMappingContext(DefaultMappingContext, 0);
+}
+
+void AShapeShiftForm::DestroyPlayerInputComponent()
+{
+	if (IsActorBeingDestroyed())
+		Super::DestroyPlayerInputComponent();
+}
+
+void AShapeShiftForm::PawnClientRestart()
+{
+	Super::PawnClientRestart();
+
+	// Remote players, the server prepared the form without their local player
+	APlayerController *PlayerController = Cast<APlayerController>(Controller);
+	if (PlayerController && PlayerController->IsLocalController())
+		PrebuildInput(PlayerController);
+}
+
+void AShapeShiftForm::SaveMovementState(FShapeShiftMovementState& OutState) const
+{
+	const UCharacterMovementComponent *Movement = GetCharacterMovement();
+	OutState.Velocity = Movement->Velocity;
+	OutState.MovementMode = Movement->MovementMode;
+	OutState.CustomMovementMode = Movement->CustomMovementMode;
+}
+
+void AShapeShiftForm::RestoreMovementState(const FShapeShiftMovementState& State)
+{
+	UCharacterMovementComponent *Movement = GetCharacterMovement();
+
+	// Mode first, leaving climbing stops the movement
+	Movement->SetMovementMode(State.MovementMode == MOVE_Custom ? MOVE_Falling : State.MovementMode.GetValue());
+	Movement->Velocity = State.Velocity;
+}
+
+///////////////////
+/// DORMANCY
+
+void AShapeShiftForm::EnterDormancy()
+{
+	if (bDormant)
+		return;
+
+	// The movement and input components too, their tick functions and bindings come back with them
+	UnregisterAllComponents();
+	bDormant = true;
+}
+
+void AShapeShiftForm::ExitDormancy()
+{
+	if (!bDormant)
+		return;
+
+	RegisterAllComponents();
+	bDormant = false;
+}
+
+///////////////////
+/// INPUT RECORDING
+
+FInputActionValue AShapeShiftForm::GetActionValue(const UInputAction *Action) const
+{
+	const APlayerController *PlayerController = Cast<APlayerController>(Controller);
+	if (Action == nullptr || PlayerController == nullptr)
+		return FInputActionValue();
+
+	const UEnhancedInputLocalPlayerSubsystem *Subsystem = ULocalPlayer::GetSubsystem<UEnhancedInputLocalPlayerSubsystem>(PlayerController->GetLocalPlayer());
+	const UEnhancedPlayerInput *PlayerInput = Subsystem ? Subsystem->GetPlayerInput() : nullptr;
+
+	return PlayerInput ? PlayerInput->GetActionValue(Action) : FInputActionValue();
+}
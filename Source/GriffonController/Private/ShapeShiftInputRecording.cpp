@@ -0,0 +1,167 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ShapeShiftInputRecording.h"
+#include "GriffonController.h"
+#include "ShapeShiftForm.h"
+#include "Engine/World.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/App.h"
+#include "Misc/DateTime.h"
+#include "Misc/Paths.h"
+#include "Serialization/Archive.h"
+
+namespace
+{
+	FAutoConsoleCommand RecordCommand(
+		TEXT("griffon.Input.Record"),
+		TEXT("Record the inputs of the controlled form until griffon.Input.Stop."),
+		FConsoleCommandDelegate::CreateLambda([]()
+		{
+			FShapeShiftInputRecorder::Get().Start();
+		}));
+
+	FAutoConsoleCommand StopCommand(
+		TEXT("griffon.Input.Stop"),
+		TEXT("Write the input recording to Saved/Replays."),
+		FConsoleCommandDelegate::CreateLambda([]()
+		{
+			FShapeShiftInputRecorder::Get().Stop();
+		}));
+
+	template <typename FunctorType>
+	bool SaveFile(const FString& Filename, uint32 Magic, uint32 Version, FunctorType&& Content)
+	{
+		TUniquePtr<FArchive> Writer = TUniquePtr<FArchive>(IFileManager::Get().CreateFileWriter(*Filename));
+		if (!Writer)
+		{
+			UE_LOG(LogGriffon, Warning, TEXT("Input replay: can't write %s"), *Filename);
+			return false;
+		}
+
+		*Writer << Magic << Version;
+		Content(*Writer);
+
+		return Writer->Close();
+	}
+
+	template <typename FunctorType>
+	bool LoadFile(const FString& Filename, uint32 ExpectedMagic, uint32 ExpectedVersion, FunctorType&& Content)
+	{
+		TUniquePtr<FArchive> Reader = TUniquePtr<FArchive>(IFileManager::Get().CreateFileReader(*Filename));
+		if (!Reader)
+		{
+			UE_LOG(LogGriffon, Warning, TEXT("Input replay: can't read %s"), *Filename);
+			return false;
+		}
+
+		uint32 Magic, Version;
+		*Reader << Magic << Version;
+
+		if (Magic != ExpectedMagic || Version != ExpectedVersion)
+		{
+			UE_LOG(LogGriffon, Warning, TEXT("Input replay: %s is not a version %u file"), *Filename, ExpectedVersion);
+			return false;
+		}
+
+		Content(*Reader);
+
+		return !Reader->IsError();
+	}
+}
+
+///////////////////
+/// RECORDING
+
+bool FShapeShiftInputRecording::Save(const FString& Filename)
+{
+	auto Content = [this](FArchive& Ar) { Ar << MapName << FormClass << FixedStep << StartTransform << StartMovementState << Frames; };
+	return SaveFile(Filename, FileMagic, FileVersion, Content);
+}
+
+bool FShapeShiftInputRecording::Load(const FString& Filename)
+{
+	auto Content = [this](FArchive& Ar) { Ar << MapName << FormClass << FixedStep << StartTransform << StartMovementState << Frames; };
+	return LoadFile(Filename, FileMagic, FileVersion, Content);
+}
+
+///////////////////
+/// TRACK
+
+bool FShapeShiftReplayTrack::Save(const FString& Filename)
+{
+	auto Content = [this](FArchive& Ar) { Ar << Samples; };
+	return SaveFile(Filename, FileMagic, FileVersion, Content);
+}
+
+bool FShapeShiftReplayTrack::Load(const FString& Filename)
+{
+	auto Content = [this](FArchive& Ar) { Ar << Samples; };
+	return LoadFile(Filename, FileMagic, FileVersion, Content);
+}
+
+///////////////////
+/// RECORDER
+
+FShapeShiftInputRecorder& FShapeShiftInputRecorder::Get()
+{
+	static FShapeShiftInputRecorder Recorder;
+	return Recorder;
+}
+
+void FShapeShiftInputRecorder::Start()
+{
+	if (!FApp::UseFixedTimeStep())
+		UE_LOG(LogGriffon, Warning, TEXT("Input replay: recording without -UseFixedTimeStep, the replay will run other frames"));
+
+	Recording = FShapeShiftInputRecording();
+	RecordedForm = nullptr;
+	bRecording = true;
+}
+
+bool FShapeShiftInputRecorder::Stop()
+{
+	if (!bRecording)
+		return false;
+
+	bRecording = false;
+
+	if (Recording.Frames.IsEmpty())
+	{
+		UE_LOG(LogGriffon, Warning, TEXT("Input replay: nothing recorded, is a form controlled?"));
+		return false;
+	}
+
+	const FString Filename = FPaths::ProjectSavedDir() / TEXT("Replays") /
+		FString::Printf(TEXT("Input_%s.gsir"), *FDateTime::Now().ToString());
+
+	if (!Recording.Save(Filename))
+		return false;
+
+	UE_LOG(LogGriffon, Log, TEXT("Input replay: %d frames written to %s"), Recording.Frames.Num(), *Filename);
+	return true;
+}
+
+void FShapeShiftInputRecorder::Record(const AShapeShiftForm *Form, const FShapeShiftInputFrame& Frame)
+{
+	// First frame, where the replay starts from
+	if (!RecordedForm.IsValid() && Recording.Frames.IsEmpty())
+	{
+		RecordedForm = Form;
+		Recording.MapName = UWorld::RemovePIEPrefix(Form->GetWorld()->GetOutermost()->GetName());
+		Recording.FormClass = Form->GetClass()->GetPathName();
+		Recording.FixedStep = FApp::UseFixedTimeStep() ? FApp::GetFixedDeltaTime() : Form->GetWorld()->GetDeltaSeconds();
+		Recording.StartTransform = Form->GetActorTransform();
+		Form->SaveMovementState(Recording.StartMovementState);
+	}
+
+	// An other form is played now, it can't be replayed in the same recording
+	if (RecordedForm.Get() != Form)
+	{
+		Stop();
+		return;
+	}
+
+	Recording.Frames.Add(Frame);
+}
@@ -3,8 +3,16 @@
 
 #include "ShapeShiftManager.h"
 #include "ShapeShiftForm.h"
-#include "GameFramework/Character.h"
-#include "GameFramework/PawnMovementComponent.h"
+#include "ShapeShiftSubsystem.h"
+#include "GriffonController.h"
+#include "GriffonStats.h"
+#include "Engine/AssetManager.h"
+#include "Engine/World.h"
+#include "GameFramework/GameModeBase.h"
+#include "GameFramework/PlayerController.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Resident Forms"), STAT_ResidentForms, STATGROUP_Griffon);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Resident Forms MB"), STAT_ResidentFormsMB, STATGROUP_Griffon);
 
 // Sets default values
 AShapeShiftManager::AShapeShiftManager()
@@ -12,110 +20,302 @@ AShapeShiftManager::AShapeShiftManager()
  	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
 	PrimaryActorTick.bCanEverTick = true;
 
-	CharacterRefs.Init(nullptr, 4);
+	// Placed in the level, without replicating it would have authority on the clients too
+	bReplicates = true;
+	bAlwaysRelevant = true;
 }
 
 // Called when the game starts or when spawned
 void AShapeShiftManager::BeginPlay()
 {
 	Super::BeginPlay();
-	
-	// DRUID
-	if (ShapeShiftFormDruidClass)
+
+	ShapeShiftSubsystem = GetWorld()->GetSubsystem<UShapeShiftSubsystem>();
+
+	const double StartTime = FPlatformTime::Seconds();
+
+	// DRUID, the only form loaded up front. The others stream in when the druid charges
+	if (!ShapeShiftFormDruidClass.IsNull())
 	{
-		CharacterRefs[SSForm_Druid] = GetWorld()->SpawnActor<AShapeShiftForm>(ShapeShiftFormDruidClass, GetActorLocation(), GetActorRotation());
-		if (CharacterRefs[SSForm_Druid])
-		{
-			CharacterRefs[SSForm_Druid]->SetShapeShiftManager(this);
-			SetActiveCharacter(CharacterRefs[SSForm_Druid], false);
-		}
+		FormHandles[SSForm_Druid] = UAssetManager::GetStreamableManager().RequestSyncLoad(ShapeShiftFormDruidClass.ToSoftObjectPath());
+		OnFormLoaded(SSForm_Druid);
 	}
-	
-	// GRIFFON
-	if (ShapeShiftFormGriffonClass)
+
+	// The server possesses the druids, clients only stream the forms
+	if (HasAuthority())
 	{
-		CharacterRefs[SSForm_Griffon] = GetWorld()->SpawnActor<AShapeShiftForm>(ShapeShiftFormGriffonClass, GetActorLocation(), GetActorRotation());
-		if (CharacterRefs[SSForm_Griffon])
+		for (FConstPlayerControllerIterator Iterator = GetWorld()->GetPlayerControllerIterator(); Iterator; ++Iterator)
 		{
-			CharacterRefs[SSForm_Griffon]->SetShapeShiftManager(this);
-			SetActiveCharacter(CharacterRefs[SSForm_Griffon], false);
+			AddPlayer(Iterator->Get());
 		}
+		PostLoginHandle = FGameModeEvents::GameModePostLoginEvent.AddUObject(this, &AShapeShiftManager::OnPostLogin);
 	}
-	
-	// Werewolf
-	if (ShapeShiftFormWerewolfClass)
+
+	UE_LOG(LogGriffon, Log, TEXT("ShapeShiftManager: druid ready in %.1fms, %.1fMB resident"),
+		(FPlatformTime::Seconds() - StartTime) * 1000, FormSizes[SSForm_Druid] / (1024.f * 1024.f));
+}
+
+void AShapeShiftManager::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	FGameModeEvents::GameModePostLoginEvent.Remove(PostLoginHandle);
+
+	Super::EndPlay(EndPlayReason);
+}
+
+// Called every frame
+void AShapeShiftManager::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+}
+
+void AShapeShiftManager::AddPlayer(AController *Controller)
+{
+	// Players possessing a form already came through here
+	if (Controller && GetForm(Controller) == SSForm_MAX)
+		ShapeShiftToForm(Controller, SSForm_Druid);
+}
+
+void AShapeShiftManager::OnPostLogin(AGameModeBase *GameMode, APlayerController *NewPlayer)
+{
+	if (GameMode->GetWorld() == GetWorld())
+		AddPlayer(NewPlayer);
+}
+
+void AShapeShiftManager::ShapeShiftBackToDruid(AController *Controller)
+{
+	if (GetForm(Controller) == SSForm_Druid)
+		return;
+
+	ShapeShiftToForm(Controller, SSForm_Druid);
+}
+
+void AShapeShiftManager::PrepareForm(AController *Controller, EShapeShiftForm form)
+{
+	if (!HasAuthority())
+		return;
+
+	// Not loaded yet, the swap frame does it all
+	if (IsFormResident(form))
+		ShapeShiftSubsystem->PrepareForm(Controller, GetFormClass(form).Get());
+	else
+		PreloadForm(form);
+}
+
+void AShapeShiftManager::ShapeShiftToForm(AController *Controller, EShapeShiftForm form)
+{
+	if (!HasAuthority() || Controller == nullptr)
+		return;
+
+	// Still streaming, it shapeshifts once loaded
+	if (!IsFormResident(form))
 	{
-		CharacterRefs[SSForm_Werewolf] = GetWorld()->SpawnActor<AShapeShiftForm>(ShapeShiftFormWerewolfClass, GetActorLocation(), GetActorRotation());
-		if (CharacterRefs[SSForm_Werewolf])
+		PendingForms.Add(Controller, form);
+		PreloadForm(form);
+		return;
+	}
+
+	PendingForms.Remove(Controller);
+
+	// Where the previous form stands, at the manager for a new player
+	FTransform Transform = GetActorTransform();
+	if (const APawn *Previous = Controller->GetPawn())
+	{
+		Transform.SetLocation(Previous->GetActorLocation());
+		Transform.SetRotation(FRotator(0, Previous->GetActorRotation().Yaw, 0).Quaternion());
+	}
+
+	AShapeShiftForm *Form = ShapeShiftSubsystem->PossessForm(Controller, GetFormClass(form).Get(), Transform);
+	if (Form)
+		Form->SetShapeShiftManager(this);
+
+	TouchForm(form);
+	EvictForms();
+}
+
+EShapeShiftForm AShapeShiftManager::GetForm(const AController *Controller) const
+{
+	const AShapeShiftForm *Form = Cast<AShapeShiftForm>(Controller->GetPawn());
+	if (Form == nullptr)
+		return SSForm_MAX;
+
+	for (int32 Index = 0; Index < SSForm_MAX; Index++)
+	{
+		const EShapeShiftForm Candidate = static_cast<EShapeShiftForm>(Index);
+		if (Form->GetClass() == GetFormClass(Candidate).Get())
+			return Candidate;
+	}
+
+	return SSForm_MAX;
+}
+
+///////////////////
+/// FORM STREAMING
+
+void AShapeShiftManager::PreloadForm(EShapeShiftForm Form)
+{
+	const TSoftClassPtr<AShapeShiftForm>& FormClass = GetFormClass(Form);
+	if (FormClass.IsNull() || FormHandles[Form].IsValid())
+		return;
+
+	FormHandles[Form] = UAssetManager::GetStreamableManager().RequestAsyncLoad(FormClass.ToSoftObjectPath(),
+		FStreamableDelegate::CreateUObject(this, &AShapeShiftManager::OnFormLoaded, Form));
+}
+
+void AShapeShiftManager::PreloadCandidateForms()
+{
+	// Last used first. Never used forms come after, in the order of the menu
+	int32 NumPreloaded = 0;
+	for (EShapeShiftForm Form : RecentForms)
+	{
+		if (NumPreloaded == NumCandidateForms)
+			return;
+
+		if (Form != SSForm_Druid)
 		{
-			CharacterRefs[SSForm_Werewolf]->SetShapeShiftManager(this);
-			SetActiveCharacter(CharacterRefs[SSForm_Werewolf], false);
+			PreloadForm(Form);
+			NumPreloaded++;
 		}
 	}
-	
-	// SeaCreature
-	if (ShapeShiftFormSeaCreatureClass)
+
+	for (int32 Form = SSForm_Druid + 1; Form < SSForm_MAX && NumPreloaded < NumCandidateForms; Form++)
 	{
-		CharacterRefs[SSForm_SeaCreature] = GetWorld()->SpawnActor<AShapeShiftForm>(ShapeShiftFormSeaCreatureClass, GetActorLocation(), GetActorRotation());
-		if (CharacterRefs[SSForm_SeaCreature])
+		if (!RecentForms.Contains(static_cast<EShapeShiftForm>(Form)))
 		{
-			CharacterRefs[SSForm_SeaCreature]->SetShapeShiftManager(this);
-			SetActiveCharacter(CharacterRefs[SSForm_SeaCreature], false);
+			PreloadForm(static_cast<EShapeShiftForm>(Form));
+			NumPreloaded++;
 		}
 	}
-
-	ShapeShiftToForm(SSForm_Druid);
 }
 
-// Called every frame
-void AShapeShiftManager::Tick(float DeltaTime)
+bool AShapeShiftManager::IsFormResident(EShapeShiftForm Form) const
 {
-	Super::Tick(DeltaTime);
-
+	return GetFormClass(Form).Get() != nullptr;
 }
 
-void AShapeShiftManager::SetActiveCharacter(ACharacter *Character, bool Active)
+const TSoftClassPtr<AShapeShiftForm>& AShapeShiftManager::GetFormClass(EShapeShiftForm Form) const
 {
-	if (Active == true)
-	{
-		Character->SetActorHiddenInGame(false);
-		Character->SetActorEnableCollision(true);
-		Character->SetActorTickEnabled(true);
-		Character->GetMovementComponent()->Activate();
-	} else
+	switch (Form)
 	{
-		Character->SetActorHiddenInGame(true);
-		Character->SetActorEnableCollision(false);
-		Character->SetActorTickEnabled(false);
-		Character->GetMovementComponent()->Deactivate();
+	case SSForm_Griffon:
+		return ShapeShiftFormGriffonClass;
+	case SSForm_Werewolf:
+		return ShapeShiftFormWerewolfClass;
+	case SSForm_SeaCreature:
+		return ShapeShiftFormSeaCreatureClass;
+	default:
+		return ShapeShiftFormDruidClass;
 	}
 }
 
-void AShapeShiftManager::ShapeShiftBackToDruid()
+void AShapeShiftManager::OnFormLoaded(EShapeShiftForm Form)
 {
-	if (ActualForm == SSForm_Druid)
+	UClass *FormClass = GetFormClass(Form).Get();
+	if (FormClass == nullptr)
+	{
+		UE_LOG(LogGriffon, Warning, TEXT("ShapeShiftManager: can't load %s"), *GetFormClass(Form).ToString());
+		FormHandles[Form].Reset();
+		for (auto It = PendingForms.CreateIterator(); It; ++It)
+		{
+			if (It.Value() == Form)
+				It.RemoveCurrent();
+		}
 		return;
-	
-	ActualForm = SSForm_Druid;
+	}
+
+	// Resident is all a client needs, the forms are pooled and possessed on the server
+	if (!HasAuthority())
+		return;
+
+	// One hidden in the pool, ready to be possessed. Meshes, textures and sounds of its components,
+	// close enough to compare the forms
+	if (const AShapeShiftForm *PooledForm = ShapeShiftSubsystem->PrewarmForm(FormClass))
+	{
+		int64 Size = 0;
+		TInlineComponentArray<UActorComponent *> Components(PooledForm);
+		for (const UActorComponent *Component : Components)
+		{
+			Size += Component->GetResourceSizeBytes(EResourceSizeMode::EstimatedTotal);
+		}
+		FormSizes[Form] = Size;
+	}
+
+	// Copied, shapeshifting removes from it
+	TArray<TWeakObjectPtr<AController>> Waiting;
+	for (const TPair<TWeakObjectPtr<AController>, EShapeShiftForm>& Pair : PendingForms)
+	{
+		if (Pair.Value == Form)
+			Waiting.Add(Pair.Key);
+	}
+
+	for (const TWeakObjectPtr<AController>& Controller : Waiting)
+	{
+		PendingForms.Remove(Controller);
+		if (Controller.IsValid())
+			ShapeShiftToForm(Controller.Get(), Form);
+	}
+
+	EvictForms();
 }
 
-void AShapeShiftManager::ShapeShiftToForm(EShapeShiftForm form)
+void AShapeShiftManager::EvictForms()
 {
-	if (CharacterRefs[ActualForm] && CharacterRefs[form])
+	const int64 Budget = static_cast<int64>(FormMemoryBudgetMB * 1024 * 1024);
+
+	int64 ResidentSize = 0;
+	for (int32 Form = 0; Form < SSForm_MAX; Form++)
 	{
-		SetActiveCharacter(CharacterRefs[ActualForm], false);
-		SetActiveCharacter(CharacterRefs[form], true);
+		ResidentSize += FormSizes[Form];
+	}
 
-		CharacterRefs[form]->SetActorLocation(CharacterRefs[ActualForm]->GetActorLocation());
-		CharacterRefs[form]->SetActorRotation(FRotator(0, CharacterRefs[ActualForm]->GetActorRotation().Yaw, 0));
+	for (int32 Index = RecentForms.Num() - 1; Index >= 0 && ResidentSize > Budget; Index--)
+	{
+		const EShapeShiftForm Form = RecentForms[Index];
+		if (IsFormPinned(Form) || !FormHandles[Form].IsValid())
+			continue;
 
-		APlayerController *Controller = GetWorld()->GetFirstPlayerController();
+		ShapeShiftSubsystem->FlushPool(GetFormClass(Form).Get());
+		FormHandles[Form]->ReleaseHandle();
+		FormHandles[Form].Reset();
+		ResidentSize -= FormSizes[Form];
+		FormSizes[Form] = 0;
+	}
 
-		FRotator RotationController = Controller->GetControlRotation();
-		Controller->Possess(CharacterRefs[form]);
-		Controller->SetControlRotation(RotationController);
-		
-		ActualForm = form;
+	UpdateFormStats();
+}
+
+bool AShapeShiftManager::IsFormPinned(EShapeShiftForm Form) const
+{
+	// The druid, the possessed forms and the ones waited for stay
+	if (Form == SSForm_Druid)
+		return true;
+
+	for (const TPair<TWeakObjectPtr<AController>, EShapeShiftForm>& Pair : PendingForms)
+	{
+		if (Pair.Value == Form)
+			return true;
 	}
+
+	UClass *FormClass = GetFormClass(Form).Get();
+	return FormClass && ShapeShiftSubsystem->GetNumActive(FormClass) > 0;
 }
 
+void AShapeShiftManager::TouchForm(EShapeShiftForm Form)
+{
+	RecentForms.Remove(Form);
+	RecentForms.Insert(Form, 0);
+}
+
+void AShapeShiftManager::UpdateFormStats() const
+{
+	int32 NumResident = 0;
+	int64 ResidentSize = 0;
+	for (int32 Form = 0; Form < SSForm_MAX; Form++)
+	{
+		NumResident += FormHandles[Form].IsValid() && FormHandles[Form]->HasLoadCompleted();
+		ResidentSize += FormSizes[Form];
+	}
+
+	SET_DWORD_STAT(STAT_ResidentForms, NumResident);
+	SET_FLOAT_STAT(STAT_ResidentFormsMB, ResidentSize / (1024.f * 1024.f));
+}
@@ -4,6 +4,7 @@
 #include "ShapeShiftMenu.h"
 
 #include "DruidControllerCharacter.h"
+#include "ShapeShiftManager.h"
 #include "Kismet/GameplayStatics.h"
 
 void UShapeShiftMenu::NativeConstruct()
@@ -14,15 +15,19 @@ void UShapeShiftMenu::NativeConstruct()
 }
 
 
-void UShapeShiftMenu::Show()
+void UShapeShiftMenu::Show(EShapeShiftMenuMode InMode)
 {
-	SetVisibility(ESlateVisibility::Visible);
+	Mode = InMode;
+	SetHighlightedForm(SSForm_MAX);
+
+	// Radial, the hidden cursor must not hover the buttons
+	SetVisibility(Mode == SSMenu_Radial ? ESlateVisibility::HitTestInvisible : ESlateVisibility::Visible);
 
 	APlayerController *Controller = Cast<APlayerController>(GetOwningPlayer());
-	
+
 	if (Controller)
 	{
-		Controller->SetShowMouseCursor(true);
+		Controller->SetShowMouseCursor(Mode == SSMenu_Cursor);
 	}
 }
 
@@ -43,3 +48,79 @@ void UShapeShiftMenu::ChooseShapeShiftForm(EShapeShiftForm form)
 		}
 	}
 }
+
+void UShapeShiftMenu::CancelShapeShiftForm()
+{
+	SetVisibility(ESlateVisibility::Hidden);
+
+	APlayerController *Controller = Cast<APlayerController>(GetOwningPlayer());
+
+	if (Controller)
+	{
+		Controller->SetShowMouseCursor(false);
+
+		ADruidControllerCharacter *Character = Controller->GetPawn<ADruidControllerCharacter>();
+		if (Character)
+		{
+			Character->CancelShapeShifting();
+		}
+	}
+}
+
+void UShapeShiftMenu::PreviewShapeShiftForm(EShapeShiftForm form)
+{
+	ADruidControllerCharacter *Character = GetOwningPlayerPawn<ADruidControllerCharacter>();
+	if (Character)
+	{
+		Character->GetShapeShiftManager()->PreloadForm(form);
+	}
+}
+
+///////////////////
+/// RADIAL
+
+void UShapeShiftMenu::SelectDirection(const FVector2D& Direction)
+{
+	if (Mode != SSMenu_Radial || !IsVisible() || Direction.SizeSquared() < FMath::Square(RadialDeadZone))
+		return;
+
+	constexpr int32 NumForms = SSForm_MAX - SSForm_Druid - 1;
+	constexpr float SectorAngle = UE_TWO_PI / NumForms;
+
+	// Clockwise from up, the first sector centered on it
+	float Angle = FMath::Atan2(Direction.X, Direction.Y);
+	if (Angle < 0)
+		Angle += UE_TWO_PI;
+	const int32 Sector = FMath::FloorToInt((Angle + SectorAngle / 2) / SectorAngle) % NumForms;
+
+	SetHighlightedForm(static_cast<EShapeShiftForm>(SSForm_Druid + 1 + Sector));
+}
+
+bool UShapeShiftMenu::ConfirmSelection()
+{
+	if (Mode != SSMenu_Radial || !IsVisible())
+		return false;
+
+	// Released without pointing at a form
+	if (HighlightedForm == SSForm_MAX)
+	{
+		CancelShapeShiftForm();
+		return false;
+	}
+
+	ChooseShapeShiftForm(HighlightedForm);
+	return true;
+}
+
+void UShapeShiftMenu::SetHighlightedForm(EShapeShiftForm form)
+{
+	if (HighlightedForm == form)
+		return;
+
+	HighlightedForm = form;
+	OnFormHighlighted(form);
+
+	// Streams while the stick still points at it
+	if (form != SSForm_MAX)
+		PreviewShapeShiftForm(form);
+}
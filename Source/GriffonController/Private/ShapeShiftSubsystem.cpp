@@ -0,0 +1,575 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ShapeShiftSubsystem.h"
+#include "GriffonController.h"
+#include "GriffonStats.h"
+#include "ShapeShiftForm.h"
+#include "Components/PrimitiveComponent.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "GameFramework/GameModeBase.h"
+#include "GameFramework/PawnMovementComponent.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Pooled Forms"), STAT_PooledForms, STATGROUP_Griffon);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Pooled Forms KB"), STAT_PooledFormsKB, STATGROUP_Griffon);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Dormant Forms"), STAT_DormantForms, STATGROUP_Griffon);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Possessed Forms"), STAT_PossessedForms, STATGROUP_Griffon);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Form Pool Misses"), STAT_FormPoolMisses, STATGROUP_Griffon);
+DECLARE_CYCLE_STAT(TEXT("ShapeShift Swap"), STAT_ShapeShiftSwap, STATGROUP_Griffon);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("ShapeShift Hitch Ms"), STAT_ShapeShiftHitchMs, STATGROUP_Griffon);
+
+namespace
+{
+	TAutoConsoleVariable<int32> CVarMaxPooledForms(
+		TEXT("griffon.ShapeShift.MaxPooledForms"), 16,
+		TEXT("Hidden forms kept in the pools of the world, all classes together."));
+
+	TAutoConsoleVariable<float> CVarPoolBudgetMB(
+		TEXT("griffon.ShapeShift.PoolBudgetMB"), 32,
+		TEXT("Memory of the hidden forms of the world, their components without the assets they share."));
+
+	TAutoConsoleVariable<float> CVarPoolWindow(
+		TEXT("griffon.ShapeShift.PoolWindow"), 30,
+		TEXT("Seconds the peak demand of a class is observed over before the pool is sized to it."));
+
+	TAutoConsoleVariable<int32> CVarDormancy(
+		TEXT("griffon.ShapeShift.Dormancy"), 1,
+		TEXT("Unregister the components of pooled forms instead of only hiding them.\n")
+		TEXT("Compare both with griffon.ShapeShift.DumpForms and the Pooled Forms KB stat."));
+
+	FAutoConsoleCommandWithWorld DumpFormsCommand(
+		TEXT("griffon.ShapeShift.DumpForms"),
+		TEXT("Log the components, scene proxies, physics bodies and memory of every form of the world."),
+		FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld *World)
+		{
+			int32 NumProxies = 0, NumBodies = 0;
+			int64 Size = 0;
+
+			for (TActorIterator<AShapeShiftForm> It(World); It; ++It)
+			{
+				int32 FormRegistered = 0, FormProxies = 0, FormBodies = 0;
+				int64 FormSize = It->GetResourceSizeBytes(EResourceSizeMode::Exclusive);
+
+				TInlineComponentArray<UActorComponent *> Components(*It);
+				for (const UActorComponent *Component : Components)
+				{
+					FormRegistered += Component->IsRegistered();
+					FormSize += Component->GetResourceSizeBytes(EResourceSizeMode::Exclusive);
+
+					if (const UPrimitiveComponent *Primitive = Cast<UPrimitiveComponent>(Component))
+					{
+						FormProxies += Primitive->SceneProxy != nullptr;
+						FormBodies += Primitive->IsPhysicsStateCreated();
+					}
+				}
+
+				const TCHAR *State = It->GetController() ? TEXT("possessed") : It->IsDormant() ? TEXT("dormant") : TEXT("hidden");
+				UE_LOG(LogGriffon, Display, TEXT("%s (%s): %d/%d components registered, %d scene proxies, %d physics bodies, %.1fKB"),
+					*It->GetName(), State, FormRegistered, Components.Num(), FormProxies, FormBodies, FormSize / 1024.f);
+
+				NumProxies += FormProxies;
+				NumBodies += FormBodies;
+				Size += FormSize;
+			}
+
+			UE_LOG(LogGriffon, Display, TEXT("Forms: %d scene proxies, %d physics bodies, %.1fKB"), NumProxies, NumBodies, Size / 1024.f);
+		}));
+
+	TAutoConsoleVariable<float> CVarHitchMs(
+		TEXT("griffon.ShapeShift.HitchMs"), 4,
+		TEXT("A frame this much over the median around a shapeshift is reported as a warning."));
+}
+
+///////////////////
+/// HITCH PROBE
+
+void FShapeShiftHitchProbe::AddFrame(float FrameMs)
+{
+	if (FramesSinceShift == INDEX_NONE)
+	{
+		FramesMs[NumFrames++ % NumFramesBefore] = FrameMs;
+		return;
+	}
+
+	WorstMs = FMath::Max(WorstMs, FrameMs);
+
+	if (++FramesSinceShift == NumFramesAfter)
+	{
+		Report();
+		FramesSinceShift = INDEX_NONE;
+	}
+}
+
+void FShapeShiftHitchProbe::BeginShift(float InSwapMs, int32 InPreparedFrames)
+{
+	// An other controller shifted in the window, reported together
+	if (FramesSinceShift != INDEX_NONE)
+	{
+		SwapMs = FMath::Max(SwapMs, InSwapMs);
+		PreparedFrames = FMath::Min(PreparedFrames, InPreparedFrames);
+		FramesSinceShift = 0;
+		return;
+	}
+
+	TArray<float, TInlineAllocator<NumFramesBefore>> Sorted(FramesMs, FMath::Min(NumFrames, NumFramesBefore));
+	Sorted.Sort();
+	BaselineMs = Sorted.IsEmpty() ? 0 : Sorted[Sorted.Num() / 2];
+
+	WorstMs = 0;
+	SwapMs = InSwapMs;
+	PreparedFrames = InPreparedFrames;
+	FramesSinceShift = 0;
+}
+
+void FShapeShiftHitchProbe::Report() const
+{
+	const float HitchMs = FMath::Max(WorstMs - BaselineMs, 0.f);
+	SET_FLOAT_STAT(STAT_ShapeShiftHitchMs, HitchMs);
+
+	if (HitchMs > CVarHitchMs.GetValueOnGameThread())
+	{
+		UE_LOG(LogGriffon, Warning, TEXT("ShapeShift hitch: worst frame %.1fms for a %.1fms median, swap %.2fms prepared over %d frames"),
+			WorstMs, BaselineMs, SwapMs, PreparedFrames);
+	}
+	else
+	{
+		UE_LOG(LogGriffon, Log, TEXT("ShapeShift: worst frame %.1fms for a %.1fms median, swap %.2fms prepared over %d frames"),
+			WorstMs, BaselineMs, SwapMs, PreparedFrames);
+	}
+}
+
+///////////////////
+/// SUBSYSTEM
+
+void UShapeShiftSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	LogoutHandle = FGameModeEvents::GameModeLogoutEvent.AddUObject(this, &UShapeShiftSubsystem::OnLogout);
+}
+
+void UShapeShiftSubsystem::Deinitialize()
+{
+	FGameModeEvents::GameModeLogoutEvent.Remove(LogoutHandle);
+
+	PreparedForms.Reset();
+	Pools.Reset();
+
+	Super::Deinitialize();
+}
+
+void UShapeShiftSubsystem::Tick(float DeltaTime)
+{
+	// Wall clock, the delta time is the same every frame with a fixed step
+	const double Now = FPlatformTime::Seconds();
+	if (LastFrameTime > 0)
+		HitchProbe.AddFrame((Now - LastFrameTime) * 1000);
+	LastFrameTime = Now;
+
+	for (const TWeakObjectPtr<AShapeShiftForm>& Form : SettlingForms)
+	{
+		if (Form.IsValid())
+			SettleForm(Form.Get());
+	}
+	SettlingForms.Reset();
+
+	// One step a frame for each controller
+	for (auto It = PreparedForms.CreateIterator(); It; ++It)
+	{
+		if (AController *Controller = It.Key().Get())
+		{
+			AdvancePreparation(Controller, It.Value());
+			continue;
+		}
+
+		CancelPreparation(It.Value());
+		It.RemoveCurrent();
+	}
+
+	WindowTime += DeltaTime;
+	const bool bWindowEnd = WindowTime >= CVarPoolWindow.GetValueOnGameThread();
+	if (bWindowEnd)
+		WindowTime = 0;
+
+	int32 NumPossessed = 0;
+	int32 NumDormant = 0;
+	for (TPair<UClass *, FShapeShiftFormPool>& Pair : Pools)
+	{
+		FShapeShiftFormPool& Pool = Pair.Value;
+
+		if (bWindowEnd)
+		{
+			Pool.Demand = FMath::Max(static_cast<float>(Pool.PeakActive), Pool.Demand * 0.5f);
+			Pool.PeakActive = Pool.NumActive;
+		}
+
+		// Ready for as many controllers as the class had lately, one spawn or destroy a frame
+		const int32 Wanted = FMath::Max(FMath::CeilToInt(Pool.Demand) - Pool.NumActive, Pool.MinFree);
+		if (Pool.Free.Num() > Wanted)
+			DestroyPooledForm(Pool);
+		else if (Pool.Free.Num() < Wanted && CanPool(Pool))
+			AddPooledForm(Pool, SpawnPooledForm(Pair.Key));
+
+		NumPossessed += Pool.NumActive;
+		for (const AShapeShiftForm *Form : Pool.Free)
+		{
+			NumDormant += IsValid(Form) && Form->IsDormant();
+		}
+	}
+
+	SET_DWORD_STAT(STAT_PooledForms, NumPooled);
+	SET_FLOAT_STAT(STAT_PooledFormsKB, PooledSize / 1024.f);
+	SET_DWORD_STAT(STAT_DormantForms, NumDormant);
+	SET_DWORD_STAT(STAT_PossessedForms, NumPossessed);
+}
+
+TStatId UShapeShiftSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UShapeShiftSubsystem, STATGROUP_Tickables);
+}
+
+void UShapeShiftSubsystem::PrepareForm(AController *Controller, UClass *FormClass)
+{
+	if (FPreparedForm *Prepared = PreparedForms.Find(Controller))
+	{
+		if (Prepared->FormClass == FormClass)
+			return;
+
+		CancelPreparation(*Prepared);
+	}
+
+	FPreparedForm Prepared;
+	Prepared.FormClass = FormClass;
+	PreparedForms.Add(Controller, Prepared);
+}
+
+AShapeShiftForm* UShapeShiftSubsystem::PossessForm(AController *Controller, UClass *FormClass, const FTransform& Transform)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ShapeShiftSwap);
+	const double StartTime = FPlatformTime::Seconds();
+
+	AShapeShiftForm *Form = nullptr;
+	int32 PreparedFrames = 0;
+
+	if (FPreparedForm *Prepared = PreparedForms.Find(Controller))
+	{
+		if (Prepared->FormClass == FormClass)
+		{
+			PreparedFrames = Prepared->NumFrames;
+
+			// The steps left are done now
+			while (AdvancePreparation(Controller, *Prepared)) {}
+
+			if (Prepared->Step == EPrepareStep::Ready)
+				Form = Prepared->Form.Get();
+		}
+
+		if (Form == nullptr)
+			CancelPreparation(*Prepared);
+
+		PreparedForms.Remove(Controller);
+	}
+
+	if (Form == nullptr)
+	{
+		Form = AcquireForm(FormClass, Pools.FindOrAdd(FormClass));
+		if (Form == nullptr)
+			return nullptr;
+
+		APlayerController *PlayerController = Cast<APlayerController>(Controller);
+		if (PlayerController && PlayerController->IsLocalController())
+			Form->PrebuildInput(PlayerController);
+	}
+
+	// Hidden first, the two capsules would push each other
+	FShapeShiftMovementState MovementState;
+	AShapeShiftForm *Previous = Cast<AShapeShiftForm>(Controller->GetPawn());
+	if (Previous)
+	{
+		Previous->SaveMovementState(MovementState);
+		SetFormActive(Previous, false);
+	}
+
+	Form->SetActorTransform(Transform, false, nullptr, ETeleportType::ResetPhysics);
+	SetFormActive(Form, true);
+
+	const FRotator RotationController = Controller->GetControlRotation();
+	Controller->Possess(Form);
+	Controller->SetControlRotation(RotationController);
+
+	// After the possession, Restart stopped the movement and set the default mode
+	Form->RestoreMovementState(MovementState);
+
+	if (Previous)
+		ReleaseForm(Previous);
+
+	HitchProbe.BeginShift((FPlatformTime::Seconds() - StartTime) * 1000, PreparedFrames);
+
+	return Form;
+}
+
+void UShapeShiftSubsystem::ReleaseForm(AShapeShiftForm *Form)
+{
+	if (AController *Controller = Form->GetController())
+		Controller->UnPossess();
+
+	SetFormActive(Form, false);
+
+	FShapeShiftFormPool& Pool = Pools.FindOrAdd(Form->GetClass());
+	Pool.NumActive = FMath::Max(Pool.NumActive - 1, 0);
+
+	if (!CanPool(Pool))
+	{
+		Form->Destroy();
+		return;
+	}
+
+	AddPooledForm(Pool, Form);
+}
+
+AShapeShiftForm* UShapeShiftSubsystem::PrewarmForm(UClass *FormClass)
+{
+	FShapeShiftFormPool& Pool = Pools.FindOrAdd(FormClass);
+	Pool.MinFree = FMath::Max(Pool.MinFree, 1);
+
+	if (!Pool.Free.IsEmpty())
+		return Pool.Free.Last();
+
+	if (!CanPool(Pool))
+		return nullptr;
+
+	AShapeShiftForm *Form = SpawnPooledForm(FormClass);
+	AddPooledForm(Pool, Form);
+
+	return Form;
+}
+
+void UShapeShiftSubsystem::FlushPool(UClass *FormClass)
+{
+	FShapeShiftFormPool *Pool = Pools.Find(FormClass);
+	if (Pool == nullptr)
+		return;
+
+	while (!Pool->Free.IsEmpty())
+	{
+		DestroyPooledForm(*Pool);
+	}
+
+	if (Pool->NumActive == 0)
+		Pools.Remove(FormClass);
+	else
+		Pool->MinFree = 0;
+}
+
+int32 UShapeShiftSubsystem::GetNumActive(UClass *FormClass) const
+{
+	const FShapeShiftFormPool *Pool = Pools.Find(FormClass);
+	return Pool ? Pool->NumActive : 0;
+}
+
+void UShapeShiftSubsystem::SetFormActive(ACharacter *Character, bool bActive)
+{
+	// Not prepared, registered on the swap frame
+	AShapeShiftForm *Form = Cast<AShapeShiftForm>(Character);
+	if (bActive && Form)
+		Form->ExitDormancy();
+
+	Character->SetActorHiddenInGame(!bActive);
+	Character->SetActorEnableCollision(bActive);
+	Character->SetActorTickEnabled(bActive);
+
+	if (bActive)
+		Character->GetMovementComponent()->Activate();
+	else
+		Character->GetMovementComponent()->Deactivate();
+}
+
+bool UShapeShiftSubsystem::AdvancePreparation(AController *Controller, FPreparedForm& Prepared)
+{
+	AShapeShiftForm *Form = Prepared.Form.Get();
+
+	switch (Prepared.Step)
+	{
+	case EPrepareStep::Acquire:
+		{
+			UClass *FormClass = Prepared.FormClass.Get();
+			if (FormClass == nullptr)
+				return false;
+
+			Prepared.Form = AcquireForm(FormClass, Pools.FindOrAdd(FormClass));
+			if (!Prepared.Form.IsValid())
+				return false;
+			break;
+		}
+
+	case EPrepareStep::Register:
+		{
+			// Render and physics state, the heaviest part
+			if (Form == nullptr)
+				return false;
+
+			Form->ExitDormancy();
+			break;
+		}
+
+	case EPrepareStep::Input:
+		{
+			// Remote players build it in PawnClientRestart
+			if (Form == nullptr)
+				return false;
+
+			APlayerController *PlayerController = Cast<APlayerController>(Controller);
+			if (PlayerController && PlayerController->IsLocalController())
+				Form->PrebuildInput(PlayerController);
+			break;
+		}
+
+	case EPrepareStep::Pose:
+		{
+			if (Form == nullptr)
+				return false;
+
+			// Still hidden and without collision, where it will be possessed
+			if (const APawn *Pawn = Controller->GetPawn())
+				Form->SetActorLocation(Pawn->GetActorLocation());
+
+			Form->GetMesh()->TickAnimation(0, false);
+			Form->GetMesh()->RefreshBoneTransforms();
+			break;
+		}
+
+	case EPrepareStep::Ready:
+		return false;
+	}
+
+	Prepared.Step = static_cast<EPrepareStep>(static_cast<uint8>(Prepared.Step) + 1);
+	Prepared.NumFrames++;
+	return true;
+}
+
+void UShapeShiftSubsystem::CancelPreparation(FPreparedForm& Prepared)
+{
+	if (Prepared.Step == EPrepareStep::Acquire)
+		return;
+
+	if (AShapeShiftForm *Form = Prepared.Form.Get())
+	{
+		ReleaseForm(Form);
+	}
+	else if (FShapeShiftFormPool *Pool = Pools.Find(Prepared.FormClass.Get()))
+	{
+		Pool->NumActive = FMath::Max(Pool->NumActive - 1, 0);
+	}
+
+	Prepared.Step = EPrepareStep::Acquire;
+	Prepared.Form.Reset();
+}
+
+AShapeShiftForm* UShapeShiftSubsystem::AcquireForm(UClass *FormClass, FShapeShiftFormPool& Pool)
+{
+	AShapeShiftForm *Form = nullptr;
+	if (!Pool.Free.IsEmpty())
+	{
+		Form = Pool.Free.Pop(false);
+		NumPooled--;
+		PooledSize -= Pool.FormSize;
+	}
+
+	// Destroyed with its level
+	if (!IsValid(Form))
+	{
+		INC_DWORD_STAT(STAT_FormPoolMisses);
+		Form = SpawnPooledForm(FormClass);
+		if (Form == nullptr)
+			return nullptr;
+	}
+
+	Pool.NumActive++;
+	Pool.PeakActive = FMath::Max(Pool.PeakActive, Pool.NumActive);
+
+	return Form;
+}
+
+AShapeShiftForm* UShapeShiftSubsystem::SpawnPooledForm(UClass *FormClass)
+{
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	AShapeShiftForm *Form = GetWorld()->SpawnActor<AShapeShiftForm>(FormClass, FTransform::Identity, SpawnParameters);
+	if (Form == nullptr)
+		return nullptr;
+
+	SetFormActive(Form, false);
+
+	return Form;
+}
+
+void UShapeShiftSubsystem::AddPooledForm(FShapeShiftFormPool& Pool, AShapeShiftForm *Form)
+{
+	if (Form == nullptr)
+		return;
+
+	Pool.Free.Add(Form);
+	NumPooled++;
+	PooledSize += Pool.FormSize;
+
+	SettlingForms.Add(Form);
+}
+
+void UShapeShiftSubsystem::SettleForm(AShapeShiftForm *Form)
+{
+	// Taken again in the same frame
+	FShapeShiftFormPool *Pool = Pools.Find(Form->GetClass());
+	if (Pool == nullptr || !Pool->Free.Contains(Form))
+		return;
+
+	if (CVarDormancy.GetValueOnGameThread() != 0)
+		Form->EnterDormancy();
+
+	// What it costs on its own, the meshes and textures are there for the possessed forms anyway
+	int64 Size = Form->GetResourceSizeBytes(EResourceSizeMode::Exclusive);
+	TInlineComponentArray<UActorComponent *> Components(Form);
+	for (const UActorComponent *Component : Components)
+	{
+		Size += Component->GetResourceSizeBytes(EResourceSizeMode::Exclusive);
+	}
+
+	PooledSize += (Size - Pool->FormSize) * Pool->Free.Num();
+	Pool->FormSize = Size;
+}
+
+void UShapeShiftSubsystem::DestroyPooledForm(FShapeShiftFormPool& Pool)
+{
+	AShapeShiftForm *Form = Pool.Free.Pop(false);
+	NumPooled--;
+	PooledSize -= Pool.FormSize;
+
+	if (IsValid(Form))
+		Form->Destroy();
+}
+
+bool UShapeShiftSubsystem::CanPool(const FShapeShiftFormPool& Pool) const
+{
+	const int64 Budget = static_cast<int64>(CVarPoolBudgetMB.GetValueOnGameThread() * 1024 * 1024);
+	return NumPooled < CVarMaxPooledForms.GetValueOnGameThread() && PooledSize + Pool.FormSize <= Budget;
+}
+
+void UShapeShiftSubsystem::OnLogout(AGameModeBase *GameMode, AController *Controller)
+{
+	if (GameMode->GetWorld() != GetWorld())
+		return;
+
+	if (FPreparedForm *Prepared = PreparedForms.Find(Controller))
+	{
+		CancelPreparation(*Prepared);
+		PreparedForms.Remove(Controller);
+	}
+
+	// Back to the pool before the controller destroys its pawn
+	if (AShapeShiftForm *Form = Cast<AShapeShiftForm>(Controller->GetPawn()))
+		ReleaseForm(Form);
+}
@@ -2,8 +2,137 @@
 
 #include "WerewolfCharacterMoveComponent.h"
 
+#include "ClimbSurfaceCacheSubsystem.h"
+#include "ClimbSurfaceGraph.h"
+#include "ClimbSurfaceGraphSubsystem.h"
+#include "GriffonDebug.h"
+#include "GriffonStats.h"
+#include "Camera/PlayerCameraManager.h"
 #include "Components/CapsuleComponent.h"
 #include "GameFramework/Character.h"
+#include "GameFramework/PlayerController.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Wall Sweeps"), STAT_WerewolfWallSweeps, STATGROUP_Griffon);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Wall Sweeps Reused"), STAT_WerewolfWallSweepsReused, STATGROUP_Griffon);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Wall Sweeps Skipped"), STAT_WerewolfWallSweepsSkipped, STATGROUP_Griffon);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Wall Sweeps Per Second"), STAT_WerewolfWallSweepsPerSecond, STATGROUP_Griffon);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Surface Sweeps"), STAT_WerewolfSurfaceSweeps, STATGROUP_Griffon);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Surface Probes Async"), STAT_WerewolfSurfaceProbes, STATGROUP_Griffon);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Surface Probes Fallbacks"), STAT_WerewolfSurfaceProbeFallbacks, STATGROUP_Griffon);
+DECLARE_CYCLE_STAT(TEXT("Ledge Check"), STAT_WerewolfLedgeCheck, STATGROUP_Griffon);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Ledge Checks Reused"), STAT_WerewolfLedgeChecksReused, STATGROUP_Griffon);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Climbers Full"), STAT_WerewolfClimbersFull, STATGROUP_Griffon);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Climbers Reduced"), STAT_WerewolfClimbersReduced, STATGROUP_Griffon);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Climbers Minimal"), STAT_WerewolfClimbersMinimal, STATGROUP_Griffon);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Climb Corrections"), STAT_WerewolfClimbCorrections, STATGROUP_Griffon);
+
+namespace
+{
+	/** Geometry spawned in the radius is found at the latest after this (s) */
+	constexpr float WallBroadphaseMaxAge = 1.f;
+
+	constexpr float SurfaceProbeRadius = 6;
+	constexpr float SurfaceProbeLength = 120;
+
+	/** Room reserved in the arrays the tick reuses, the climbing tick doesn't allocate once they are warm */
+	constexpr int32 ReservedWallHits = 16;
+	constexpr int32 ReservedWallGeometry = 32;
+
+	/** Baked ledges over about 45 degrees from the climbed wall belong to another wall */
+	constexpr float GraphLedgeMinFacing = 0.7f;
+
+	/** Not rendered for this long, the werewolf is unseen (s) */
+	constexpr float ClimbLODRenderTolerance = 0.5f;
+
+	TAutoConsoleVariable<int32> CVarClimbLOD(
+		TEXT("griffon.Climb.LOD"), -1,
+		TEXT("Force the climbing LOD of every werewolf, 0 Full, 1 Reduced, 2 Minimal. -1 picks it by controller and distance."),
+		ECVF_Cheat);
+}
+
+///////////////////
+/// SAVED MOVE
+
+void FSavedMove_Werewolf::Clear()
+{
+	Super::Clear();
+
+	bSavedWantsToClimb = false;
+}
+
+uint8 FSavedMove_Werewolf::GetCompressedFlags() const
+{
+	uint8 Flags = Super::GetCompressedFlags();
+
+	if (bSavedWantsToClimb)
+		Flags |= FLAG_WantsToClimb;
+
+	return Flags;
+}
+
+void FSavedMove_Werewolf::SetMoveFor(ACharacter *Character, float InDeltaTime, FVector const& NewAccel,
+	FNetworkPredictionData_Client_Character& ClientData)
+{
+	Super::SetMoveFor(Character, InDeltaTime, NewAccel, ClientData);
+
+	bSavedWantsToClimb = CastChecked<UWerewolfCharacterMoveComponent>(Character->GetCharacterMovement())->bWantsToClimb;
+}
+
+FSavedMovePtr FNetworkPredictionData_Client_Werewolf::AllocateNewMove()
+{
+	return FSavedMovePtr(new FSavedMove_Werewolf());
+}
+
+///////////////////
+/// MOVE RESPONSE
+
+void FWerewolfMoveResponseDataContainer::ServerFillResponseData(const UCharacterMovementComponent& CharacterMovement,
+	const FClientAdjustment& PendingAdjustment)
+{
+	Super::ServerFillResponseData(CharacterMovement, PendingAdjustment);
+
+	const UWerewolfCharacterMoveComponent& Movement = static_cast<const UWerewolfCharacterMoveComponent&>(CharacterMovement);
+	bClimbing = Movement.IsClimbing();
+	if (!bClimbing)
+		return;
+
+	const FVector PositionOffset = Movement.CurrentClimbingPosition - Movement.UpdatedComponent->GetComponentLocation();
+
+	for (int32 Axis = 0; Axis < 3; Axis++)
+	{
+		QuantizedNormal[Axis] = UWerewolfCharacterMoveComponent::QuantizeNormalComponent(Movement.CurrentClimbingNormal[Axis]);
+		QuantizedPositionOffset[Axis] = int16(FMath::RoundToInt(FMath::Clamp(PositionOffset[Axis] * 10, double(-MAX_int16), double(MAX_int16))));
+	}
+}
+
+bool FWerewolfMoveResponseDataContainer::Serialize(UCharacterMovementComponent& CharacterMovement, FArchive& Ar,
+	UPackageMap *PackageMap)
+{
+	if (!Super::Serialize(CharacterMovement, Ar, PackageMap))
+		return false;
+
+	// Acks don't need it, nor the corrections of a walking werewolf
+	if (IsCorrection())
+	{
+		Ar.SerializeBits(&bClimbing, 1);
+
+		if (bClimbing)
+		{
+			for (int32 Axis = 0; Axis < 3; Axis++)
+				Ar << QuantizedNormal[Axis] << QuantizedPositionOffset[Axis];
+		}
+	}
+
+	return !Ar.IsError();
+}
+
+///////////////////
+/// COMPONENT
+
+UWerewolfCharacterMoveComponent::UWerewolfCharacterMoveComponent()
+{
+	SetMoveResponseDataContainer(WerewolfMoveResponseData);
+}
 
 void UWerewolfCharacterMoveComponent::BeginPlay()
 {
@@ -11,25 +140,44 @@ void UWerewolfCharacterMoveComponent::BeginPlay()
 
 	ClimbQueryParams.AddIgnoredActor(GetOwner());
 	AnimInstance = GetCharacterOwner()->GetMesh()->GetAnimInstance();
+	SurfaceCache = GetWorld()->GetSubsystem<UClimbSurfaceCacheSubsystem>();
+	SurfaceGraph = GetWorld()->GetSubsystem<UClimbSurfaceGraphSubsystem>();
+
+	CurrentWallHits.Reserve(ReservedWallHits);
+	SurfaceProbes.Reserve(ReservedWallHits);
+	BroadphaseOverlaps.Reserve(ReservedWallGeometry);
+	WallGeometry.Reserve(ReservedWallGeometry);
 }
 
 void UWerewolfCharacterMoveComponent::TickComponent(float DeltaTime, ELevelTick TickType,
 													  FActorComponentTickFunction* ThisTickFunction)
 {
+	UpdateClimbLOD();
+
 	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
 
-	SweepAndStoreWallHits();
+	UpdateWallHits();
+
+	WallSweepWindow += DeltaTime;
+	if (WallSweepWindow >= 1.f)
+	{
+		WallSweepsPerSecond = WallSweepsInWindow / WallSweepWindow;
+		WallSweepsInWindow = 0;
+		WallSweepWindow = 0;
+	}
+
+	INC_FLOAT_STAT_BY(STAT_WerewolfWallSweepsPerSecond, WallSweepsPerSecond);
 }
 
-void UWerewolfCharacterMoveComponent::OnMovementUpdated(float DeltaSeconds, const FVector& OldLocation,
-	const FVector& OldVelocity)
+void UWerewolfCharacterMoveComponent::UpdateCharacterStateBeforeMovement(float DeltaSeconds)
 {
-	Super::OnMovementUpdated(DeltaSeconds, OldLocation, OldVelocity);
-
-	if (bWantsToClimb)
+	// Same on the client and on the server, bWantsToClimb coming from the flags there
+	if (bWantsToClimb && !IsClimbing())
 	{
 		SetMovementMode(EMovementMode::MOVE_Custom, ECustomMovementMode::CMOVE_Climbing);
 	}
+
+	Super::UpdateCharacterStateBeforeMovement(DeltaSeconds);
 }
 
 ///////////////////
@@ -45,18 +193,140 @@ void UWerewolfCharacterMoveComponent::SweepAndStoreWallHits()
 	const FVector Start = UpdatedComponent->GetComponentLocation() + StartOffset;
 	const FVector End = Start + UpdatedComponent->GetForwardVector();
 
-	TArray<FHitResult> Hits;
-	const bool HitWall = GetWorld()->SweepMultiByChannel(Hits, Start, End, FQuat::Identity,
+	// Straight in the stored hits, their allocation is kept from one sweep to the next
+	const bool HitWall = GetWorld()->SweepMultiByChannel(CurrentWallHits, Start, End, FQuat::Identity,
 		  ECC_WorldStatic, CollisionShape, ClimbQueryParams);
 
-	if (IsDebug == true && GEngine)
+	INC_DWORD_STAT(STAT_WerewolfWallSweeps);
+	WallSweepsInWindow++;
+
+	if (IsDebug == true && GRIFFON_DEBUG_ENABLED(Climb))
 	{
 		DrawDebugCapsule(GetWorld(), End, CollisionCapsuleHalfHeight, CollisionCapsuleRadius, FQuat::Identity, FColor::Silver);
-		for (FHitResult Hit : Hits)
-			DrawDebugSphere(GetWorld(), Hit.ImpactPoint, 8, 32, FColor::Blue);
+		for (const FHitResult& Hit : CurrentWallHits)
+			DrawDebugSphere(GetWorld(), Hit.ImpactPoint, 8, 8, FColor::Blue);
+	}
+
+	if (!HitWall)
+		CurrentWallHits.Reset();
+}
+
+///////////////////
+/// WALL SWEEP CACHE
+
+void UWerewolfCharacterMoveComponent::UpdateWallHits()
+{
+	if (IsClimbing() || bWantsToClimb)
+		LastClimbIntentTime = GetWorld()->GetTimeSeconds();
+
+	// Walking around, nothing reads the hits
+	if (!HasClimbIntent())
+	{
+		CurrentWallHits.Reset();
+		bWallHitsValid = false;
+		return;
+	}
+
+	const FVector Location = UpdatedComponent->GetComponentLocation();
+	const FVector Forward = UpdatedComponent->GetForwardVector();
+
+	if (UpdateWallBroadphase(Location))
+		bWallHitsValid = false;
+
+	if (WallGeometry.IsEmpty())
+	{
+		INC_DWORD_STAT(STAT_WerewolfWallSweepsSkipped);
+		CurrentWallHits.Reset();
+		bWallHitsValid = false;
+		return;
 	}
 
-	HitWall ? CurrentWallHits = Hits : CurrentWallHits.Reset();
+	// Same geometry, nearly the same capsule, same hits
+	const bool bMoved = FVector::DistSquared(Location, LastSweepLocation) > FMath::Square(WallSweepReuseDistance)
+		|| FVector::DotProduct(Forward, LastSweepForward) < FMath::Cos(FMath::DegreesToRadians(WallSweepReuseDegrees));
+
+	// Lower LODs keep them between the frames they sweep
+	if (bWallHitsValid && (!bMoved || !IsClimbLODFrame(GetClimbLODSettings().WallSweepInterval)))
+	{
+		INC_DWORD_STAT(STAT_WerewolfWallSweepsReused);
+		return;
+	}
+
+	SweepAndStoreWallHits();
+
+	LastSweepLocation = Location;
+	LastSweepForward = Forward;
+	bWallHitsValid = true;
+}
+
+bool UWerewolfCharacterMoveComponent::HasClimbIntent() const
+{
+	return GetWorld()->GetTimeSeconds() - LastClimbIntentTime <= WallSweepIntentLinger;
+}
+
+bool UWerewolfCharacterMoveComponent::UpdateWallBroadphase(const FVector& Location)
+{
+	const float Now = GetWorld()->GetTimeSeconds();
+
+	// The sphere holds every sweep until the capsule got this close to its border
+	const float SweepReach = CollisionCapsuleRadius + CollisionCapsuleHalfHeight + 21;
+	const float Slack = FMath::Max(WallBroadphaseRadius - SweepReach, 0.f);
+
+	const bool bGeometryMoved = HasWallGeometryMoved();
+
+	if (bBroadphaseValid && !bGeometryMoved
+		&& FVector::DistSquared(Location, BroadphaseCenter) <= FMath::Square(Slack)
+		&& Now - BroadphaseTime < WallBroadphaseMaxAge)
+	{
+		return false;
+	}
+
+	GetWorld()->OverlapMultiByChannel(BroadphaseOverlaps, Location, FQuat::Identity, ECC_WorldStatic,
+		FCollisionShape::MakeSphere(WallBroadphaseRadius), ClimbQueryParams);
+
+	// Only what blocks the sweep can be climbed
+	bool bChanged = bGeometryMoved || !bBroadphaseValid;
+	int32 NumGeometry = 0;
+
+	for (const FOverlapResult& Overlap : BroadphaseOverlaps)
+	{
+		const UPrimitiveComponent *Component = Overlap.GetComponent();
+		if (!Overlap.bBlockingHit || Component == nullptr)
+			continue;
+
+		if (!WallGeometry.IsValidIndex(NumGeometry) || WallGeometry[NumGeometry].Component.Get() != Component)
+		{
+			if (!WallGeometry.IsValidIndex(NumGeometry))
+				WallGeometry.AddDefaulted();
+
+			WallGeometry[NumGeometry].Component = Component;
+			bChanged = true;
+		}
+
+		WallGeometry[NumGeometry].Transform = Component->GetComponentTransform();
+		NumGeometry++;
+	}
+
+	bChanged |= NumGeometry != WallGeometry.Num();
+	WallGeometry.SetNum(NumGeometry, false);
+
+	BroadphaseCenter = Location;
+	BroadphaseTime = Now;
+	bBroadphaseValid = true;
+
+	return bChanged;
+}
+
+bool UWerewolfCharacterMoveComponent::HasWallGeometryMoved() const
+{
+	for (const FWallGeometry& Geometry : WallGeometry)
+	{
+		const UPrimitiveComponent *Component = Geometry.Component.Get();
+		if (Component == nullptr || !Component->GetComponentTransform().Equals(Geometry.Transform))
+			return true;
+	}
+
+	return false;
 }
 
 bool UWerewolfCharacterMoveComponent::CanStartClimbing()
@@ -101,7 +371,7 @@ bool UWerewolfCharacterMoveComponent::EyeHeightTrace(const float TraceDistance)
 			(UpdatedComponent->GetUpVector() * EyeHeightOffset);
 	const FVector End = Start + (UpdatedComponent->GetForwardVector() * TraceDistance);
 
-	if (IsDebug == true && GEngine)
+	if (IsDebug == true && GRIFFON_DEBUG_ENABLED(Climb))
 	{
 		DrawDebugLine(GetWorld(), Start, End, FColor::Orange, false, -1, 0, 5);
 	}
@@ -114,6 +384,10 @@ bool UWerewolfCharacterMoveComponent::EyeHeightTrace(const float TraceDistance)
 
 void UWerewolfCharacterMoveComponent::TryClimbing()
 {
+	// Walls are not swept without an intent, this one starts now
+	LastClimbIntentTime = GetWorld()->GetTimeSeconds();
+	UpdateWallHits();
+
 	if (CanStartClimbing())
 	{
 		bWantsToClimb = true;
@@ -186,6 +460,8 @@ void UWerewolfCharacterMoveComponent::PhysClimbing(float deltaTime, int32 Iterat
 		return;
 	}
 
+	// Hits of this move location, the server and the replays don't have the ones of the last tick
+	UpdateWallHits();
 	ComputeSurfaceInfo();
 
 	if (ShouldStopClimbing())
@@ -207,10 +483,67 @@ void UWerewolfCharacterMoveComponent::PhysClimbing(float deltaTime, int32 Iterat
 		Velocity = (UpdatedComponent->GetComponentLocation() - OldLocation) / deltaTime;
 	}
 
-	SnapToClimbingSurface(deltaTime);
+	if (GetClimbLODSettings().bSnapToSurface)
+		SnapToClimbingSurface(deltaTime);
 }
 
 void UWerewolfCharacterMoveComponent::ComputeSurfaceInfo()
+{
+	// Replaying the moves of a climbing correction, the surface is the server one
+	if (bReplayOnServerSurface && bClientUpdating)
+		return;
+	bReplayOnServerSurface = false;
+
+	// Lower LODs keep the surface between the frames they compute it
+	if (!CurrentClimbingNormal.IsZero() && !IsClimbLODFrame(GetClimbLODSettings().SurfaceInterval))
+		return;
+
+	const FVector Location = UpdatedComponent->GetComponentLocation();
+	const FVector Forward = UpdatedComponent->GetForwardVector();
+
+	const bool bUseCache = bCacheSurfaceInfo && SurfaceCache != nullptr && !CurrentWallHits.IsEmpty();
+
+	if (bUseCache && SurfaceCache->FindSurface(Location, Forward, CurrentClimbingPosition, CurrentClimbingNormal))
+		return;
+
+	bSurfaceResolved = false;
+	ResolveSurfaceInfo();
+
+	CurrentClimbingNormal = QuantizeClimbingNormal(CurrentClimbingNormal);
+
+	if (bUseCache && bSurfaceResolved)
+		SurfaceCache->AddSurface(Location, Forward, CurrentClimbingPosition, CurrentClimbingNormal, SurfaceComponents);
+}
+
+void UWerewolfCharacterMoveComponent::ResolveSurfaceInfo()
+{
+	if (!bAsyncSurfaceProbes)
+	{
+		SweepSurfaceInfo();
+		return;
+	}
+
+	// Probes are read once a frame, the later substeps keep that surface
+	if (SurfaceProbeFrame == GFrameCounter)
+	{
+		if (!bSurfaceProbesConsumed)
+			SweepSurfaceInfo();
+		return;
+	}
+
+	bSurfaceProbesConsumed = ConsumeSurfaceProbes();
+	if (!bSurfaceProbesConsumed)
+	{
+		// Just started climbing, teleported, blocked... the probes were not sent from here
+		INC_DWORD_STAT(STAT_WerewolfSurfaceProbeFallbacks);
+		SweepSurfaceInfo();
+	}
+
+	IssueSurfaceProbes();
+	SurfaceProbeFrame = GFrameCounter;
+}
+
+void UWerewolfCharacterMoveComponent::SweepSurfaceInfo()
 {
 	CurrentClimbingNormal = FVector::ZeroVector;
 	CurrentClimbingPosition = FVector::ZeroVector;
@@ -227,11 +560,20 @@ void UWerewolfCharacterMoveComponent::ComputeSurfaceInfo()
 	// it give a way more precise surface detection
 	
 	const FVector Start = UpdatedComponent->GetComponentLocation();
-	const FCollisionShape CollisionSphere = FCollisionShape::MakeSphere(6);
+	const FCollisionShape CollisionSphere = FCollisionShape::MakeSphere(SurfaceProbeRadius);
+
+	const int32 Stride = GetAssistSweepStride();
+	const int32 NumSweeps = FMath::DivideAndRoundUp(CurrentWallHits.Num(), Stride);
+
+	INC_DWORD_STAT_BY(STAT_WerewolfSurfaceSweeps, NumSweeps);
 
-	for (const FHitResult& WallHit : CurrentWallHits)
+	SurfaceComponents.Reset();
+	bSurfaceResolved = true;
+
+	for (int32 HitIndex = 0; HitIndex < CurrentWallHits.Num(); HitIndex += Stride)
 	{
-		const FVector End = Start + (WallHit.ImpactPoint - Start).GetSafeNormal() * 120;
+		const FHitResult& WallHit = CurrentWallHits[HitIndex];
+		const FVector End = Start + (WallHit.ImpactPoint - Start).GetSafeNormal() * SurfaceProbeLength;
 
 		FHitResult AssistHit;
 		GetWorld()->SweepSingleByChannel(AssistHit, Start, End, FQuat::Identity,
@@ -239,12 +581,99 @@ void UWerewolfCharacterMoveComponent::ComputeSurfaceInfo()
 
 		CurrentClimbingPosition += AssistHit.ImpactPoint;
 		CurrentClimbingNormal += AssistHit.Normal;
+
+		AddSurfaceComponent(AssistHit);
 	}
 
-	CurrentClimbingPosition /= CurrentWallHits.Num();
+	CurrentClimbingPosition /= NumSweeps;
 	CurrentClimbingNormal = CurrentClimbingNormal.GetSafeNormal();
 }
 
+///////////////////
+/// ASYNC SURFACE PROBES
+
+bool UWerewolfCharacterMoveComponent::ConsumeSurfaceProbes()
+{
+	if (SurfaceProbes.IsEmpty())
+		return false;
+
+	const FVector Location = UpdatedComponent->GetComponentLocation();
+	if (FVector::DistSquared(Location, SurfaceProbeLocation) > FMath::Square(SurfaceProbeMaxError))
+		return false;
+
+	FVector Position = FVector::ZeroVector;
+	FVector Normal = FVector::ZeroVector;
+
+	SurfaceComponents.Reset();
+	bSurfaceResolved = true;
+
+	for (const FTraceHandle& Probe : SurfaceProbes)
+	{
+		// Only valid the frame after they were sent
+		if (!GetWorld()->QueryTraceData(Probe, SurfaceProbeDatum))
+		{
+			bSurfaceResolved = false;
+			return false;
+		}
+
+		// Same sums as the synchronous sweeps, a miss counts as a zero hit
+		if (!SurfaceProbeDatum.OutHits.IsEmpty())
+		{
+			Position += SurfaceProbeDatum.OutHits[0].ImpactPoint;
+			Normal += SurfaceProbeDatum.OutHits[0].Normal;
+			AddSurfaceComponent(SurfaceProbeDatum.OutHits[0]);
+		} else
+		{
+			bSurfaceResolved = false;
+		}
+	}
+
+	CurrentClimbingPosition = Position / SurfaceProbes.Num();
+	CurrentClimbingNormal = Normal.GetSafeNormal();
+
+	return true;
+}
+
+void UWerewolfCharacterMoveComponent::IssueSurfaceProbes()
+{
+	SurfaceProbes.Reset();
+
+	// Where the werewolf should be when they are read
+	const FVector Start = UpdatedComponent->GetComponentLocation() + Velocity * GetWorld()->GetDeltaSeconds();
+	const FCollisionShape CollisionSphere = FCollisionShape::MakeSphere(SurfaceProbeRadius);
+
+	const int32 Stride = GetAssistSweepStride();
+
+	INC_DWORD_STAT_BY(STAT_WerewolfSurfaceProbes, FMath::DivideAndRoundUp(CurrentWallHits.Num(), Stride));
+
+	for (int32 HitIndex = 0; HitIndex < CurrentWallHits.Num(); HitIndex += Stride)
+	{
+		const FHitResult& WallHit = CurrentWallHits[HitIndex];
+		const FVector End = Start + (WallHit.ImpactPoint - Start).GetSafeNormal() * SurfaceProbeLength;
+
+		SurfaceProbes.Add(GetWorld()->AsyncSweepByChannel(EAsyncTraceType::Single, Start, End, FQuat::Identity,
+			ECC_WorldStatic, CollisionSphere, ClimbQueryParams));
+	}
+
+	SurfaceProbeLocation = Start;
+}
+
+///////////////////
+/// SURFACE CACHE
+
+void UWerewolfCharacterMoveComponent::AddSurfaceComponent(const FHitResult& Hit)
+{
+	// A miss or a moving platform, not a surface to keep
+	const UPrimitiveComponent *Component = Hit.GetComponent();
+	if (!Hit.bBlockingHit || Component == nullptr || Component->Mobility == EComponentMobility::Movable)
+	{
+		bSurfaceResolved = false;
+		return;
+	}
+
+	SurfaceComponents.Add(Component);
+}
+
 void UWerewolfCharacterMoveComponent::ComputeClimbingVelocity(float deltaTime)
 {
 	RestorePreAdditiveRootMotionVelocity();
@@ -301,6 +730,23 @@ void UWerewolfCharacterMoveComponent::SnapToClimbingSurface(float deltaTime) con
 	UpdatedComponent->MoveComponent(Offset * ClimbingSnapSpeed * deltaTime, Rotation, bSweep);
 }
 
+int16 UWerewolfCharacterMoveComponent::QuantizeNormalComponent(double Value)
+{
+	return int16(FMath::RoundToInt(FMath::Clamp(Value, -1.0, 1.0) * MAX_int16));
+}
+
+double UWerewolfCharacterMoveComponent::DequantizeNormalComponent(int16 Quantized)
+{
+	return double(Quantized) / MAX_int16;
+}
+
+FVector UWerewolfCharacterMoveComponent::QuantizeClimbingNormal(const FVector& Normal)
+{
+	return FVector(DequantizeNormalComponent(QuantizeNormalComponent(Normal.X)),
+		DequantizeNormalComponent(QuantizeNormalComponent(Normal.Y)),
+		DequantizeNormalComponent(QuantizeNormalComponent(Normal.Z)));
+}
+
 FQuat UWerewolfCharacterMoveComponent::GetClimbingRotation(float deltaTime) const
 {
 	const FQuat Current = UpdatedComponent->GetComponentQuat();
@@ -312,9 +758,91 @@ FQuat UWerewolfCharacterMoveComponent::GetClimbingRotation(float deltaTime) cons
 	
 	const FQuat Target = FRotationMatrix::MakeFromX(-CurrentClimbingNormal).ToQuat();
 
+	if (!GetClimbLODSettings().bInterpolateRotation)
+		return Target;
+
 	return FMath::QInterpTo(Current, Target, deltaTime, ClimbingRotationSpeed);
 }
 
+///////////////////
+/// CLIMBING LOD
+
+void UWerewolfCharacterMoveComponent::UpdateClimbLOD()
+{
+	if (!IsClimbing() && !HasClimbIntent())
+		return;
+
+	const int32 ForcedLOD = CVarClimbLOD.GetValueOnGameThread();
+	if (ForcedLOD >= 0)
+	{
+		ClimbLOD = static_cast<EClimbLOD>(FMath::Min(ForcedLOD, ClimbLOD_MAX - 1));
+	}
+	// Players see their own werewolf up close, and the server must move the remote ones as their client does
+	else if (CharacterOwner == nullptr || CharacterOwner->IsPlayerControlled())
+	{
+		ClimbLOD = ClimbLOD_Full;
+	}
+	else if (!CharacterOwner->WasRecentlyRendered(ClimbLODRenderTolerance))
+	{
+		ClimbLOD = ClimbLOD_Minimal;
+	}
+	else
+	{
+		// Closest player, the camera for the local ones and the pawn for the others
+		const FVector Location = UpdatedComponent->GetComponentLocation();
+		float ClosestDistSquared = MAX_flt;
+
+		for (FConstPlayerControllerIterator Iterator = GetWorld()->GetPlayerControllerIterator(); Iterator; ++Iterator)
+		{
+			const APlayerController *PlayerController = Iterator->Get();
+			if (PlayerController == nullptr)
+				continue;
+
+			FVector ViewLocation;
+			if (PlayerController->IsLocalController() && PlayerController->PlayerCameraManager != nullptr)
+				ViewLocation = PlayerController->PlayerCameraManager->GetCameraLocation();
+			else if (PlayerController->GetPawn() != nullptr)
+				ViewLocation = PlayerController->GetPawn()->GetActorLocation();
+			else
+				continue;
+
+			ClosestDistSquared = FMath::Min(ClosestDistSquared, FVector::DistSquared(Location, ViewLocation));
+		}
+
+		ClimbLOD = ClosestDistSquared <= FMath::Square(ClimbLODReducedDistance) ? ClimbLOD_Reduced : ClimbLOD_Minimal;
+	}
+
+	switch (ClimbLOD)
+	{
+	case ClimbLOD_Full:		INC_DWORD_STAT(STAT_WerewolfClimbersFull); break;
+	case ClimbLOD_Reduced:	INC_DWORD_STAT(STAT_WerewolfClimbersReduced); break;
+	default:				INC_DWORD_STAT(STAT_WerewolfClimbersMinimal); break;
+	}
+}
+
+const FClimbLODSettings& UWerewolfCharacterMoveComponent::GetClimbLODSettings() const
+{
+	switch (ClimbLOD)
+	{
+	case ClimbLOD_Reduced:	return ClimbLODReduced;
+	case ClimbLOD_Minimal:	return ClimbLODMinimal;
+	default:				return ClimbLODFull;
+	}
+}
+
+bool UWerewolfCharacterMoveComponent::IsClimbLODFrame(int32 Interval) const
+{
+	// Offset by the id, a crowd of werewolves doesn't sweep all on the same frame
+	return Interval <= 1 || (GFrameCounter + GetUniqueID()) % Interval == 0;
+}
+
+int32 UWerewolfCharacterMoveComponent::GetAssistSweepStride() const
+{
+	const int32 MaxAssistSweeps = GetClimbLODSettings().MaxAssistSweeps;
+
+	return MaxAssistSweeps > 0 ? FMath::Max(FMath::DivideAndRoundUp(CurrentWallHits.Num(), MaxAssistSweeps), 1) : 1;
+}
+
 ///////////////////
 /// CLIMBING PHYSICS VALUES
 
@@ -339,8 +867,14 @@ bool UWerewolfCharacterMoveComponent::TryClimbUpLedge() const
 	const float UpSpeed = FVector::DotProduct(Velocity, UpdatedComponent->GetUpVector());
 	const bool bIsMovingUp = UpSpeed >= MaxClimbingSpeed / 3;
 
-	if (bIsMovingUp && HasReachedEdge() && CanMoveToLedgeClimbLocation())
+	FVector MantleTarget;
+	if (bIsMovingUp && FindLedgeMantleTarget(MantleTarget))
 	{
+		if (IsDebug == true && GRIFFON_DEBUG_ENABLED(Climb))
+		{
+			DrawDebugSphere(GetWorld(), MantleTarget, 12, 8, FColor::Green, false, 2);
+		}
+
 		const FRotator StandRotation = FRotator(0, UpdatedComponent->GetComponentRotation().Yaw, 0);
 		UpdatedComponent->SetRelativeRotation(StandRotation);
 
@@ -354,18 +888,215 @@ bool UWerewolfCharacterMoveComponent::TryClimbUpLedge() const
 
 bool UWerewolfCharacterMoveComponent::HasReachedEdge() const
 {
-		const UCapsuleComponent* Capsule = CharacterOwner->GetCapsuleComponent();
-    	const float TraceDistance = Capsule->GetUnscaledCapsuleRadius() * 2.5;
-    
-    	return !EyeHeightTrace(TraceDistance);
+	return CheckLedge().bReachedEdge;
 }
 
 bool UWerewolfCharacterMoveComponent::IsLocationWalkable(const FVector& CheckLocation) const
 {
-	return true;
+	const float HalfHeight = CharacterOwner->GetCapsuleComponent()->GetScaledCapsuleHalfHeight();
+	const FVector Start = CheckLocation + FVector(0, 0, HalfHeight);
+	const FVector End = CheckLocation - FVector(0, 0, HalfHeight);
+
+	FHitResult FloorHit;
+	return GetWorld()->LineTraceSingleByChannel(FloorHit, Start, End, ECC_WorldStatic, ClimbQueryParams)
+		&& IsWalkable(FloorHit);
 }
 
 bool UWerewolfCharacterMoveComponent::CanMoveToLedgeClimbLocation() const
 {
+	return CheckLedge().bCanMantle;
+}
+
+bool UWerewolfCharacterMoveComponent::FindLedgeMantleTarget(FVector& OutMantleTarget) const
+{
+	const FLedgeCheck& Check = CheckLedge();
+	OutMantleTarget = Check.MantleTarget;
+
+	return Check.bReachedEdge && Check.bCanMantle;
+}
+
+const UWerewolfCharacterMoveComponent::FLedgeCheck& UWerewolfCharacterMoveComponent::CheckLedge() const
+{
+	const FVector Location = UpdatedComponent->GetComponentLocation();
+	const FVector Forward = UpdatedComponent->GetForwardVector();
+
+	// Same thresholds as the wall hits
+	const bool bMoved = FVector::DistSquared(Location, LedgeCheckLocation) > FMath::Square(WallSweepReuseDistance)
+		|| FVector::DotProduct(Forward, LedgeCheckForward) < FMath::Cos(FMath::DegreesToRadians(WallSweepReuseDegrees));
+
+	if (bLedgeCheckValid && !bMoved && !HasWallGeometryMoved())
+	{
+		INC_DWORD_STAT(STAT_WerewolfLedgeChecksReused);
+		return LedgeCheck;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_WerewolfLedgeCheck);
+
+	LedgeCheck = FLedgeCheck();
+	if (!IsCoveredByClimbGraph() || !CheckLedgeFromGraph(LedgeCheck))
+		ProbeLedge(LedgeCheck);
+
+	LedgeCheckLocation = Location;
+	LedgeCheckForward = Forward;
+	bLedgeCheckValid = true;
+
+	return LedgeCheck;
+}
+
+bool UWerewolfCharacterMoveComponent::CheckLedgeFromGraph(FLedgeCheck& OutCheck) const
+{
+	// No baked ledge in front, unknown rather than none: the level may have changed since the bake
+	const FClimbGraphLedge *Ledge = FindGraphLedge();
+	if (Ledge == nullptr)
+		return false;
+
+	const UCapsuleComponent* Capsule = CharacterOwner->GetCapsuleComponent();
+	OutCheck.bReachedEdge = !EyeHeightTrace(Capsule->GetUnscaledCapsuleRadius() * 2.5);
+	if (!OutCheck.bReachedEdge)
+		return true;
+
+	// Baked, only confirmed: the floor is still there and nothing stands on it
+	OutCheck.MantleTarget = FVector(Ledge->MantleTarget);
+	OutCheck.bCanMantle = IsLocationWalkable(OutCheck.MantleTarget) && HasStandingRoomAt(OutCheck.MantleTarget);
 	return true;
 }
+
+void UWerewolfCharacterMoveComponent::ProbeLedge(FLedgeCheck& OutCheck) const
+{
+	const UCapsuleComponent* Capsule = CharacterOwner->GetCapsuleComponent();
+	const float Radius = Capsule->GetUnscaledCapsuleRadius();
+
+	const FVector Location = UpdatedComponent->GetComponentLocation();
+	const FVector Forward = UpdatedComponent->GetForwardVector();
+	const FVector Forward2D = Forward.GetSafeNormal2D();
+	const FVector Right = FVector::CrossProduct(FVector::UpVector, Forward2D);
+
+	const float BaseEyeHeight = GetCharacterOwner()->BaseEyeHeight;
+	const float EyeHeightOffset = IsClimbing() ? BaseEyeHeight + ClimbingCollisionShrinkAmount : BaseEyeHeight;
+	const FVector Eye = Location + UpdatedComponent->GetUpVector() * EyeHeightOffset;
+
+	// 0: forward at eye height, as the old edge trace, the edge is reached when it misses
+	// 1-3: down on top of the wall, in front and on both sides of the capsule, they must all find a walkable floor
+	enum { EyeRay, FloorRay, LeftFloorRay, RightFloorRay, NumRays };
+
+	struct FLedgeRay
+	{
+		FVector Start;
+		FVector End;
+	};
+
+	const FVector OverTop = Eye + Forward2D * (Radius * 2) + FVector(0, 0, 10);
+	const FVector DownToCenter(0, 0, Location.Z - OverTop.Z);
+
+	const FLedgeRay Rays[NumRays] =
+	{
+		{Eye, Eye + Forward * Radius * 2.5},
+		{OverTop, OverTop + DownToCenter},
+		{OverTop - Right * Radius * 0.75, OverTop - Right * Radius * 0.75 + DownToCenter},
+		{OverTop + Right * Radius * 0.75, OverTop + Right * Radius * 0.75 + DownToCenter},
+	};
+
+	FHitResult Hits[NumRays];
+
+	for (int32 Ray = 0; Ray < NumRays; Ray++)
+	{
+		const bool bHit = GetWorld()->LineTraceSingleByChannel(Hits[Ray], Rays[Ray].Start, Rays[Ray].End, ECC_WorldStatic, ClimbQueryParams);
+
+		if (IsDebug == true && GRIFFON_DEBUG_ENABLED(Climb))
+		{
+			DrawDebugLine(GetWorld(), Rays[Ray].Start, Rays[Ray].End, bHit ? FColor::Red : FColor::Green);
+		}
+
+		if (Ray == EyeRay)
+		{
+			OutCheck.bReachedEdge = !bHit;
+			if (!OutCheck.bReachedEdge)
+				return;
+		} else if (!bHit || Hits[Ray].bStartPenetrating || !IsWalkable(Hits[Ray]))
+		{
+			return;
+		}
+	}
+
+	// Then the capsule standing there
+	OutCheck.MantleTarget = Hits[FloorRay].ImpactPoint;
+	OutCheck.bCanMantle = HasStandingRoomAt(OutCheck.MantleTarget);
+}
+
+bool UWerewolfCharacterMoveComponent::HasStandingRoomAt(const FVector& Floor) const
+{
+	const UCapsuleComponent* Capsule = CharacterOwner->GetCapsuleComponent();
+	const float StandingHalfHeight = Capsule->GetScaledCapsuleHalfHeight() + (IsClimbing() ? ClimbingCollisionShrinkAmount : 0);
+	const FCollisionShape StandingCapsule = FCollisionShape::MakeCapsule(Capsule->GetScaledCapsuleRadius(), StandingHalfHeight);
+
+	return !GetWorld()->OverlapBlockingTestByChannel(Floor + FVector(0, 0, StandingHalfHeight + 2), FQuat::Identity,
+		ECC_WorldStatic, StandingCapsule, ClimbQueryParams);
+}
+
+///////////////////
+/// CLIMB GRAPH
+
+bool UWerewolfCharacterMoveComponent::IsCoveredByClimbGraph() const
+{
+	return SurfaceGraph != nullptr && SurfaceGraph->IsCovering(UpdatedComponent->GetComponentLocation());
+}
+
+const FClimbGraphLedge* UWerewolfCharacterMoveComponent::FindGraphLedge() const
+{
+	// The wall being climbed, not the edge of one beside it
+	const FVector Forward = CurrentClimbingNormal.IsZero() ? UpdatedComponent->GetForwardVector() : FVector(-CurrentClimbingNormal);
+
+	// Where the floor rays of ProbeLedge look, from the capsule center to over the eyes
+	const float BaseEyeHeight = GetCharacterOwner()->BaseEyeHeight;
+	const float EyeHeightOffset = IsClimbing() ? BaseEyeHeight + ClimbingCollisionShrinkAmount : BaseEyeHeight;
+
+	return SurfaceGraph->FindLedge(UpdatedComponent->GetComponentLocation(), Forward, GraphLedgeReach, GraphLedgeMinFacing, 0, EyeHeightOffset + 10);
+}
+
+///////////////////
+/// NETWORK
+
+FNetworkPredictionData_Client* UWerewolfCharacterMoveComponent::GetPredictionData_Client() const
+{
+	if (ClientPredictionData == nullptr)
+	{
+		UWerewolfCharacterMoveComponent *MutableThis = const_cast<UWerewolfCharacterMoveComponent *>(this);
+		MutableThis->ClientPredictionData = new FNetworkPredictionData_Client_Werewolf(*this);
+	}
+
+	return ClientPredictionData;
+}
+
+void UWerewolfCharacterMoveComponent::UpdateFromCompressedFlags(uint8 Flags)
+{
+	Super::UpdateFromCompressedFlags(Flags);
+
+	bWantsToClimb = (Flags & FSavedMove_Werewolf::FLAG_WantsToClimb) != 0;
+}
+
+void UWerewolfCharacterMoveComponent::ClientHandleMoveResponse(const FCharacterMoveResponseDataContainer& MoveResponse)
+{
+	Super::ClientHandleMoveResponse(MoveResponse);
+
+	const FWerewolfMoveResponseDataContainer& WerewolfResponse = static_cast<const FWerewolfMoveResponseDataContainer&>(MoveResponse);
+	if (!MoveResponse.IsCorrection() || !WerewolfResponse.bClimbing)
+		return;
+
+	INC_DWORD_STAT(STAT_WerewolfClimbCorrections);
+
+	// After the adjustment, the offset is from the corrected location. The moves are replayed from this surface
+	const FVector Location = UpdatedComponent->GetComponentLocation();
+
+	for (int32 Axis = 0; Axis < 3; Axis++)
+	{
+		CurrentClimbingNormal[Axis] = DequantizeNormalComponent(WerewolfResponse.QuantizedNormal[Axis]);
+		CurrentClimbingPosition[Axis] = Location[Axis] + WerewolfResponse.QuantizedPositionOffset[Axis] / 10.0;
+	}
+
+	// Kept until the replay is over, ComputeSurfaceInfo would trace it again at the first replayed move
+	bReplayOnServerSurface = true;
+
+	// Moved by the correction
+	bWallHitsValid = false;
+	InvalidateLedgeCheck();
+}
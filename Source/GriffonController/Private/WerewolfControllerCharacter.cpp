@@ -10,6 +10,7 @@
 #include "GameFramework/SpringArmComponent.h"
 #include "EnhancedInputComponent.h"
 #include "EnhancedInputSubsystems.h"
+#include "ShapeShiftInputRecording.h"
 #include "ShapeShiftManager.h"
 #include "Kismet/KismetMathLibrary.h"
 
@@ -160,5 +161,44 @@ void AWerewolfControllerCharacter::Climb()
 
 void AWerewolfControllerCharacter::StartShapeShifting()
 {
-	GetShapeShiftManager()->ShapeShiftToForm(SSForm_Druid);
+	ServerShapeShiftToForm(SSForm_Druid);
+}
+
+bool AWerewolfControllerCharacter::CaptureInput(FShapeShiftInputFrame& OutFrame) const
+{
+	OutFrame.Move = FVector2f(GetActionValue(MoveAction).Get<FVector2D>());
+	OutFrame.ControlRotation = FRotator3f(GetControlRotation());
+	if (GetActionValue(JumpAction).Get<bool>())
+		OutFrame.Buttons |= FShapeShiftInputFrame::Button_Jump;
+	if (GetActionValue(ClimbAction).Get<bool>())
+		OutFrame.Buttons |= FShapeShiftInputFrame::Button_Climb;
+
+	return true;
+}
+
+void AWerewolfControllerCharacter::ReplayInput(const FShapeShiftInputFrame& Frame, const FShapeShiftInputFrame& Previous)
+{
+	// Same events as the bindings of SetupPlayerInputComponent
+	if (Frame.IsHeld(FShapeShiftInputFrame::Button_Jump))
+		Jump();
+	if (Frame.IsCompleted(Previous, FShapeShiftInputFrame::Button_Jump))
+		StopJumping();
+
+	if (!Frame.Move.IsZero())
+		Move(FInputActionValue(FVector2D(Frame.Move)));
+
+	if (Frame.IsStarted(Previous, FShapeShiftInputFrame::Button_Climb))
+		Climb();
+}
+
+void AWerewolfControllerCharacter::RestoreMovementState(const FShapeShiftMovementState& State)
+{
+	// Still wanting it from the last time it was possessed
+	MovementComponent->CancelClimbing();
+
+	Super::RestoreMovementState(State);
+
+	// Climbing again only where there is a wall
+	if (State.IsCustomMode(CMOVE_Climbing))
+		MovementComponent->TryClimbing();
 }
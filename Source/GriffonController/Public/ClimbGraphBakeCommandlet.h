@@ -0,0 +1,46 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "ClimbGraphBakeCommandlet.generated.h"
+
+class UClimbSurfaceGraph;
+struct FClimbGraphLedge;
+struct FClimbGraphPatch;
+
+/**
+ * Bake the climb graph of levels, saved next to each map as <Map>_ClimbGraph.
+ * UnrealEditor-Cmd GriffonController.uproject -run=ClimbGraphBake -Maps=/Game/Maps/A,/Game/Maps/B
+ *	-Spacing=50				distance between two patches of a wall (cm)
+ *	-MaxWallNormalZ=0.7		steeper normals are floors or ceilings, not walls
+ *	-CapsuleRadius=42		werewolf capsule, checked free on the mantle targets
+ *	-CapsuleHalfHeight=96
+ * Walls are found by tracing each static collision from the 4 horizontal sides of its bounds, keeping every face
+ * met on the way. A ledge is the walkable top of a wall, reachable from a patch, with room for the capsule.
+ * Streaming sublevels are maps of their own and must be listed.
+ */
+UCLASS()
+class GRIFFONCONTROLLER_API UClimbGraphBakeCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UClimbGraphBakeCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+private:
+	bool BakeMap(const FString& MapPackageName);
+
+	void FindPatches(const UPrimitiveComponent *Component, TArray<FClimbGraphPatch>& OutPatches, TSet<FIntVector>& Taken) const;
+	void FindLedges(UWorld *World, const TArray<FClimbGraphPatch>& Patches, TArray<FClimbGraphLedge>& OutLedges) const;
+
+	bool SaveGraph(UClimbSurfaceGraph *Graph) const;
+
+	float Spacing = 50;
+	float MaxWallNormalZ = 0.7f;
+	float CapsuleRadius = 42;
+	float CapsuleHalfHeight = 96;
+};
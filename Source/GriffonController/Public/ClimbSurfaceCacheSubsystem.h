@@ -0,0 +1,77 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ClimbSurfaceCacheSubsystem.generated.h"
+
+/**
+ * Climbing surfaces (position and normal) already resolved against the static geometry of the world,
+ * keyed by the quantized location and facing of the werewolf. Filled by ComputeSurfaceInfo when it had to sweep.
+ * Entries are dropped when one of their components moves or is destroyed, and all of them when a level streams in or out.
+ */
+UCLASS()
+class GRIFFONCONTROLLER_API UClimbSurfaceCacheSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	static constexpr float CellSize = 20;
+	/** Steps of each component of the facing, 4 is around 15 degrees */
+	static constexpr int32 FacingSteps = 4;
+	/** Everything is dropped past this, the cliffs climbed now fill it again */
+	static constexpr int32 MaxEntries = 1 << 16;
+	/** Reserved up front, a miss only allocates past it */
+	static constexpr int32 ReservedEntries = 1024;
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	bool FindSurface(const FVector& Location, const FVector& Forward, FVector& OutPosition, FVector& OutNormal);
+	void AddSurface(const FVector& Location, const FVector& Forward, const FVector& Position, const FVector& Normal,
+		TArrayView<const UPrimitiveComponent * const> Components);
+
+	void Flush();
+
+	int32 GetNumEntries() const { return Entries.Num(); }
+
+private:
+	struct FKey
+	{
+		FIntVector Cell;
+		uint32 Facing;
+
+		bool operator==(const FKey& Other) const { return Cell == Other.Cell && Facing == Other.Facing; }
+		friend uint32 GetTypeHash(const FKey& Key) { return HashCombine(GetTypeHash(Key.Cell), Key.Facing); }
+	};
+
+	struct FEntry
+	{
+		FVector Position;
+		FVector Normal;
+		TArray<TWeakObjectPtr<const UPrimitiveComponent>, TInlineAllocator<4>> Components;
+	};
+
+	/** Component of some entries, they are dropped when it moves */
+	struct FBoundComponent
+	{
+		TWeakObjectPtr<UPrimitiveComponent> Component;
+		FDelegateHandle TransformUpdatedHandle;
+	};
+
+	static FKey MakeKey(const FVector& Location, const FVector& Forward);
+
+	void RemoveEntry(const FKey& Key);
+	void OnComponentMoved(USceneComponent *Component, EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport);
+	void OnLevelChanged(ULevel *Level, UWorld *World);
+
+	TMap<FKey, FEntry> Entries;
+	TMap<TObjectKey<UPrimitiveComponent>, FBoundComponent> BoundComponents;
+
+	FDelegateHandle LevelAddedHandle;
+	FDelegateHandle LevelRemovedHandle;
+
+	uint64 NumLookups = 0;
+	uint64 NumHits = 0;
+};
@@ -0,0 +1,101 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "ClimbSurfaceGraph.generated.h"
+
+/** Piece of climbable wall, one every bake spacing */
+struct FClimbGraphPatch
+{
+	FVector3f Position;
+	FVector3f Normal;
+
+	friend FArchive& operator<<(FArchive& Ar, FClimbGraphPatch& Patch)
+	{
+		return Ar << Patch.Position << Patch.Normal;
+	}
+};
+
+/** Top of a wall the werewolf can climb up to */
+struct FClimbGraphLedge
+{
+	/** Edge of the wall */
+	FVector3f Position;
+	/** Normal of the wall under the edge */
+	FVector3f Normal;
+	/** Walkable floor behind the edge, with room for the werewolf capsule */
+	FVector3f MantleTarget;
+
+	friend FArchive& operator<<(FArchive& Ar, FClimbGraphLedge& Ledge)
+	{
+		return Ar << Ledge.Position << Ledge.Normal << Ledge.MantleTarget;
+	}
+};
+
+/** Patches and ledges of a cell are contiguous in the graph arrays */
+struct FClimbGraphCell
+{
+	FIntVector Coord;
+	int32 FirstPatch = 0;
+	int32 NumPatches = 0;
+	int32 FirstLedge = 0;
+	int32 NumLedges = 0;
+
+	friend FArchive& operator<<(FArchive& Ar, FClimbGraphCell& Cell)
+	{
+		return Ar << Cell.Coord << Cell.FirstPatch << Cell.NumPatches << Cell.FirstLedge << Cell.NumLedges;
+	}
+};
+
+/**
+ * Climbable walls and ledges of a level, baked by the ClimbGraphBake commandlet next to the map (<Map>_ClimbGraph).
+ * Flat arrays of plain structs, bulk serialized, cells sorted by coordinate so a lookup is a binary search.
+ * Only what was found is final, a missing patch or ledge means unknown: geometry may have been added since the bake.
+ */
+UCLASS()
+class GRIFFONCONTROLLER_API UClimbSurfaceGraph : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	static constexpr float CellSize = 800;
+
+	/** Bumped when the layout changes, older graphs load empty, covering nothing, and must be baked again */
+	static constexpr int32 Version = 1;
+
+	virtual void Serialize(FArchive& Ar) override;
+
+	UPROPERTY(VisibleAnywhere, Category = "Climbing")
+	FBox Bounds = FBox(ForceInit);
+	UPROPERTY(VisibleAnywhere, Category = "Climbing")
+	float Spacing = 0;
+
+	/** Replace the content, patches and ledges in any order */
+	void Build(const FBox& InBounds, float InSpacing, TArray<FClimbGraphPatch>&& InPatches, TArray<FClimbGraphLedge>&& InLedges);
+
+	bool IsCovering(const FVector& Location) const { return Bounds.IsValid && Bounds.IsInsideOrOn(Location); }
+
+	/** Closest patch in Radius with a normal against Forward by at least MinFacing (cosine) */
+	const FClimbGraphPatch* FindPatch(const FVector& Location, const FVector& Forward, float Radius, float MinFacing) const;
+	/** Closest ledge in Radius with a wall normal against Forward by at least MinFacing (cosine), its edge in [MinHeight, MaxHeight] above Location */
+	const FClimbGraphLedge* FindLedge(const FVector& Location, const FVector& Forward, float Radius, float MinFacing, float MinHeight, float MaxHeight) const;
+
+	int32 GetNumPatches() const { return Patches.Num(); }
+	int32 GetNumLedges() const { return Ledges.Num(); }
+
+	static FIntVector GetCellCoord(const FVector& Location);
+	static FString GetGraphPackageName(const FString& MapPackageName);
+
+private:
+	const FClimbGraphCell* FindCell(const FIntVector& Coord) const;
+
+	/** Call Visit on the cells touched by the sphere */
+	template <typename FunctorType>
+	void ForEachCell(const FVector& Location, float Radius, FunctorType&& Visit) const;
+
+	TArray<FClimbGraphCell> Cells;
+	TArray<FClimbGraphPatch> Patches;
+	TArray<FClimbGraphLedge> Ledges;
+};
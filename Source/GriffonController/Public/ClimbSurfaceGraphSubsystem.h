@@ -0,0 +1,43 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ClimbSurfaceGraphSubsystem.generated.h"
+
+class UClimbSurfaceGraph;
+struct FClimbGraphLedge;
+struct FClimbGraphPatch;
+
+/**
+ * Baked climb graphs of the loaded levels. The graph of a level is loaded asynchronously when it is added
+ * to the world and dropped when it is removed. Until then the werewolves trace as if there was no graph.
+ */
+UCLASS()
+class GRIFFONCONTROLLER_API UClimbSurfaceGraphSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+
+	/** True if a loaded graph was baked around this location. Only what it finds is final, a miss must still be traced */
+	bool IsCovering(const FVector& Location) const;
+
+	const FClimbGraphPatch* FindPatch(const FVector& Location, const FVector& Forward, float Radius, float MinFacing) const;
+	const FClimbGraphLedge* FindLedge(const FVector& Location, const FVector& Forward, float Radius, float MinFacing, float MinHeight, float MaxHeight) const;
+
+private:
+	void LoadGraph(ULevel *Level);
+	void OnLevelAdded(ULevel *Level, UWorld *World);
+	void OnLevelRemoved(ULevel *Level, UWorld *World);
+
+	UPROPERTY()
+	TMap<ULevel *, UClimbSurfaceGraph *> Graphs;
+
+	FDelegateHandle LevelAddedHandle;
+	FDelegateHandle LevelRemovedHandle;
+};
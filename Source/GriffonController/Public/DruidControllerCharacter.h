@@ -3,6 +3,7 @@
 #pragma once
 
 #include "InputActionValue.h"
+#include "Engine/StreamableManager.h"
 #include "NiagaraSystem.h"
 #include "ShapeShiftForm.h"
 #include "ShapeShiftMenu.h"
@@ -30,6 +31,9 @@ class GRIFFONCONTROLLER_API ADruidControllerCharacter : public AShapeShiftForm
 	/** Look Input Action */
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Input, meta = (AllowPrivateAccess = "true"))
 	class UInputAction* LookAction;
+	/** Point at a form of the radial shapeshift menu, the stick */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Input, meta = (AllowPrivateAccess = "true"))
+	class UInputAction* ShapeShiftSelectAction;
 
 public:
 	// Sets default values for this character's properties
@@ -48,6 +52,8 @@ protected:
 	
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual void PawnClientRestart() override;
 
 public:
 	/** Returns CameraBoom subobject **/
@@ -65,6 +71,8 @@ public:
 
 	virtual void StartShapeShifting() override;
 	void ShapeShift(EShapeShiftForm form);
+	/** Stop charging without casting, from the menu closed empty */
+	void CancelShapeShifting();
 
 	EShapeShiftForm ShapeToFormInto;
 	
@@ -87,9 +95,17 @@ public:
 	UAnimMontage* CastShapeShiftMontage;
 
 	void ShowShapeShiftMenu();
+	/** Built hidden for the local player once the class is streamed, the first cast only shows it */
+	void CreateShapeShiftMenu();
+	void SelectShapeShiftForm(const FInputActionValue& Value);
+	/** Releasing the shapeshift action chooses the form pointed at in the radial menu, or cancels if none is */
+	void ConfirmShapeShiftForm();
 	
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Widgets")
-	TSubclassOf<UUserWidget> W_ShapeShiftMenu;
+	TSoftClassPtr<UShapeShiftMenu> W_ShapeShiftMenu;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Widgets")
+	TEnumAsByte<EShapeShiftMenuMode> ShapeShiftMenuMode = SSMenu_Cursor;
 	UPROPERTY()
 	UShapeShiftMenu *ShapeShiftMenuInstance = nullptr;
+	TSharedPtr<FStreamableHandle> ShapeShiftMenuHandle;
 };
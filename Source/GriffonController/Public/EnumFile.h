@@ -12,6 +12,8 @@ UENUM(BlueprintType)
 enum ECustomMovementMode
 {
 	CMOVE_Climbing      UMETA(DisplayName = "Climbing"),
+	CMOVE_Flying		UMETA(DisplayName = "Flying"),
+	CMOVE_Swimming		UMETA(DisplayName = "Swimming"),
 	CMOVE_MAX			UMETA(Hidden),
 };
 
@@ -23,4 +25,29 @@ enum EShapeShiftForm
 	SSForm_Werewolf			UMETA(DisplayName = "Werewolf"),
 	SSForm_SeaCreature		UMETA(DisplayName = "SeaCreature"),
 	SSForm_MAX				UMETA(Hidden),
-};
\ No newline at end of file
+};
+
+UENUM(BlueprintType)
+enum EFlightStepMode
+{
+	FlightStep_Variable		UMETA(DisplayName = "Variable", ToolTip = "Flight physics run once per frame with the frame delta"),
+	FlightStep_Fixed		UMETA(DisplayName = "Fixed", ToolTip = "Flight physics run by the movement component in fixed substeps, the mesh is interpolated between them"),
+	FlightStep_Batched		UMETA(DisplayName = "Batched", ToolTip = "Flight physics run with every other batched griffon by the flight subsystem, for AI flocks"),
+	FlightStep_Predicted	UMETA(DisplayName = "Predicted", ToolTip = "Flight physics run by the movement component in the Flying custom mode, predicted and replicated"),
+	FlightStep_MAX			UMETA(Hidden),
+};
+UENUM(BlueprintType)
+enum EClimbLOD
+{
+	ClimbLOD_Full		UMETA(DisplayName = "Full", ToolTip = "Player controlled werewolves, every sweep every frame"),
+	ClimbLOD_Reduced	UMETA(DisplayName = "Reduced", ToolTip = "AI werewolves close to a player, fewer and less frequent sweeps"),
+	ClimbLOD_Minimal	UMETA(DisplayName = "Minimal", ToolTip = "Far or unseen AI werewolves, rare sweeps, no snapping nor rotation interpolation"),
+	ClimbLOD_MAX		UMETA(Hidden),
+};
+UENUM(BlueprintType)
+enum EShapeShiftMenuMode
+{
+	SSMenu_Cursor	UMETA(DisplayName = "Cursor", ToolTip = "Forms clicked with the mouse cursor"),
+	SSMenu_Radial	UMETA(DisplayName = "Radial", ToolTip = "Forms pointed at with the stick, chosen by releasing the shapeshift action. No cursor"),
+	SSMenu_MAX		UMETA(Hidden),
+};
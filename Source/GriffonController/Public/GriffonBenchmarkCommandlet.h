@@ -0,0 +1,79 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "EnumFile.h"
+#include "Commandlets/Commandlet.h"
+#include "GriffonBenchmarkCommandlet.generated.h"
+
+class AGriffonControllerCharacter;
+class FJsonObject;
+class UGriffonFlightCurves;
+
+/**
+ * Headless benchmark of the movement code, results are written as json for the build machines.
+ * UnrealEditor-Cmd GriffonController.uproject -run=GriffonBenchmark -nullrhi -unattended
+ *	-Output=<File.json>			default Saved/Benchmarks/GriffonBenchmark.json
+ *	-Counts=1,100,1000			number of griffons of each flight run, and of sea creatures of each swim run
+ *	-Frames=600					frames ticked per run
+ *	-Mode=Variable|Fixed|Batched	flight step mode of the griffons
+ *	-GriffonClass=<Class path>	blueprint to spawn instead of the native griffon
+ *	-FlightCurves=<Asset path>	baked curves given to the griffons
+ *	-MenuClass=<Class path>		shapeshift menu blueprint timed when first opened, the native menu by default
+ *	-TrigFree					fly with griffon.Flight.TrigFree
+ *	-Replay=<File.gsir>			replay an input recording of FShapeShiftInputRecorder instead of the benchmarks
+ *	-Golden=<File.gsrt>			track the replay is compared to, default next to the recording
+ *	-WriteGolden				write the replay track as the golden one
+ *	-MaxLocationError=0.1		location difference allowed with the golden track (cm)
+ *	-MaxRotationError=0.1		rotation difference allowed with the golden track (degrees)
+ *	-MaxCostRatio=0				frame cost allowed against the golden track, 0 to only report it
+ * The commandlet fails if no griffon is still flying at the end of a flight run.
+ * A griffon flies 2 seconds at 30, 60 and 144 fps in the fixed step mode, the commandlet fails if it ends elsewhere than at 60 fps.
+ * The trig free flight math is also checked against the rotator one, the commandlet fails if they differ.
+ * So are the baked flight curves, inclination table included, against their curves: the commandlet fails over MaxAllowedBakeError.
+ * The werewolf ledge check is timed too, computed and reused, in front of a wall.
+ * A werewolf climbing tick must not allocate once warm, surface cache misses included, and must climb on every frame.
+ * The commandlet fails otherwise, or when it could not run without the cube mesh.
+ * Sea creatures swim in a body of water, the frame cost is reported per swimmer. The commandlet fails if one is not swimming at the end.
+ * The first open of the shapeshift menu is timed created on the spot and precreated, when Slate is up.
+ */
+UCLASS()
+class GRIFFONCONTROLLER_API UGriffonBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UGriffonBenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+private:
+	///////////////////
+	/// FLIGHT
+
+	/** Fails when no griffon is still flying at the end */
+	TSharedRef<FJsonObject> RunFlight(int32 NumGriffons, int32 NumFrames, EFlightStepMode Mode, bool& bOutPassed);
+
+	TArray<AGriffonControllerCharacter *> SpawnFlyingGriffons(UWorld *World, int32 NumGriffons, EFlightStepMode Mode) const;
+	void DriveGriffons(const TArray<AGriffonControllerCharacter *>& Griffons, int32 Frame) const;
+
+	///////////////////
+	/// FIXED STEP
+
+	/** Fails when the fixed step flight diverges between frame rates, the variable one is only reported */
+	TSharedRef<FJsonObject> RunFixedStepDivergence(bool& bOutPassed);
+	/** One griffon flying with the same input at this frame rate */
+	void SimulateFlight(EFlightStepMode Mode, float FrameRate, FVector& OutLocation, FVector& OutVelocity, bool& bOutFlying);
+
+	///////////////////
+	/// REPLAY
+
+	/** Returns the exit code of the commandlet */
+	int32 RunReplay(const FString& ReplayFilename, const FString& Params, const FString& OutputPath) const;
+
+	UPROPERTY()
+	UClass *GriffonClass;
+	UPROPERTY()
+	UGriffonFlightCurves *FlightCurves;
+};
@@ -0,0 +1,124 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "EnumFile.h"
+#include "GriffonCharacterMoveComponent.generated.h"
+
+class AGriffonControllerCharacter;
+
+/**
+ * Saved move of the griffon, the flight inputs go in the compressed flags.
+ * Moves with different flags are never combined (FSavedMove_Character::CanCombineWith compares them).
+ * Replayed with the control rotation they were made with, the flight math reads it.
+ */
+class FSavedMove_Griffon : public FSavedMove_Character
+{
+public:
+	typedef FSavedMove_Character Super;
+
+	enum
+	{
+		FLAG_WantsToFly = FLAG_Custom_0,
+		FLAG_Flapping = FLAG_Custom_1,
+	};
+
+	virtual void Clear() override;
+	virtual uint8 GetCompressedFlags() const override;
+	virtual void SetMoveFor(ACharacter *Character, float InDeltaTime, FVector const& NewAccel, FNetworkPredictionData_Client_Character& ClientData) override;
+	virtual void PrepMoveFor(ACharacter *Character) override;
+
+	uint8 bSavedWantsToFly : 1;
+	uint8 bSavedFlapping : 1;
+};
+
+class FNetworkPredictionData_Client_Griffon : public FNetworkPredictionData_Client_Character
+{
+public:
+	typedef FNetworkPredictionData_Client_Character Super;
+
+	explicit FNetworkPredictionData_Client_Griffon(const UCharacterMovementComponent& ClientMovement) : Super(ClientMovement) {}
+
+	virtual FSavedMovePtr AllocateNewMove() override;
+};
+
+/**
+ * Corrections also carry the gliding speed, quantized, so the client replays from the server value.
+ * While flying they carry the rotation too, the flight math turns from it and the base corrections leave it.
+ */
+struct FGriffonMoveResponseDataContainer : public FCharacterMoveResponseDataContainer
+{
+	typedef FCharacterMoveResponseDataContainer Super;
+
+	virtual void ServerFillResponseData(const UCharacterMovementComponent& CharacterMovement, const FClientAdjustment& PendingAdjustment) override;
+	virtual bool Serialize(UCharacterMovementComponent& CharacterMovement, FArchive& Ar, UPackageMap *PackageMap) override;
+
+	uint16 QuantizedFlySpeedGliding = 0;
+	bool bHasFlightRotation = false;
+	FRotator FlightRotation = FRotator::ZeroRotator;
+};
+
+/**
+ * Movement of the griffon, flight as the CMOVE_Flying custom mode when in FlightStep_Predicted or FlightStep_Fixed.
+ * The flight math runs on the griffon slot of the flight batch for each move, on the owning client (with replays) and on the server.
+ * The accumulator of FlightStep_Fixed is not part of the saved moves, it is for local and AI griffons.
+ */
+UCLASS()
+class GRIFFONCONTROLLER_API UGriffonCharacterMoveComponent : public UCharacterMovementComponent
+{
+	GENERATED_BODY()
+
+public:
+	UGriffonCharacterMoveComponent();
+
+	////////////////////////////////////////////////////////////
+	/// FLYING
+
+	/** Input of the owning client, sent to the server in the compressed flags */
+	bool bWantsToFly = false;
+	/** Control rotation of the move being replayed, used instead of the current one while bClientUpdating */
+	FRotator ReplayControlRotation = FRotator::ZeroRotator;
+
+	UFUNCTION(BlueprintPure)
+	bool IsGriffonFlying() const;
+
+	/** Gliding speed goes from 0 to 1.5, 16 bits keep the interpolation moving close to its target */
+	static constexpr float MaxFlySpeedGliding = 1.5f;
+	static uint16 QuantizeFlySpeedGliding(float FlySpeedGliding);
+	static float DequantizeFlySpeedGliding(uint16 Quantized);
+
+	virtual void UpdateCharacterStateBeforeMovement(float DeltaSeconds) override;
+	virtual void OnMovementModeChanged(EMovementMode PreviousMovementMode, uint8 PreviousCustomMode) override;
+
+	///////////////////
+	/// FLYING PHYSICS
+
+	virtual void PhysCustom(float deltaTime, int32 Iterations) override;
+	/** The flight math gives the rotation */
+	virtual void PhysicsRotation(float DeltaTime) override;
+
+	void PhysFlying(float deltaTime, int32 Iterations);
+	/** Fixed steps of PhysFlyingStep, the mesh displayed between the two last ones */
+	void PhysFlyingFixed(float deltaTime, int32 Iterations);
+	/** Put the mesh at this transform, the updated component does not move */
+	void SetFlightMeshOffset(const FVector& DisplayLocation, const FQuat& DisplayRotation);
+	/** One move of the flight, the glide added to the input acceleration */
+	void PhysFlyingStep(float deltaTime, int32 Iterations);
+	void StopFlying(float deltaTime, int32 Iterations);
+
+	virtual float GetMaxSpeed() const override;
+
+	///////////////////
+	/// NETWORK
+
+	virtual FNetworkPredictionData_Client* GetPredictionData_Client() const override;
+	virtual void UpdateFromCompressedFlags(uint8 Flags) override;
+	virtual void ClientHandleMoveResponse(const FCharacterMoveResponseDataContainer& MoveResponse) override;
+
+private:
+	AGriffonControllerCharacter* GetGriffonOwner() const;
+
+	FGriffonMoveResponseDataContainer GriffonMoveResponseData;
+};
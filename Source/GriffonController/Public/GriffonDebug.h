@@ -0,0 +1,43 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Debug values of the flight and the climb.
+ * Enabled with griffon.Debug.Flight / griffon.Debug.Climb, compiled out of Shipping and Test.
+ * Values are recorded in a preallocated buffer and only formatted at the end of the frame when displayed,
+ * when the channel is off the cost is reading the console variable.
+ */
+
+#define GRIFFON_DEBUG !(UE_BUILD_SHIPPING || UE_BUILD_TEST)
+
+enum class EGriffonDebugChannel : uint8
+{
+	Flight,
+	Climb,
+};
+
+#if GRIFFON_DEBUG
+
+namespace GriffonDebug
+{
+	GRIFFONCONTROLLER_API bool IsEnabled(EGriffonDebugChannel Channel);
+
+	/** Label must be a literal, it is kept as a pointer until the values are displayed */
+	GRIFFONCONTROLLER_API void RecordValue(const TCHAR *Label, float Value, const FColor& Color);
+}
+
+#define GRIFFON_DEBUG_ENABLED(Channel) GriffonDebug::IsEnabled(EGriffonDebugChannel::Channel)
+
+/** Value is not evaluated when the channel is off */
+#define GRIFFON_DEBUG_VALUE(Channel, Label, Value, Color) \
+	do { if (GRIFFON_DEBUG_ENABLED(Channel)) GriffonDebug::RecordValue(TEXT(Label), Value, Color); } while (0)
+
+#else
+
+#define GRIFFON_DEBUG_ENABLED(Channel) false
+#define GRIFFON_DEBUG_VALUE(Channel, Label, Value, Color) do { } while (0)
+
+#endif
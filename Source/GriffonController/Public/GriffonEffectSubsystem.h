@@ -0,0 +1,59 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "GriffonEffectSubsystem.generated.h"
+
+class UNiagaraComponent;
+class UNiagaraSystem;
+
+/** Components of one system, the free ones deactivated and ready to play */
+USTRUCT()
+struct FGriffonEffectPool
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<UNiagaraComponent *> Free;
+	UPROPERTY()
+	TArray<UNiagaraComponent *> Playing;
+};
+
+/**
+ * Niagara components kept for the effects played again and again, like the shapeshift cast.
+ * Prewarmed at BeginPlay, played at a location and taken back when they complete or are released.
+ * Past griffon.Effects.MaxPooled free components for a system, the returned ones are destroyed.
+ */
+UCLASS()
+class GRIFFONCONTROLLER_API UGriffonEffectSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+
+	/** Spawn components until Count are free for the system, each activated once so its instance is built */
+	void Prewarm(UNiagaraSystem *System, int32 Count);
+	/** A pooled component playing the system, spawned if none is free */
+	UNiagaraComponent* Play(UNiagaraSystem *System, const FVector& Location, const FRotator& Rotation);
+	/** Stop a looping effect now, its component goes back to the pool */
+	void Release(UNiagaraComponent *Component);
+
+	/** Cost of the plays since the last call, UObjects included */
+	void ConsumePlayCost(double& OutSeconds, int32& OutObjects);
+
+private:
+	UNiagaraComponent* SpawnComponent(UNiagaraSystem *System);
+	void ReturnToPool(UNiagaraComponent *Component);
+
+	UFUNCTION()
+	void OnEffectFinished(UNiagaraComponent *Component);
+
+	UPROPERTY()
+	TMap<UNiagaraSystem *, FGriffonEffectPool> Pools;
+
+	double PlaySeconds = 0;
+	int32 PlayObjects = 0;
+};
@@ -0,0 +1,87 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "GriffonFlightCurves.generated.h"
+
+class UCurveFloat;
+
+/**
+ * UCurveFloat sampled at a fixed resolution.
+ * Eval is a clamp + lerp in the table, no key search and no virtual call.
+ * Out of range times are clamped, which matches the default constant extrapolation of the curves.
+ */
+struct GRIFFONCONTROLLER_API FGriffonBakedCurve
+{
+	static constexpr int32 Resolution = 256;
+
+	alignas(PLATFORM_CACHE_LINE_SIZE) float Samples[Resolution] = {};
+	float MinTime = 0;
+	float InvStep = 0;
+
+	void Bake(const UCurveFloat* Curve);
+	/** Sample an angle curve (in degrees, 0 being horizontal) by the cosine of the angle to the vertical, Eval then takes a dot product */
+	void BakeInclination(const UCurveFloat* AngleCurve);
+
+	/** Biggest difference with the source curve, checked between the table samples */
+	float ComputeMaxError(const UCurveFloat* Curve, int32 ChecksPerSample = 8) const;
+	/** Same for a table baked by BakeInclination, checked over the inclinations. It errs most close to the vertical */
+	float ComputeMaxInclinationError(const UCurveFloat* AngleCurve, int32 ChecksPerSample = 8) const;
+
+	FORCEINLINE float Eval(float Time) const
+	{
+		const float Position = FMath::Clamp((Time - MinTime) * InvStep, 0.f, float(Resolution - 1));
+		const int32 Index = FMath::Min(int32(Position), Resolution - 2);
+
+		return FMath::Lerp(Samples[Index], Samples[Index + 1], Position - Index);
+	}
+};
+
+/**
+ * Lift and angle curves of the griffon flight, baked into lookup tables when the asset is loaded or saved
+ */
+UCLASS(BlueprintType)
+class GRIFFONCONTROLLER_API UGriffonFlightCurves : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	/** Lift multiplier depending on the velocity (Z only taken when going down) */
+	UPROPERTY(EditAnywhere, Category = "Flight")
+	UCurveFloat *LiftMultiplierCurve;
+	/** Lift multiplier depending on the camera inclination angle */
+	UPROPERTY(EditAnywhere, Category = "Flight")
+	UCurveFloat *AngleMultiplierCurve;
+
+	/** Biggest error of the tables against the curves at the last bake, the inclination table included */
+	UPROPERTY(VisibleAnywhere, Category = "Flight")
+	float MaxBakeError = 0;
+	/** Above this error the bake fails: the asset is not valid and fails the cook. Keep the angle curve flat close to the vertical */
+	UPROPERTY(EditAnywhere, Category = "Flight")
+	float MaxAllowedBakeError = 0.01f;
+
+	virtual void PostLoad() override;
+	virtual void PreSave(FObjectPreSaveContext SaveContext) override;
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+	virtual EDataValidationResult IsDataValid(TArray<FText>& ValidationErrors) override;
+#endif
+
+	/** False when MaxBakeError is above MaxAllowedBakeError, the tables are still filled */
+	bool Bake();
+
+	FORCEINLINE float GetLiftMultiplier(float Velocity) const { return LiftTable.Eval(Velocity); }
+	FORCEINLINE float GetAngleMultiplier(float Angle) const { return AngleTable.Eval(Angle); }
+
+	const FGriffonBakedCurve& GetLiftTable() const { return LiftTable; }
+	const FGriffonBakedCurve& GetAngleTable() const { return AngleTable; }
+	const FGriffonBakedCurve& GetInclinationTable() const { return InclinationTable; }
+
+private:
+	FGriffonBakedCurve LiftTable;
+	FGriffonBakedCurve AngleTable;
+	/** Angle curve by the inclination, for the trig free flight math */
+	FGriffonBakedCurve InclinationTable;
+};
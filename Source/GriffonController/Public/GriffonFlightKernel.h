@@ -0,0 +1,107 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FGriffonBakedCurve;
+
+/**
+ * Flight state of many griffons in structure of arrays.
+ * Arrays are padded to a multiple of LaneWidth so the kernel never handle a tail.
+ * Velocity and actor rotation are inputs and are overwritten by the result of the step.
+ * The flight math works on the velocity relative to the air, the air velocity is added back after.
+ */
+struct GRIFFONCONTROLLER_API FGriffonFlightBatch
+{
+	static constexpr int32 LaneWidth = 4;
+
+	using FLaneArray = TArray<float, TAlignedHeapAllocator<16>>;
+
+	// INPUTS
+	FLaneArray VelocityX;
+	FLaneArray VelocityY;
+	FLaneArray VelocityZ;
+	FLaneArray ControlPitch;
+	FLaneArray ControlYaw;
+	FLaneArray ControlRoll;
+	FLaneArray ActorPitch;
+	FLaneArray ActorYaw;
+	FLaneArray ActorRoll;
+	FLaneArray Mass;
+	TArray<const FGriffonBakedCurve*> LiftCurves;
+	TArray<const FGriffonBakedCurve*> AngleCurves;
+
+	// INPUTS OF THE TRIG FREE MATH
+	// Rotations as quaternions instead of rotators, the angle curve is looked up by the inclination
+	FLaneArray ControlQuatX;
+	FLaneArray ControlQuatY;
+	FLaneArray ControlQuatZ;
+	FLaneArray ControlQuatW;
+	FLaneArray ActorQuatX;
+	FLaneArray ActorQuatY;
+	FLaneArray ActorQuatZ;
+	FLaneArray ActorQuatW;
+	TArray<const FGriffonBakedCurve*> InclinationCurves;
+
+	// WIND
+	// Air velocity at the griffon position, filled by the wind subsystem before the step
+	FLaneArray PositionX;
+	FLaneArray PositionY;
+	FLaneArray PositionZ;
+	FLaneArray AirVelocityX;
+	FLaneArray AirVelocityY;
+	FLaneArray AirVelocityZ;
+	/** Wind brick each slot was in last time, and its index in the wind field (INDEX_NONE in empty air) */
+	TArray<FIntVector> WindBricks;
+	TArray<int32> WindBrickIndices;
+	/** Wind field build the indices are from */
+	uint32 WindGeneration = 0;
+
+	float GravityZ = 0;
+	/** Set from griffon.Flight.TrigFree once per frame, says which inputs are filled and which rotation is written */
+	bool bTrigFreeMath = false;
+
+	// STATE
+	FLaneArray FlySpeedGliding;
+
+	// OUTPUTS
+	FLaneArray ControlInclination;
+	FLaneArray LiftNormalized;
+	FLaneArray LiftForce;
+	FLaneArray CanFly; // 1 or 0
+	FLaneArray GlidingDirectionX;
+	FLaneArray GlidingDirectionY;
+
+	int32 Num() const { return NumSlots; }
+	int32 NumGroups() const { return FMath::DivideAndRoundUp(NumSlots, LaneWidth); }
+
+	int32 AddSlot();
+	/** Move the last slot in the removed one, return the old index of the moved slot (or INDEX_NONE) */
+	int32 RemoveSlotSwap(int32 Slot);
+
+private:
+	void ResetSlot(int32 Slot);
+	void SetNumLanes(int32 NumLanes);
+
+	int32 NumSlots = 0;
+};
+
+/**
+ * Stateless lift/glide/turn-roll math of the griffon flight, LaneWidth griffons at a time.
+ * Same math as the one done per character before, without any actor call.
+ * With bTrigFreeMath the rotations are quaternions and the angles are never computed:
+ * directions are read from the quaternions, the roll is clamped by comparing the dot product to a precomputed sine,
+ * and the actor rotation is built from half angle identities then normalized-lerped instead of RInterpTo.
+ */
+namespace GriffonFlightKernel
+{
+	/** Run the rotator or the trig free math depending on Batch.bTrigFreeMath */
+	GRIFFONCONTROLLER_API void Step(FGriffonFlightBatch& Batch, int32 FirstGroup, int32 NumGroups, float DeltaSeconds);
+
+	/** Same, only the lane of Slot is written, the other griffons of its group are left as they were */
+	GRIFFONCONTROLLER_API void StepSlot(FGriffonFlightBatch& Batch, int32 Slot, float DeltaSeconds);
+
+	/** Split the groups in tasks when the batch is big enough */
+	GRIFFONCONTROLLER_API void StepParallel(FGriffonFlightBatch& Batch, float DeltaSeconds);
+}
@@ -0,0 +1,63 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GriffonFlightKernel.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "GriffonFlightSubsystem.generated.h"
+
+class AGriffonControllerCharacter;
+class UCurveFloat;
+class UGriffonWindSubsystem;
+struct FGriffonBakedCurve;
+
+/**
+ * Own the flight batches of the world, every flying griffon has a slot in one of them.
+ * Griffons in FlightStep_Batched are in the flock batch and all stepped here at once,
+ * others are in their own batch and step their own slot from their tick or movement component.
+ */
+UCLASS()
+class GRIFFONCONTROLLER_API UGriffonFlightSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	void RegisterFlyer(AGriffonControllerCharacter *Griffon);
+	void UnregisterFlyer(AGriffonControllerCharacter *Griffon);
+
+	/** Run the kernel on the lane group of this griffon only */
+	void StepFlyer(const AGriffonControllerCharacter *Griffon, float DeltaSeconds);
+
+	/** Batch the slot of this griffon is in */
+	FGriffonFlightBatch& GetBatch(const AGriffonControllerCharacter *Griffon);
+
+	/** Tables shared by every griffon using the same curve */
+	const FGriffonBakedCurve* FindOrBakeCurve(const UCurveFloat *Curve);
+	/** Same for an angle curve looked up by the inclination (trig free math) */
+	const FGriffonBakedCurve* FindOrBakeInclinationCurve(const UCurveFloat *AngleCurve);
+
+private:
+	TArray<AGriffonControllerCharacter *>& GetFlyers(const AGriffonControllerCharacter *Griffon);
+
+	/** Griffons stepping their own slot */
+	FGriffonFlightBatch Batch;
+	/** Batched griffons, stepped whole by the tick */
+	FGriffonFlightBatch FlockBatch;
+
+	UPROPERTY()
+	UGriffonWindSubsystem *WindSubsystem;
+
+	/** Same index as the slots of their batch */
+	UPROPERTY()
+	TArray<AGriffonControllerCharacter *> Flyers;
+	UPROPERTY()
+	TArray<AGriffonControllerCharacter *> FlockFlyers;
+
+	TMap<TObjectKey<UCurveFloat>, TUniquePtr<FGriffonBakedCurve>> BakedCurves;
+	TMap<TObjectKey<UCurveFloat>, TUniquePtr<FGriffonBakedCurve>> BakedInclinationCurves;
+};
@@ -0,0 +1,68 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include <atomic>
+
+/** Flight state of one griffon for one flight step */
+struct FGriffonFlightSample
+{
+	double Time;
+	uint32 FlyerId;
+	uint32 Frame;
+	float ControlInclination;
+	float LiftNormalized;
+	float FlySpeedGliding;
+	float VelocityAngle;
+	FVector3f Velocity;
+	FRotator3f Rotation;
+};
+
+/**
+ * Always on ring buffer of the last flight samples of every griffon.
+ * Record is lock free and can be called from any thread, the oldest samples are overwritten.
+ * Dump copy the buffer and write it from a background thread in Saved/Telemetry (griffon.Telemetry.Dump),
+ * the files can be converted to csv with griffon.Telemetry.ToCSV <File>.
+ */
+class GRIFFONCONTROLLER_API FGriffonFlightTelemetry
+{
+public:
+	static constexpr uint32 FileMagic = 0x4C544647; // GFTL
+	static constexpr uint32 FileVersion = 1;
+
+	static constexpr int32 Capacity = 4096; // Power of two
+
+	static FGriffonFlightTelemetry& Get();
+
+	FORCEINLINE void Record(const FGriffonFlightSample& Sample)
+	{
+		const uint64 Index = WriteIndex.fetch_add(1, std::memory_order_relaxed);
+		FSlot& Slot = Slots[Index & (Capacity - 1)];
+
+		// Odd sequence while writing, readers skip the slot
+		Slot.Sequence.store(Index * 2 + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		Slot.Sample = Sample;
+		Slot.Sequence.store(Index * 2 + 2, std::memory_order_release);
+	}
+
+	/** Write the buffer content from a background thread, return false if a dump is already running */
+	bool Dump();
+
+	/** Convert a dump to a csv file next to it */
+	static bool ConvertToCSV(const FString& DumpFilename);
+
+private:
+	struct alignas(64) FSlot
+	{
+		std::atomic<uint64> Sequence{0};
+		FGriffonFlightSample Sample;
+	};
+
+	void CopySamples(TArray<FGriffonFlightSample>& OutSamples) const;
+
+	FSlot Slots[Capacity];
+	std::atomic<uint64> WriteIndex{0};
+	std::atomic<bool> bDumping{false};
+};
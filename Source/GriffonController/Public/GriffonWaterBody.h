@@ -0,0 +1,37 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "GriffonWaterBody.generated.h"
+
+class UBoxComponent;
+
+/**
+ * Box of water, its surface is the top of the box. Kept level, only the yaw is used.
+ * Rasterized in the water height field of the world when it begins play, moving one at runtime doesn't move its water.
+ * The box overlaps the pawns, the sea creatures know when they enter or leave it without polling.
+ */
+UCLASS()
+class GRIFFONCONTROLLER_API AGriffonWaterBody : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	AGriffonWaterBody();
+
+	FBox GetWaterBounds() const;
+	/** Height of the surface over the point, false if the point is not over this body */
+	bool GetSurfaceHeightAt(const FVector2D& Point, float& OutHeight) const;
+
+	FORCEINLINE UBoxComponent* GetWaterBox() const { return WaterBox; }
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+private:
+	UPROPERTY(VisibleAnywhere, Category = "Water")
+	UBoxComponent *WaterBox;
+};
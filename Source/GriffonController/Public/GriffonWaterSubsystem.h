@@ -0,0 +1,60 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "GriffonWaterSubsystem.generated.h"
+
+class AGriffonWaterBody;
+
+/** Tile of the last water query of a swimmer, the tile map is only searched when it leaves it */
+struct FGriffonWaterTileCache
+{
+	FIntPoint Coord = FIntPoint(MAX_int32);
+	int32 Index = INDEX_NONE;
+	uint32 Generation = 0;
+};
+
+/**
+ * Height field of the water surface, queried by the swimmers instead of the water bodies.
+ * Tiles of TileCells^2 cells are built the first time a swimmer queries them, and kept until a body changes.
+ * Tiles without water are only a map entry.
+ */
+UCLASS()
+class GRIFFONCONTROLLER_API UGriffonWaterSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	static constexpr float CellSize = 50;
+	static constexpr int32 TileShift = 4;
+	static constexpr int32 TileCells = 1 << TileShift;
+
+	void RegisterBody(AGriffonWaterBody *Body);
+	void UnregisterBody(AGriffonWaterBody *Body);
+
+	/** Height of the water surface over the location, false if there is no water there */
+	bool FindWaterHeight(const FVector& Location, FGriffonWaterTileCache& Cache, float& OutHeight);
+
+	int32 GetNumTiles() const { return Tiles.Num(); }
+
+private:
+	struct FTile
+	{
+		float Heights[TileCells * TileCells];
+	};
+
+	/** INDEX_NONE if no body covers the tile */
+	int32 BuildTile(const FIntPoint& Coord);
+	void Invalidate();
+
+	UPROPERTY()
+	TArray<AGriffonWaterBody *> Bodies;
+
+	TArray<FTile> Tiles;
+	TMap<FIntPoint, int32> TileIndices;
+
+	/** Changed when the tiles are dropped, the tile indices cached by the swimmers too */
+	uint32 Generation = 1;
+};
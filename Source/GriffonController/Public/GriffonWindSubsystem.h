@@ -0,0 +1,55 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "GriffonWindSubsystem.generated.h"
+
+class AGriffonWindVolume;
+struct FGriffonFlightBatch;
+
+/**
+ * Sparse air velocity field (wind + thermals) of the world, sampled by the griffon flight.
+ * Only bricks of BrickCells^3 cells touched by a wind volume exist, so the memory follows the windy areas, not the world size.
+ * Each brick keeps one more row of points on its far sides, a trilinear sample never reads two bricks.
+ */
+UCLASS()
+class GRIFFONCONTROLLER_API UGriffonWindSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	static constexpr float CellSize = 400;
+	static constexpr int32 BrickShift = 3;
+	static constexpr int32 BrickCells = 1 << BrickShift;
+	static constexpr int32 BrickPoints = BrickCells + 1;
+
+	void RegisterVolume(AGriffonWindVolume *Volume);
+	void UnregisterVolume(AGriffonWindVolume *Volume);
+
+	/** Fill the air velocity of these lane groups from their position, rebuilding the field first if a volume changed */
+	void SampleBatch(FGriffonFlightBatch& Batch, int32 FirstGroup, int32 NumGroups);
+
+	int32 GetNumBricks() const { return Bricks.Num(); }
+
+private:
+	struct FBrick
+	{
+		FIntVector Coord;
+		FVector3f Samples[BrickPoints * BrickPoints * BrickPoints];
+	};
+
+	void Rebuild();
+	const FBrick* FindBrick(FGriffonFlightBatch& Batch, int32 Slot, const FIntVector& Coord) const;
+
+	UPROPERTY()
+	TArray<AGriffonWindVolume *> Volumes;
+
+	TArray<FBrick> Bricks;
+	TMap<FIntVector, int32> BrickIndices;
+
+	/** Changed by every rebuild, the brick indices cached in the batch are dropped */
+	uint32 Generation = 1;
+	bool bDirty = false;
+};
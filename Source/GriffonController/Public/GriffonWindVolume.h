@@ -0,0 +1,35 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Volume.h"
+#include "GriffonWindVolume.generated.h"
+
+/**
+ * Wind and thermal area for the griffon flight, rasterized in the wind field of the world when it begins play.
+ * Volumes are static, moving one at runtime doesn't move its wind.
+ */
+UCLASS()
+class GRIFFONCONTROLLER_API AGriffonWindVolume : public AVolume
+{
+	GENERATED_BODY()
+
+public:
+	/** Air velocity in cm/s */
+	UPROPERTY(EditAnywhere, Category = "Wind")
+	FVector Wind = FVector::ZeroVector;
+	/** Rising air speed in cm/s, gives lift to the griffons gliding in it */
+	UPROPERTY(EditAnywhere, Category = "Wind")
+	float Thermal = 0;
+	/** Distance outside of the volume where the wind fades out */
+	UPROPERTY(EditAnywhere, Category = "Wind", meta=(ClampMin="0"))
+	float Falloff = 400;
+
+	FBox GetWindBounds() const;
+	FVector GetAirVelocityAt(const FVector& Location) const;
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+};
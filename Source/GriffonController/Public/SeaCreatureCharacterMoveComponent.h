@@ -0,0 +1,91 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "EnumFile.h"
+#include "GriffonWaterSubsystem.h"
+#include "SeaCreatureCharacterMoveComponent.generated.h"
+
+class AGriffonWaterBody;
+
+/**
+ * Movement of the sea creature, buoyant swimming as the CMOVE_Swimming custom mode.
+ * The water bodies tell when the capsule enters or leaves them. In between, the depth comes from the height field
+ * of UGriffonWaterSubsystem, once per tick. It only depends on the location, the client and the server agree on it.
+ */
+UCLASS()
+class GRIFFONCONTROLLER_API USeaCreatureCharacterMoveComponent : public UCharacterMovementComponent
+{
+	GENERATED_BODY()
+
+public:
+	virtual void BeginPlay() override;
+
+	////////////////////////////////////////////////////////////
+	/// SWIMMING
+
+	UFUNCTION(BlueprintPure)
+	bool IsCreatureSwimming() const;
+	/** Part of the capsule under the surface, 0 out of the water */
+	UFUNCTION(BlueprintPure)
+	float GetImmersion() const { return Immersion; }
+	/** Distance from the surface down to the capsule center, 0 out of the water */
+	UFUNCTION(BlueprintPure)
+	float GetDepth() const;
+
+	/** Swimming starts with this part of the capsule in the water */
+	UPROPERTY(Category="Character Movement: Swimming", EditAnywhere, meta=(ClampMin="0.0", ClampMax="1.0"))
+	float ImmersionToSwim = 0.5f;
+	/** and stops under this part, lower so it doesn't flicker at the surface */
+	UPROPERTY(Category="Character Movement: Swimming", EditAnywhere, meta=(ClampMin="0.0", ClampMax="1.0"))
+	float ImmersionToLeave = 0.2f;
+	/** Push of the water on the immersed capsule, in gravities. Over 1 the creature floats */
+	UPROPERTY(Category="Character Movement: Swimming", EditAnywhere, meta=(ClampMin="0.0", ClampMax="3.0"))
+	float Buoyancy = 1.1f;
+	/** Drag of the water on the immersed capsule */
+	UPROPERTY(Category="Character Movement: Swimming", EditAnywhere, meta=(ClampMin="0.0", ClampMax="20.0"))
+	float WaterFriction = 2.f;
+	/** Turning speed toward the velocity, when still and at MaxSwimSpeed */
+	UPROPERTY(Category="Character Movement: Swimming", EditAnywhere)
+	FVector2D SwimRotationInterpSpeed = FVector2D(0.4f, 4.f);
+
+	virtual void UpdateCharacterStateBeforeMovement(float DeltaSeconds) override;
+
+	///////////////////
+	/// SWIMMING PHYSICS
+
+	virtual void PhysCustom(float deltaTime, int32 Iterations) override;
+	/** Turned toward the velocity, pitch included, while swimming */
+	virtual void PhysicsRotation(float DeltaTime) override;
+
+	void PhysSwimming(float deltaTime, int32 Iterations);
+
+	virtual float GetMaxSpeed() const override;
+	virtual float GetMaxBrakingDeceleration() const override;
+	/** The input keeps its height while swimming, to dive and rise */
+	virtual FVector ConstrainInputAcceleration(const FVector& InputAcceleration) const override;
+
+private:
+	/** From the water height of this tick and the current location */
+	float ComputeImmersion() const;
+
+	UFUNCTION()
+	void OnWaterBeginOverlap(UPrimitiveComponent *OverlappedComponent, AActor *OtherActor, UPrimitiveComponent *OtherComp,
+		int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult);
+	UFUNCTION()
+	void OnWaterEndOverlap(UPrimitiveComponent *OverlappedComponent, AActor *OtherActor, UPrimitiveComponent *OtherComp,
+		int32 OtherBodyIndex);
+
+	UPROPERTY()
+	UGriffonWaterSubsystem *WaterSubsystem;
+
+	/** Bodies overlapping the capsule, the water is only queried when there is one */
+	TArray<TWeakObjectPtr<AGriffonWaterBody>, TInlineAllocator<2>> OverlappedBodies;
+	FGriffonWaterTileCache WaterTileCache;
+
+	bool bInWater = false;
+	float WaterHeight = 0;
+	float Immersion = 0;
+};
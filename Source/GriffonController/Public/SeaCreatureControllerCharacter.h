@@ -3,6 +3,7 @@
 #pragma once
 
 #include "InputActionValue.h"
+#include "SeaCreatureCharacterMoveComponent.h"
 #include "ShapeShiftForm.h"
 #include "SeaCreatureControllerCharacter.generated.h"
 
@@ -29,9 +30,14 @@ class GRIFFONCONTROLLER_API ASeaCreatureControllerCharacter : public AShapeShift
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Input, meta = (AllowPrivateAccess = "true"))
 	class UInputAction* LookAction;
 
+protected:
+	/** Custom Movement Component **/
+	UPROPERTY(Category=Character, VisibleAnywhere, BlueprintReadOnly)
+	USeaCreatureCharacterMoveComponent *MovementComponent;
+
 public:
 	// Sets default values for this character's properties
-	ASeaCreatureControllerCharacter();
+	ASeaCreatureControllerCharacter(const FObjectInitializer& ObjectInitializer);
 
 protected:
 
@@ -53,6 +59,10 @@ public:
 	FORCEINLINE class USpringArmComponent* GetCameraBoom() const { return CameraBoom; }
 	/** Returns FollowCamera subobject **/
 	FORCEINLINE class UCameraComponent* GetFollowCamera() const { return FollowCamera; }
+	/** Returns CustomMovementComponent subobject **/
+	UFUNCTION(BlueprintPure)
+	FORCEINLINE USeaCreatureCharacterMoveComponent* GetCustomCharacterMovement() const { return MovementComponent; }
+	virtual UPawnMovementComponent* GetMovementComponent() const override { return MovementComponent; }
 	
 	// Called every frame
 	virtual void Tick(float DeltaTime) override;
@@ -3,13 +3,32 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "EnumFile.h"
 #include "GameFramework/Character.h"
+#include "InputActionValue.h"
 #include "ShapeShiftForm.generated.h"
 
 class UInputAction;
 class UInputMappingContext;
+class APlayerController;
 class AShapeShiftManager;
 class UInputComponent;
+struct FShapeShiftInputFrame;
+
+/** Movement handed from a form to the next one when shapeshifting */
+struct FShapeShiftMovementState
+{
+	FVector Velocity = FVector::ZeroVector;
+	TEnumAsByte<EMovementMode> MovementMode = MOVE_Walking;
+	uint8 CustomMovementMode = 0;
+
+	bool IsCustomMode(ECustomMovementMode Mode) const { return MovementMode == MOVE_Custom && CustomMovementMode == Mode; }
+
+	friend FArchive& operator<<(FArchive& Ar, FShapeShiftMovementState& State)
+	{
+		return Ar << State.Velocity << State.MovementMode << State.CustomMovementMode;
+	}
+};
 
 UCLASS()
 class GRIFFONCONTROLLER_API AShapeShiftForm : public ACharacter
@@ -31,11 +50,61 @@ protected:
 	
 public:
 	void SetShapeShiftManager(AShapeShiftManager *ShapeShiftManager);
+	/** Replicated, the owning client streams the forms with it */
 	AShapeShiftManager *GetShapeShiftManager() const;
 
 	virtual void StartShapeShifting();
 
+	/** The manager only possesses on the server, the owning client asks it through these */
+	UFUNCTION(Server, Reliable)
+	void ServerPrepareForm(EShapeShiftForm Form);
+	UFUNCTION(Server, Reliable)
+	void ServerShapeShiftToForm(EShapeShiftForm Form);
+
+	virtual void Tick(float DeltaSeconds) override;
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+	///////////////////
+	/// INPUT RECORDING
+	/// The forms with climbing or flight give their action values to FShapeShiftInputRecorder,
+	/// the GriffonBenchmark commandlet replays them through the same handlers
+
+	/** Action values of this frame, false if the form is not recorded */
+	virtual bool CaptureInput(FShapeShiftInputFrame& OutFrame) const { return false; }
+	/** Call the handlers Enhanced Input would call for this frame */
+	virtual void ReplayInput(const FShapeShiftInputFrame& Frame, const FShapeShiftInputFrame& Previous) {}
+
+	///////////////////
+	/// HANDOFF
+	/// UShapeShiftSubsystem prepares the next form over a few frames before possessing it,
+	/// then the movement of the previous form goes on in the new one
+
+	/** Input component and mapping context of the player, built now instead of when possessed */
+	void PrebuildInput(APlayerController *PlayerController);
+	/** Kept while pooled, it is the same when possessed again */
+	virtual void DestroyPlayerInputComponent() override;
+	virtual void PawnClientRestart() override;
+
+	virtual void SaveMovementState(FShapeShiftMovementState& OutState) const;
+	/** Modes the form doesn't have fall back to falling */
+	virtual void RestoreMovementState(const FShapeShiftMovementState& State);
+
+	///////////////////
+	/// DORMANCY
+	/// Pooled forms unregister their components: no render proxy, physics body, anim update or tick function is kept
+
+	void EnterDormancy();
+	/** Components registered again, the form stays hidden and without collision until activated */
+	void ExitDormancy();
+	bool IsDormant() const { return bDormant; }
+
+protected:
+	/** Value of the action for the local player, zero without one */
+	FInputActionValue GetActionValue(const UInputAction *Action) const;
+
 private:
-	UPROPERTY()
+	UPROPERTY(Replicated)
 	AShapeShiftManager *ShapeShiftManagerRef = nullptr;
+
+	bool bDormant = false;
 };
@@ -0,0 +1,100 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ShapeShiftForm.h"
+
+/** Input action values of one frame */
+struct FShapeShiftInputFrame
+{
+	enum EButton : uint8
+	{
+		Button_Jump = 1 << 0,
+		Button_Climb = 1 << 1,
+		Button_Fly = 1 << 2,
+	};
+
+	FVector2f Move = FVector2f::ZeroVector;
+	/** LookAction turned into the control rotation by the camera manager. A headless replay has no local player to do it */
+	FRotator3f ControlRotation = FRotator3f::ZeroRotator;
+	uint8 Buttons = 0;
+
+	bool IsHeld(EButton Button) const { return (Buttons & Button) != 0; }
+	/** ETriggerEvent::Started and Completed of the default trigger */
+	bool IsStarted(const FShapeShiftInputFrame& Previous, EButton Button) const { return IsHeld(Button) && !Previous.IsHeld(Button); }
+	bool IsCompleted(const FShapeShiftInputFrame& Previous, EButton Button) const { return !IsHeld(Button) && Previous.IsHeld(Button); }
+
+	friend FArchive& operator<<(FArchive& Ar, FShapeShiftInputFrame& Frame)
+	{
+		return Ar << Frame.Move << Frame.ControlRotation << Frame.Buttons;
+	}
+};
+
+/** Inputs of one form, frame by frame from where it stood when the recording started */
+struct GRIFFONCONTROLLER_API FShapeShiftInputRecording
+{
+	static constexpr uint32 FileMagic = 0x52495347; // GSIR
+	static constexpr uint32 FileVersion = 2;
+
+	FString MapName;
+	FString FormClass;
+	/** Fixed delta time of the recorded frames */
+	float FixedStep = 1.f / 60;
+	FTransform StartTransform;
+	/** Velocity and movement mode, flying or climbing included, restored before the first frame */
+	FShapeShiftMovementState StartMovementState;
+	TArray<FShapeShiftInputFrame> Frames;
+
+	bool Save(const FString& Filename);
+	bool Load(const FString& Filename);
+};
+
+/** Transform and cost of each replayed frame, compared to the ones of a golden replay */
+struct GRIFFONCONTROLLER_API FShapeShiftReplayTrack
+{
+	static constexpr uint32 FileMagic = 0x54525347; // GSRT
+	static constexpr uint32 FileVersion = 1;
+
+	struct FSample
+	{
+		FVector3f Location;
+		FQuat4f Rotation;
+		float FrameMs;
+
+		friend FArchive& operator<<(FArchive& Ar, FSample& Sample)
+		{
+			return Ar << Sample.Location << Sample.Rotation << Sample.FrameMs;
+		}
+	};
+
+	TArray<FSample> Samples;
+
+	bool Save(const FString& Filename);
+	bool Load(const FString& Filename);
+};
+
+/**
+ * Records the inputs of the locally controlled form to Saved/Replays (griffon.Input.Record, griffon.Input.Stop).
+ * Launch with -UseFixedTimeStep -FPS=60 so the frames are the ones replayed. Shapeshifting ends the recording.
+ * The files are replayed by the GriffonBenchmark commandlet.
+ */
+class GRIFFONCONTROLLER_API FShapeShiftInputRecorder
+{
+public:
+	static FShapeShiftInputRecorder& Get();
+
+	void Start();
+	/** Write the recording, return false if there was none */
+	bool Stop();
+
+	bool IsRecording() const { return bRecording; }
+
+	/** Called by the form each frame while recording */
+	void Record(const AShapeShiftForm *Form, const FShapeShiftInputFrame& Frame);
+
+private:
+	FShapeShiftInputRecording Recording;
+	TWeakObjectPtr<const AShapeShiftForm> RecordedForm;
+	bool bRecording = false;
+};
@@ -5,9 +5,14 @@
 #include "CoreMinimal.h"
 #include "EnumFile.h"
 #include "GameFramework/Actor.h"
+#include "Engine/StreamableManager.h"
 #include "ShapeShiftManager.generated.h"
 
+class AController;
+class AGameModeBase;
+class APlayerController;
 class AShapeShiftForm;
+class UShapeShiftSubsystem;
 
 UCLASS()
 class GRIFFONCONTROLLER_API AShapeShiftManager : public AActor
@@ -21,26 +26,70 @@ public:
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 public:	
 	// Called every frame
 	virtual void Tick(float DeltaTime) override;
 
-	void SetActiveCharacter(ACharacter *Character, bool Active);
-	
-	void ShapeShiftBackToDruid();
-	void ShapeShiftToForm(EShapeShiftForm form);
+	/** Druid of a player joining after BeginPlay */
+	void AddPlayer(AController *Controller);
+
+	void ShapeShiftBackToDruid(AController *Controller);
+	/** Form chosen ahead of ShapeShiftToForm, prepared over the next frames once resident. Server only */
+	void PrepareForm(AController *Controller, EShapeShiftForm form);
+	/** Right away if the form is resident, else when its async load is done. Server only, clients go through the form RPCs */
+	void ShapeShiftToForm(AController *Controller, EShapeShiftForm form);
+	/** Form possessed by the controller, SSForm_MAX if none */
+	EShapeShiftForm GetForm(const AController *Controller) const;
+
+	///////////////////
+	/// FORM STREAMING
+	/// Only the druid and the possessed forms are sure to be resident. The others are loaded asynchronously when they
+	/// may be chosen, one hidden in the pool of UShapeShiftSubsystem, and evicted least recently used first past FormMemoryBudgetMB
+
+	/** Load the form and pool one hidden, nothing if it is resident or loading */
+	void PreloadForm(EShapeShiftForm Form);
+	/** Forms the druid most likely shapeshifts into, when it starts charging */
+	void PreloadCandidateForms();
+	bool IsFormResident(EShapeShiftForm Form) const;
 
 	UPROPERTY(EditAnywhere)
-	TSubclassOf<AShapeShiftForm> ShapeShiftFormDruidClass;
+	TSoftClassPtr<AShapeShiftForm> ShapeShiftFormDruidClass;
 	UPROPERTY(EditAnywhere)
-	TSubclassOf<AShapeShiftForm> ShapeShiftFormGriffonClass;
+	TSoftClassPtr<AShapeShiftForm> ShapeShiftFormGriffonClass;
 	UPROPERTY(EditAnywhere)
-	TSubclassOf<AShapeShiftForm> ShapeShiftFormWerewolfClass;
+	TSoftClassPtr<AShapeShiftForm> ShapeShiftFormWerewolfClass;
 	UPROPERTY(EditAnywhere)
-	TSubclassOf<AShapeShiftForm> ShapeShiftFormSeaCreatureClass;
+	TSoftClassPtr<AShapeShiftForm> ShapeShiftFormSeaCreatureClass;
+
+	/** Loaded forms nobody is in are evicted past this, as estimated from one of their actors */
+	UPROPERTY(EditAnywhere, meta=(ClampMin="0.0"))
+	float FormMemoryBudgetMB = 256;
+	/** Last used forms preloaded when the druid charges */
+	UPROPERTY(EditAnywhere, meta=(ClampMin="0", ClampMax="3"))
+	int32 NumCandidateForms = 1;
+
+private:
+	const TSoftClassPtr<AShapeShiftForm>& GetFormClass(EShapeShiftForm Form) const;
+	void OnFormLoaded(EShapeShiftForm Form);
+	void OnPostLogin(AGameModeBase *GameMode, APlayerController *NewPlayer);
+	/** Least recently used first, until the resident forms fit in the budget */
+	void EvictForms();
+	bool IsFormPinned(EShapeShiftForm Form) const;
+	void TouchForm(EShapeShiftForm Form);
+	void UpdateFormStats() const;
 
 	UPROPERTY()
-	TArray<AShapeShiftForm *> CharacterRefs;
-	EShapeShiftForm ActualForm;
+	UShapeShiftSubsystem *ShapeShiftSubsystem;
+
+	/** Keep the loaded classes, and all they reference, in memory */
+	TSharedPtr<FStreamableHandle> FormHandles[SSForm_MAX];
+	int64 FormSizes[SSForm_MAX] = {};
+	/** Most recently used first */
+	TArray<EShapeShiftForm, TInlineAllocator<SSForm_MAX>> RecentForms;
+	/** Controllers waiting for a form to load */
+	TMap<TWeakObjectPtr<AController>, EShapeShiftForm> PendingForms;
+
+	FDelegateHandle PostLoginHandle;
 };
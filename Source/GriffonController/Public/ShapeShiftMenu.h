@@ -8,7 +8,8 @@
 #include "ShapeShiftMenu.generated.h"
 
 /**
- * 
+ * Created hidden when a local player possesses the druid, shown when the druid charges a shapeshift.
+ * In cursor mode the forms are clicked, in radial mode the druid points at them with the select action.
  */
 UCLASS()
 class GRIFFONCONTROLLER_API UShapeShiftMenu : public UUserWidget
@@ -18,7 +19,42 @@ class GRIFFONCONTROLLER_API UShapeShiftMenu : public UUserWidget
 	virtual void NativeConstruct() override;
 
 public:
-	void Show();
+	void Show(EShapeShiftMenuMode InMode);
 	UFUNCTION(BlueprintCallable)
 	void ChooseShapeShiftForm(EShapeShiftForm form);
+	/** Close the menu without shapeshifting, the druid can move again */
+	UFUNCTION(BlueprintCallable)
+	void CancelShapeShiftForm();
+	/** Hovered form, starts streaming it before it is chosen */
+	UFUNCTION(BlueprintCallable)
+	void PreviewShapeShiftForm(EShapeShiftForm form);
+
+	///////////////////
+	/// RADIAL
+	/// The forms other than the druid share the circle, the first one up then clockwise
+
+	/** Highlight the form the stick points at. Under RadialDeadZone the highlight stays */
+	void SelectDirection(const FVector2D& Direction);
+	/** Choose the highlighted form, cancel if none is. False if no form was chosen */
+	bool ConfirmSelection();
+
+	UFUNCTION(BlueprintPure)
+	EShapeShiftMenuMode GetMode() const { return Mode; }
+	/** SSForm_MAX when none is */
+	UFUNCTION(BlueprintPure)
+	EShapeShiftForm GetHighlightedForm() const { return HighlightedForm; }
+
+protected:
+	/** The highlight changed, SSForm_MAX when cleared */
+	UFUNCTION(BlueprintImplementableEvent)
+	void OnFormHighlighted(EShapeShiftForm form);
+
+	UPROPERTY(EditAnywhere, Category = "Radial")
+	float RadialDeadZone = 0.5f;
+
+private:
+	void SetHighlightedForm(EShapeShiftForm form);
+
+	TEnumAsByte<EShapeShiftMenuMode> Mode = SSMenu_Cursor;
+	TEnumAsByte<EShapeShiftForm> HighlightedForm = SSForm_MAX;
 };
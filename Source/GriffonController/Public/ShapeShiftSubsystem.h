@@ -0,0 +1,136 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ShapeShiftSubsystem.generated.h"
+
+class AController;
+class AGameModeBase;
+class AShapeShiftForm;
+
+/** Forms of one class, hidden ones waiting for a controller */
+USTRUCT()
+struct FShapeShiftFormPool
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<AShapeShiftForm *> Free;
+
+	int32 NumActive = 0;
+	/** Most forms of the class possessed at once during this window */
+	int32 PeakActive = 0;
+	/** Forms of the class possessed at once lately, decays by half each window */
+	float Demand = 0;
+	/** Hidden forms kept even without demand, the class was loaded to be shifted into */
+	int32 MinFree = 0;
+	/** Bytes of one pooled form, without the assets shared with the possessed ones. Measured when a form settles */
+	int64 FormSize = 0;
+};
+
+/** Frame times around each shapeshift, a hitch is reported once the frames after it are in */
+struct FShapeShiftHitchProbe
+{
+	static constexpr int32 NumFramesBefore = 32;
+	static constexpr int32 NumFramesAfter = 8;
+
+	void AddFrame(float FrameMs);
+	void BeginShift(float InSwapMs, int32 InPreparedFrames);
+
+private:
+	void Report() const;
+
+	float FramesMs[NumFramesBefore] = {};
+	int32 NumFrames = 0;
+	/** INDEX_NONE until a shift */
+	int32 FramesSinceShift = INDEX_NONE;
+	float BaselineMs = 0;
+	float WorstMs = 0;
+	float SwapMs = 0;
+	int32 PreparedFrames = 0;
+};
+
+/**
+ * Possess shapeshift forms for any number of controllers. The forms come from a pool per class, a form left is
+ * hidden and handed to the next controller shifting into its class. Each pool keeps as many hidden forms as the
+ * class was possessed at once lately, within griffon.ShapeShift.MaxPooledForms and griffon.ShapeShift.PoolBudgetMB.
+ * Pooled forms settle the frame after their release: dormant (griffon.ShapeShift.Dormancy), then measured.
+ * A form chosen ahead (during the cast) is prepared one step a frame: taken from the pool, registered, input built,
+ * placed and posed. The swap frame is then only the possession and the movement handed over.
+ */
+UCLASS()
+class GRIFFONCONTROLLER_API UShapeShiftSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	/** Get a form of the class ready for the controller over the next frames, PossessForm takes it */
+	void PrepareForm(AController *Controller, UClass *FormClass);
+	/** Possess a form of the class at the transform, with the movement of the previous form, which goes back to the pool */
+	AShapeShiftForm* PossessForm(AController *Controller, UClass *FormClass, const FTransform& Transform);
+	/** Unpossess the form and hide it in its pool, destroyed past the caps */
+	void ReleaseForm(AShapeShiftForm *Form);
+	/** Spawn a hidden form of the class in its pool and keep one there, null past the caps */
+	AShapeShiftForm* PrewarmForm(UClass *FormClass);
+	/** Destroy the hidden forms of the class so it can be unloaded */
+	void FlushPool(UClass *FormClass);
+
+	int32 GetNumActive(UClass *FormClass) const;
+
+	static void SetFormActive(ACharacter *Character, bool bActive);
+
+private:
+	enum class EPrepareStep : uint8
+	{
+		Acquire,
+		Register,
+		Input,
+		Pose,
+		Ready,
+	};
+
+	struct FPreparedForm
+	{
+		TWeakObjectPtr<UClass> FormClass;
+		TWeakObjectPtr<AShapeShiftForm> Form;
+		EPrepareStep Step = EPrepareStep::Acquire;
+		int32 NumFrames = 0;
+	};
+
+	/** One step of the preparation, false once ready */
+	bool AdvancePreparation(AController *Controller, FPreparedForm& Prepared);
+	/** Back to the pool, the controller shifted into something else */
+	void CancelPreparation(FPreparedForm& Prepared);
+
+	AShapeShiftForm* AcquireForm(UClass *FormClass, FShapeShiftFormPool& Pool);
+	/** Dormant if enabled, and the pool cost updated with what the form takes now */
+	void SettleForm(AShapeShiftForm *Form);
+	AShapeShiftForm* SpawnPooledForm(UClass *FormClass);
+	void AddPooledForm(FShapeShiftFormPool& Pool, AShapeShiftForm *Form);
+	void DestroyPooledForm(FShapeShiftFormPool& Pool);
+	bool CanPool(const FShapeShiftFormPool& Pool) const;
+	void OnLogout(AGameModeBase *GameMode, AController *Controller);
+
+	UPROPERTY()
+	TMap<UClass *, FShapeShiftFormPool> Pools;
+
+	int32 NumPooled = 0;
+	int64 PooledSize = 0;
+	float WindowTime = 0;
+
+	TMap<TWeakObjectPtr<AController>, FPreparedForm> PreparedForms;
+	/** Released this frame, maybe from one of their own anim notifies */
+	TArray<TWeakObjectPtr<AShapeShiftForm>> SettlingForms;
+
+	FShapeShiftHitchProbe HitchProbe;
+	double LastFrameTime = 0;
+
+	FDelegateHandle LogoutHandle;
+};
@@ -5,8 +5,85 @@
 #include "CoreMinimal.h"
 #include "GameFramework/CharacterMovementComponent.h"
 #include "EnumFile.h"
+#include "WorldCollision.h"
 #include "WerewolfCharacterMoveComponent.generated.h"
 
+class UClimbSurfaceCacheSubsystem;
+class UClimbSurfaceGraphSubsystem;
+struct FClimbGraphLedge;
+
+/**
+ * Saved move of the werewolf, the climbing intent goes in the compressed flags.
+ * The server enters and leaves CMOVE_Climbing on the same moves as the client.
+ */
+class FSavedMove_Werewolf : public FSavedMove_Character
+{
+public:
+	typedef FSavedMove_Character Super;
+
+	enum
+	{
+		FLAG_WantsToClimb = FLAG_Custom_0,
+	};
+
+	virtual void Clear() override;
+	virtual uint8 GetCompressedFlags() const override;
+	virtual void SetMoveFor(ACharacter *Character, float InDeltaTime, FVector const& NewAccel, FNetworkPredictionData_Client_Character& ClientData) override;
+
+	uint8 bSavedWantsToClimb : 1;
+};
+
+class FNetworkPredictionData_Client_Werewolf : public FNetworkPredictionData_Client_Character
+{
+public:
+	typedef FNetworkPredictionData_Client_Character Super;
+
+	explicit FNetworkPredictionData_Client_Werewolf(const UCharacterMovementComponent& ClientMovement) : Super(ClientMovement) {}
+
+	virtual FSavedMovePtr AllocateNewMove() override;
+};
+
+/** Corrections while climbing also carry the surface, quantized, so the client replays its moves on the server one */
+struct FWerewolfMoveResponseDataContainer : public FCharacterMoveResponseDataContainer
+{
+	typedef FCharacterMoveResponseDataContainer Super;
+
+	virtual void ServerFillResponseData(const UCharacterMovementComponent& CharacterMovement, const FClientAdjustment& PendingAdjustment) override;
+	virtual bool Serialize(UCharacterMovementComponent& CharacterMovement, FArchive& Ar, UPackageMap *PackageMap) override;
+
+	bool bClimbing = false;
+	int16 QuantizedNormal[3] = {0, 0, 0};
+	/** Climbing position from the corrected location, in mm */
+	int16 QuantizedPositionOffset[3] = {0, 0, 0};
+};
+
+/** What a climbing werewolf computes at a LOD */
+USTRUCT()
+struct FClimbLODSettings
+{
+	GENERATED_BODY()
+
+	FClimbLODSettings() = default;
+	FClimbLODSettings(int32 InMaxAssistSweeps, int32 InWallSweepInterval, int32 InSurfaceInterval, bool bInSnapToSurface,
+		bool bInInterpolateRotation)
+		: MaxAssistSweeps(InMaxAssistSweeps), WallSweepInterval(InWallSweepInterval), SurfaceInterval(InSurfaceInterval),
+		bSnapToSurface(bInSnapToSurface), bInterpolateRotation(bInInterpolateRotation) {}
+
+	/** Assist sweeps spread over the wall hits, 0 for one per hit */
+	UPROPERTY(EditAnywhere, meta=(ClampMin="0"))
+	int32 MaxAssistSweeps = 0;
+	/** Frames between two wall sweeps */
+	UPROPERTY(EditAnywhere, meta=(ClampMin="1"))
+	int32 WallSweepInterval = 1;
+	/** Frames between two surface computations, the normal and position are kept in between */
+	UPROPERTY(EditAnywhere, meta=(ClampMin="1"))
+	int32 SurfaceInterval = 1;
+	UPROPERTY(EditAnywhere)
+	bool bSnapToSurface = true;
+	UPROPERTY(EditAnywhere)
+	bool bInterpolateRotation = true;
+};
+
 /**
  * 
  */
@@ -17,15 +94,18 @@ class GRIFFONCONTROLLER_API UWerewolfCharacterMoveComponent : public UCharacterM
 	GENERATED_BODY()
 
 public:
+	UWerewolfCharacterMoveComponent();
+
 	virtual void BeginPlay() override;
 
 	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
 
-	virtual void OnMovementUpdated(float DeltaSeconds, const FVector& OldLocation, const FVector& OldVelocity) override;
+	virtual void UpdateCharacterStateBeforeMovement(float DeltaSeconds) override;
 	
 	////////////////////////////////////////////////////////////
 	/// CLIMBING
 
+	/** Draw this werewolf traces when griffon.Debug.Climb is on */
 	UPROPERTY(EditAnywhere)
 	bool IsDebug = true;
 	
@@ -49,12 +129,37 @@ public:
 	bool IsFacingSurface(const float Steepness) const;
 	bool EyeHeightTrace(const float TraceDistance) const;
 
+	///////////////////
+	/// WALL SWEEP CACHE
+	/// The sweep only runs with a climb intent, near blocking static geometry, and when the capsule moved
+
+	/** Sweeps the walls again or keeps the last hits */
+	void UpdateWallHits();
+
+	/** Last hits are kept while the capsule moved less than this (cm) */
+	UPROPERTY(Category="Character Movement: Climbing", EditAnywhere, meta=(ClampMin="0.0", ClampMax="20.0"))
+	float WallSweepReuseDistance = 2.f;
+	/** and turned less than this (degrees) */
+	UPROPERTY(Category="Character Movement: Climbing", EditAnywhere, meta=(ClampMin="0.0", ClampMax="20.0"))
+	float WallSweepReuseDegrees = 2.f;
+	/** No sweep without blocking static geometry in this radius */
+	UPROPERTY(Category="Character Movement: Climbing", EditAnywhere, meta=(ClampMin="100.0", ClampMax="2000.0"))
+	float WallBroadphaseRadius = 400.f;
+	/** Walls are still swept for this long after the climb intent is gone (s) */
+	UPROPERTY(Category="Character Movement: Climbing", EditAnywhere, meta=(ClampMin="0.0", ClampMax="5.0"))
+	float WallSweepIntentLinger = 0.5f;
+
+	/** Measured over the last second, also summed in stat Griffon */
+	UPROPERTY(Category="Character Movement: Climbing", VisibleInstanceOnly, Transient)
+	float WallSweepsPerSecond = 0;
+
 	///////////////////
 	/// START/STOP CLIMBING INPUT
 
 	void TryClimbing();
 	void CancelClimbing();
 
+	/** Input of the owning client, sent to the server in the compressed flags */
 	bool bWantsToClimb = false;
 
 	UFUNCTION(BlueprintPure)
@@ -86,6 +191,55 @@ public:
 	FVector CurrentClimbingNormal;
 	FVector CurrentClimbingPosition;
 
+	/** Normal components on 16 bits, kept quantized on the client and the server as in the corrections */
+	static int16 QuantizeNormalComponent(double Value);
+	static double DequantizeNormalComponent(int16 Quantized);
+	static FVector QuantizeClimbingNormal(const FVector& Normal);
+
+	///////////////////
+	/// ASYNC SURFACE PROBES
+	/// The assist sweeps of ComputeSurfaceInfo go through the async trace API, sent from where the werewolf
+	/// should be next frame and read then. The synchronous sweeps are used when it is not there.
+
+	UPROPERTY(Category="Character Movement: Climbing", EditAnywhere)
+	bool bAsyncSurfaceProbes = false;
+	/** Probes are thrown away past this distance between the predicted and the actual location (cm) */
+	UPROPERTY(Category="Character Movement: Climbing", EditAnywhere, meta=(ClampMin="0.0", ClampMax="50.0"))
+	float SurfaceProbeMaxError = 5.f;
+
+	/** Surface from the synchronous sweeps or the probes */
+	void ResolveSurfaceInfo();
+	/** Surface from the synchronous sweeps */
+	void SweepSurfaceInfo();
+
+	///////////////////
+	/// SURFACE CACHE
+
+	/** Surfaces resolved on static walls are kept in UClimbSurfaceCacheSubsystem, climbing there again skips the sweeps */
+	UPROPERTY(Category="Character Movement: Climbing", EditAnywhere)
+	bool bCacheSurfaceInfo = true;
+
+	///////////////////
+	/// CLIMBING LOD
+	/// Player controlled werewolves climb at full quality, AI ones by their distance to the players and if they were rendered
+
+	UPROPERTY(Category="Character Movement: Climbing LOD", EditAnywhere)
+	FClimbLODSettings ClimbLODFull;
+	UPROPERTY(Category="Character Movement: Climbing LOD", EditAnywhere)
+	FClimbLODSettings ClimbLODReduced = FClimbLODSettings(4, 2, 2, true, true);
+	UPROPERTY(Category="Character Movement: Climbing LOD", EditAnywhere)
+	FClimbLODSettings ClimbLODMinimal = FClimbLODSettings(2, 4, 4, false, false);
+
+	/** AI werewolves further than this from every player are Minimal (cm) */
+	UPROPERTY(Category="Character Movement: Climbing LOD", EditAnywhere, meta=(ClampMin="0.0"))
+	float ClimbLODReducedDistance = 2000.f;
+
+	UPROPERTY(Category="Character Movement: Climbing LOD", VisibleInstanceOnly, Transient)
+	TEnumAsByte<EClimbLOD> ClimbLOD = ClimbLOD_Full;
+
+	void UpdateClimbLOD();
+	const FClimbLODSettings& GetClimbLODSettings() const;
+
 	///////////////////
 	/// CLIMBING PHYSICS VALUES
 	
@@ -116,6 +270,128 @@ public:
 	bool TryClimbUpLedge() const;
 
 	bool HasReachedEdge() const;
+	/** Walkable floor under this location, a mantle target */
 	bool IsLocationWalkable(const FVector& CheckLocation) const;
 	bool CanMoveToLedgeClimbLocation() const;
+
+	struct FLedgeCheck
+	{
+		bool bReachedEdge = false;
+		bool bCanMantle = false;
+		/** Floor the werewolf stands on after climbing up */
+		FVector MantleTarget = FVector::ZeroVector;
+	};
+
+	/** Edge and mantle target in front of the werewolf, the same result is given while it doesn't move */
+	const FLedgeCheck& CheckLedge() const;
+	/** True with a validated mantle target when the werewolf can climb up now */
+	bool FindLedgeMantleTarget(FVector& OutMantleTarget) const;
+	void InvalidateLedgeCheck() { bLedgeCheckValid = false; }
+
+	///////////////////
+	/// CLIMB GRAPH
+	/// Walls and ledges baked by the ClimbGraphBake commandlet, asked before tracing. Where the level has
+	/// no graph, or the graph has nothing there, the traces decide alone.
+
+	/** Baked ledges are looked for this far from the werewolf (cm) */
+	UPROPERTY(Category="Character Movement: Climbing", EditAnywhere, meta=(ClampMin="50.0", ClampMax="400.0"))
+	float GraphLedgeReach = 150.f;
+
+	bool IsCoveredByClimbGraph() const;
+	const FClimbGraphLedge* FindGraphLedge() const;
+
+	///////////////////
+	/// NETWORK
+
+	virtual FNetworkPredictionData_Client* GetPredictionData_Client() const override;
+	virtual void UpdateFromCompressedFlags(uint8 Flags) override;
+	virtual void ClientHandleMoveResponse(const FCharacterMoveResponseDataContainer& MoveResponse) override;
+
+private:
+	/** The moves replayed after a climbing correction stay on the surface it sent, not a local trace */
+	bool bReplayOnServerSurface = false;
+
+	///////////////////
+	/// CLIMBING UP LEDGES
+
+	/** False when no baked ledge is in front, the rays must decide then */
+	bool CheckLedgeFromGraph(FLedgeCheck& OutCheck) const;
+	/** Fixed pattern of rays and one capsule overlap, stopping at the first failed one */
+	void ProbeLedge(FLedgeCheck& OutCheck) const;
+	bool HasStandingRoomAt(const FVector& Floor) const;
+
+	mutable FLedgeCheck LedgeCheck;
+	mutable FVector LedgeCheckLocation = FVector::ZeroVector;
+	mutable FVector LedgeCheckForward = FVector::ZeroVector;
+	mutable bool bLedgeCheckValid = false;
+
+	///////////////////
+	/// WALL SWEEP CACHE
+
+	bool HasClimbIntent() const;
+	/** Returns true if the geometry around changed */
+	bool UpdateWallBroadphase(const FVector& Location);
+	bool HasWallGeometryMoved() const;
+
+	struct FWallGeometry
+	{
+		TWeakObjectPtr<const UPrimitiveComponent> Component;
+		FTransform Transform;
+	};
+
+	/** Blocking static geometry in WallBroadphaseRadius of BroadphaseCenter */
+	TArray<FWallGeometry> WallGeometry;
+	TArray<FOverlapResult> BroadphaseOverlaps;
+	FVector BroadphaseCenter = FVector::ZeroVector;
+	float BroadphaseTime = -1;
+	bool bBroadphaseValid = false;
+
+	FVector LastSweepLocation = FVector::ZeroVector;
+	FVector LastSweepForward = FVector::ZeroVector;
+	bool bWallHitsValid = false;
+
+	float LastClimbIntentTime = -MAX_flt;
+
+	///////////////////
+	/// ASYNC SURFACE PROBES
+
+	/** Returns false when the probes of last frame can't be used */
+	bool ConsumeSurfaceProbes();
+	void IssueSurfaceProbes();
+
+	TArray<FTraceHandle> SurfaceProbes;
+	FTraceDatum SurfaceProbeDatum;
+	FVector SurfaceProbeLocation = FVector::ZeroVector;
+	uint64 SurfaceProbeFrame = MAX_uint64;
+	bool bSurfaceProbesConsumed = false;
+
+	///////////////////
+	/// SURFACE CACHE
+
+	UPROPERTY()
+	UClimbSurfaceCacheSubsystem *SurfaceCache;
+	UPROPERTY()
+	UClimbSurfaceGraphSubsystem *SurfaceGraph;
+
+	void AddSurfaceComponent(const FHitResult& Hit);
+
+	/** Components hit by the sweeps or probes, the surface is only cached when they all hit */
+	TArray<const UPrimitiveComponent *, TInlineAllocator<16>> SurfaceComponents;
+	bool bSurfaceResolved = false;
+
+	///////////////////
+	/// CLIMBING LOD
+
+	/** True on the frames of a task run every Interval frames, spread between the werewolves */
+	bool IsClimbLODFrame(int32 Interval) const;
+	/** Step between the wall hits the assist sweeps go toward */
+	int32 GetAssistSweepStride() const;
+
+	///////////////////
+	/// NETWORK
+
+	FWerewolfMoveResponseDataContainer WerewolfMoveResponseData;
+
+	int32 WallSweepsInWindow = 0;
+	float WallSweepWindow = 0;
 };
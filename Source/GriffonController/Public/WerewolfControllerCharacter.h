@@ -69,6 +69,17 @@ public:
 	// Called every frame
 	virtual void Tick(float DeltaTime) override;
 
+	///////////////////////////////
+	/// INPUT RECORDING
+
+	virtual bool CaptureInput(FShapeShiftInputFrame& OutFrame) const override;
+	virtual void ReplayInput(const FShapeShiftInputFrame& Frame, const FShapeShiftInputFrame& Previous) override;
+
+	///////////////////////////////
+	/// HANDOFF
+
+	virtual void RestoreMovementState(const FShapeShiftMovementState& State) override;
+
 protected:
 	///////////////////////////////
 	/// CLIMB